@@ -0,0 +1,58 @@
+// Benchmark of the kernels behind the array builtin functions. Every set of
+// kernels supported by the cpu runs the same reductions over the same f64
+// array so the vector kernels can be compared to the scalar ones
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "targets/bytecode/vm/builtins/array_kernels.hpp"
+
+using namespace kore;
+
+void run_benchmark(const vm::ArrayKernels& kernels, std::vector<f64>& values, int rounds) {
+    f64 result = 0.0;
+    std::size_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int round = 0; round < rounds; ++round) {
+        result += kernels.sum(values.data(), values.size());
+        result += kernels.dot(values.data(), values.data(), values.size());
+        result += kernels.max(values.data(), values.size());
+        count += kernels.count_eq(values.data(), values.size(), 3.0);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(end - start).count();
+    auto elements = 4.0 * values.size() * rounds;
+
+    // Print the results so the compiler cannot drop the calls
+    std::cout << kernels.name << ":" << std::endl
+              << std::fixed << std::setprecision(3)
+              << rounds << " rounds in " << seconds << "s" << std::endl
+              << std::setprecision(1)
+              << (elements / seconds / 1e6) << "M elements/s" << std::endl
+              << "result: " << result << ", count: " << count << std::endl
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+    std::vector<f64> values(1 << 16);
+
+    for (std::size_t idx = 0; idx < values.size(); ++idx) {
+        values[idx] = static_cast<f64>(idx % 7);
+    }
+
+    run_benchmark(vm::scalar_array_kernels(), values, rounds);
+
+    for (auto kernels : { vm::sse2_array_kernels(), vm::avx2_array_kernels() }) {
+        if (kernels) {
+            run_benchmark(*kernels, values, rounds);
+        }
+    }
+
+    return 0;
+}
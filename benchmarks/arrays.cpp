@@ -0,0 +1,151 @@
+// Benchmark of writing and reading an i32 array with the untyped array
+// instructions, which store a full register value per element, and the typed
+// array instructions, which store the elements unboxed. The KIR is
+// constructed by hand in the same shape the KIR lowering pass generates for
+//
+//     var array = [0, 0, ...] // size elements
+//     var round = 0
+//
+//     while round < rounds {
+//         var i = 0
+//         var sum = 0
+//
+//         while i < size {
+//             array[i] = i
+//             sum = sum + array[i]
+//             i = i + 1
+//         }
+//
+//         round = round + 1
+//     }
+//
+// and is then compiled to bytecode, loaded and run like any other module.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "targets/bytecode/codegen/bytecode_codegen2.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+#include "targets/bytecode/vm/vm.hpp"
+#include "types/array_type.hpp"
+
+using namespace kore;
+
+void add_blocks(kir::Graph& graph) {
+    graph.add_block(kir::BasicBlock::StartBlockId);
+    graph.add_block(kir::BasicBlock::EndBlockId);
+}
+
+/// Add the main function. The array instructions are untyped unless the
+/// array type is an array of i32
+void add_main_function(kir::Module& module, const Type* array_type, int size, int rounds) {
+    auto& function = module[module.add_function(nullptr)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto init_block = graph.add_block();
+    auto outer_block = graph.add_block();
+    auto inner_init_block = graph.add_block();
+    auto inner_block = graph.add_block();
+    auto body_block = graph.add_block();
+    auto next_round_block = graph.add_block();
+    auto exit_block = graph.add_block();
+
+    // Blocks are generated in breadth-first order so chain them in order.
+    // Loops jump back explicitly
+    graph.add_edge(kir::BasicBlock::StartBlockId, init_block);
+    graph.add_edge(init_block, outer_block);
+    graph.add_edge(outer_block, inner_init_block);
+    graph.add_edge(inner_init_block, inner_block);
+    graph.add_edge(inner_block, body_block);
+    graph.add_edge(body_block, next_round_block);
+    graph.add_edge(next_round_block, exit_block);
+
+    graph.set_current_block(init_block);
+    Reg array_reg = function.emit_allocate_array(size, array_type);
+    Reg round_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg rounds_reg = function.emit_load(Bytecode::Cload, constants.add(rounds));
+    Reg size_reg = function.emit_load(Bytecode::Cload, constants.add(size));
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    Reg i_reg = function.allocate_register();
+    Reg sum_reg = function.allocate_register();
+    Reg element_reg = function.allocate_register();
+    Reg cond_reg = function.allocate_register();
+
+    graph.set_current_block(outer_block);
+    function.emit_reg3(Bytecode::LtI32, cond_reg, round_reg, rounds_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, exit_block);
+
+    graph.set_current_block(inner_init_block);
+    function.emit_reg3(Bytecode::SubI32, i_reg, i_reg, i_reg);
+    function.emit_reg3(Bytecode::SubI32, sum_reg, sum_reg, sum_reg);
+
+    graph.set_current_block(inner_block);
+    function.emit_reg3(Bytecode::LtI32, cond_reg, i_reg, size_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, next_round_block);
+
+    graph.set_current_block(body_block);
+    function.emit_array_set(array_type, array_reg, i_reg, i_reg);
+    function.emit_array_get(array_type, array_reg, i_reg, element_reg);
+    function.emit_reg3(Bytecode::AddI32, sum_reg, sum_reg, element_reg);
+    function.emit_reg3(Bytecode::AddI32, i_reg, i_reg, one_reg);
+    function.emit_unconditional_jump(inner_block);
+
+    graph.set_current_block(next_round_block);
+    function.emit_reg3(Bytecode::AddI32, round_reg, round_reg, one_reg);
+    function.emit_unconditional_jump(outer_block);
+
+    graph.set_current_block(exit_block);
+    function.emit_return();
+}
+
+void run_benchmark(const Type* array_type, int size, int rounds) {
+    bool typed = array_type->category() == TypeCategory::Array;
+    kir::Kir kir;
+    kir::Module module(0, "arrays.kore");
+
+    add_main_function(module, array_type, size, rounds);
+    kir.add_module(module);
+
+    BytecodeGenerator2 code_generator;
+    auto buffer = code_generator.generate(kir);
+    std::istringstream iss(std::string(buffer.cbegin(), buffer.cend()));
+    auto loaded_module = load_module_from_stream(iss);
+
+    vm::Vm vm;
+    auto start = std::chrono::steady_clock::now();
+    vm.run_module(loaded_module);
+    auto end = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(end - start).count();
+    std::uint64_t accesses = 2 * static_cast<std::uint64_t>(size) * rounds;
+
+    auto element_type = typed ? vm::ArrayElementType::I32 : vm::ArrayElementType::Value;
+    vm::ArrayValue array(size, element_type);
+
+    std::cout << (typed ? "typed:" : "untyped:") << std::endl
+              << std::fixed << std::setprecision(3)
+              << accesses << " accesses in " << seconds << "s" << std::endl
+              << std::setprecision(1)
+              << (accesses / seconds / 1e6) << "M accesses/s" << std::endl
+              << array.element_bytes() << " bytes for " << size << " elements" << std::endl
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int size = 50000;
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 200;
+    auto i32_type = Type::get_type_from_category(TypeCategory::Integer32);
+
+    // A type that is not an array type gets the untyped array instructions
+    run_benchmark(Type::unknown(), size, rounds);
+    run_benchmark(Type::make_array_type(i32_type), size, rounds);
+
+    return 0;
+}
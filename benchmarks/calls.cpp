@@ -0,0 +1,125 @@
+// Benchmark of the number of function calls per second the vm can execute.
+// The KIR is constructed by hand in the same shape the KIR lowering pass
+// generates for
+//
+//     func add(a i32, b i32) i32 {
+//         return a + b
+//     }
+//
+//     var i = 0
+//
+//     while i < iterations {
+//         i = add(i, 1)
+//     }
+//
+// and is then compiled to bytecode, loaded and run like any other module.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ast/scanner/token.hpp"
+#include "ast/statements/function.hpp"
+#include "targets/bytecode/codegen/bytecode_codegen2.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/vm/vm.hpp"
+
+using namespace kore;
+
+void add_blocks(kir::Graph& graph) {
+    graph.add_block(kir::BasicBlock::StartBlockId);
+    graph.add_block(kir::BasicBlock::EndBlockId);
+}
+
+void add_main_function(kir::Module& module, int iterations) {
+    auto& function = module[module.add_function(nullptr)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto init_block = graph.add_block();
+    auto loop_block = graph.add_block();
+    auto body_block = graph.add_block();
+    auto exit_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, init_block);
+    graph.add_edge(init_block, loop_block);
+    graph.add_edge(loop_block, body_block);
+    graph.add_edge(loop_block, exit_block);
+
+    graph.set_current_block(init_block);
+    Reg counter_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg iterations_reg = function.emit_load(Bytecode::Cload, constants.add(iterations));
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+
+    graph.set_current_block(loop_block);
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LtI32, cond_reg, counter_reg, iterations_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, exit_block);
+
+    graph.set_current_block(body_block);
+    auto arg_regs = function.allocate_registers(2);
+    function.emit_move(arg_regs[0], counter_reg);
+    function.emit_move(arg_regs[1], one_reg);
+    Reg func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+    function.emit_call(func_reg, arg_regs[0], arg_regs, { arg_regs[0] });
+    function.emit_move(counter_reg, arg_regs[0]);
+    function.emit_unconditional_jump(loop_block);
+
+    graph.set_current_block(exit_block);
+    function.emit_return();
+}
+
+void add_add_function(kir::Module& module, const kore::Function* func) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    add_blocks(graph);
+
+    auto body_block = graph.add_block();
+    graph.add_edge(kir::BasicBlock::StartBlockId, body_block);
+
+    graph.set_current_block(body_block);
+    Reg a_reg = function.allocate_register();
+    Reg b_reg = function.allocate_register();
+    Reg result_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::AddI32, result_reg, a_reg, b_reg);
+    function.emit_return({ result_reg });
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 10000000;
+
+    kir::Kir kir;
+    kir::Module module(0, "calls.kore");
+
+    // KIR functions not backed by an AST function are main functions
+    kore::Function add(
+        false,
+        Token(TokenType::Identifier, SourceLocation::unknown, "add")
+    );
+
+    add_main_function(module, iterations);
+    add_add_function(module, &add);
+    kir.add_module(module);
+
+    BytecodeGenerator2 code_generator;
+    auto buffer = code_generator.generate(kir);
+    std::istringstream iss(std::string(buffer.cbegin(), buffer.cend()));
+    auto loaded_module = load_module_from_stream(iss);
+
+    vm::Vm vm;
+    auto start = std::chrono::steady_clock::now();
+    vm.run_module(loaded_module);
+    auto end = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(end - start).count();
+
+    std::cout << std::fixed << std::setprecision(3)
+              << iterations << " calls in " << seconds << "s" << std::endl
+              << std::setprecision(1)
+              << (iterations / seconds / 1e6) << "M calls/s" << std::endl;
+
+    return 0;
+}
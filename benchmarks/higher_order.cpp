@@ -0,0 +1,192 @@
+// Benchmark of calls through function values passed to a higher-order
+// function. The KIR is constructed by hand in the same shape the KIR
+// lowering pass generates for
+//
+//     func inc(x i32) i32 {
+//         return x + 1
+//     }
+//
+//     func identity(x i32) i32 {
+//         return x
+//     }
+//
+//     func apply(f func(i32) i32, x i32) i32 {
+//         return f(x)
+//     }
+//
+//     var i = 0
+//
+//     while i < iterations {
+//         i = apply(inc, i)
+//         i = apply(identity, i) // Only when polymorphic
+//     }
+//
+// and is then compiled to bytecode, loaded and run like any other module.
+// The call site in apply stays monomorphic and hits its inline cache unless
+// apply is also passed identity.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ast/scanner/token.hpp"
+#include "ast/statements/function.hpp"
+#include "targets/bytecode/codegen/bytecode_codegen2.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/vm/vm.hpp"
+
+using namespace kore;
+
+const int apply_index = 1;
+const int inc_index = 2;
+const int identity_index = 3;
+
+void add_blocks(kir::Graph& graph) {
+    graph.add_block(kir::BasicBlock::StartBlockId);
+    graph.add_block(kir::BasicBlock::EndBlockId);
+}
+
+void emit_apply_call(kir::Function& function, Reg counter_reg, int func_index) {
+    auto arg_regs = function.allocate_registers(2);
+    Reg func_reg = function.emit_load_function(func_index, Bytecode::LoadFunction);
+    function.emit_move(arg_regs[0], func_reg);
+    function.emit_move(arg_regs[1], counter_reg);
+    Reg apply_reg = function.emit_load_function(apply_index, Bytecode::LoadFunction);
+    function.emit_call(apply_reg, arg_regs[0], arg_regs, { arg_regs[0] });
+    function.emit_move(counter_reg, arg_regs[0]);
+}
+
+void add_main_function(kir::Module& module, int iterations, bool polymorphic) {
+    auto& function = module[module.add_function(nullptr)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto init_block = graph.add_block();
+    auto loop_block = graph.add_block();
+    auto body_block = graph.add_block();
+    auto exit_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, init_block);
+    graph.add_edge(init_block, loop_block);
+    graph.add_edge(loop_block, body_block);
+    graph.add_edge(loop_block, exit_block);
+
+    graph.set_current_block(init_block);
+    Reg counter_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg iterations_reg = function.emit_load(Bytecode::Cload, constants.add(iterations));
+
+    graph.set_current_block(loop_block);
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LtI32, cond_reg, counter_reg, iterations_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, exit_block);
+
+    graph.set_current_block(body_block);
+    emit_apply_call(function, counter_reg, inc_index);
+
+    if (polymorphic) {
+        emit_apply_call(function, counter_reg, identity_index);
+    }
+
+    function.emit_unconditional_jump(loop_block);
+
+    graph.set_current_block(exit_block);
+    function.emit_return();
+}
+
+void add_apply_function(kir::Module& module, const kore::Function* func) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    add_blocks(graph);
+
+    auto body_block = graph.add_block();
+    graph.add_edge(kir::BasicBlock::StartBlockId, body_block);
+
+    graph.set_current_block(body_block);
+    Reg f_reg = function.allocate_register();
+    Reg x_reg = function.allocate_register();
+    auto arg_regs = function.allocate_registers(1);
+    function.emit_move(arg_regs[0], x_reg);
+    function.emit_call(f_reg, arg_regs[0], arg_regs, { arg_regs[0] });
+    function.emit_return({ arg_regs[0] });
+}
+
+void add_inc_function(kir::Module& module, const kore::Function* func) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto body_block = graph.add_block();
+    graph.add_edge(kir::BasicBlock::StartBlockId, body_block);
+
+    graph.set_current_block(body_block);
+    Reg x_reg = function.allocate_register();
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    Reg result_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::AddI32, result_reg, x_reg, one_reg);
+    function.emit_return({ result_reg });
+}
+
+void add_identity_function(kir::Module& module, const kore::Function* func) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    add_blocks(graph);
+
+    auto body_block = graph.add_block();
+    graph.add_edge(kir::BasicBlock::StartBlockId, body_block);
+
+    graph.set_current_block(body_block);
+    Reg x_reg = function.allocate_register();
+    function.emit_return({ x_reg });
+}
+
+void run_benchmark(int iterations, bool polymorphic) {
+    kir::Kir kir;
+    kir::Module module(0, "higher_order.kore");
+
+    // KIR functions not backed by an AST function are main functions
+    kore::Function apply(false, Token(TokenType::Identifier, SourceLocation::unknown, "apply"));
+    kore::Function inc(false, Token(TokenType::Identifier, SourceLocation::unknown, "inc"));
+    kore::Function identity(false, Token(TokenType::Identifier, SourceLocation::unknown, "identity"));
+
+    add_main_function(module, iterations, polymorphic);
+    add_apply_function(module, &apply);
+    add_inc_function(module, &inc);
+    add_identity_function(module, &identity);
+    kir.add_module(module);
+
+    BytecodeGenerator2 code_generator;
+    auto buffer = code_generator.generate(kir);
+    std::istringstream iss(std::string(buffer.cbegin(), buffer.cend()));
+    auto loaded_module = load_module_from_stream(iss);
+
+    vm::Vm vm;
+    auto start = std::chrono::steady_clock::now();
+    vm.run_module(loaded_module);
+    auto end = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(end - start).count();
+    std::uint64_t calls = (polymorphic ? 4 : 2) * static_cast<std::uint64_t>(iterations);
+
+    std::cout << (polymorphic ? "polymorphic:" : "monomorphic:") << std::endl
+              << std::fixed << std::setprecision(3)
+              << calls << " calls in " << seconds << "s" << std::endl
+              << std::setprecision(1)
+              << (calls / seconds / 1e6) << "M calls/s" << std::endl;
+
+    vm.dump_inline_cache_stats(std::cout);
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 5000000;
+
+    run_benchmark(iterations, false);
+    run_benchmark(iterations, true);
+
+    return 0;
+}
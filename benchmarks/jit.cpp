@@ -0,0 +1,198 @@
+// Benchmark of a loop-heavy function run by the interpreter and compiled to
+// native code by the jit. The KIR is constructed by hand in the same shape
+// the KIR lowering pass generates for
+//
+//     func sum(n i32) i32 {
+//         var total = 0
+//         var i = 0
+//
+//         while i < n {
+//             total = total + i
+//             i = i + 1
+//         }
+//
+//         return total
+//     }
+//
+//     var i = 0
+//     var total = 0
+//
+//     while i < iterations {
+//         total = sum(n)
+//         i = i + 1
+//     }
+//
+//     print(total)
+//
+// and superinstructions are selected by the peephole optimiser before it is
+// compiled to bytecode, loaded and run like any other module.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ast/scanner/token.hpp"
+#include "ast/statements/function.hpp"
+#include "targets/bytecode/codegen/bytecode_codegen2.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/codegen/kir/peephole_optimiser.hpp"
+#include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "targets/bytecode/vm/vm.hpp"
+
+using namespace kore;
+
+struct BenchmarkResult {
+    std::uint64_t dispatch_count;
+    double seconds;
+};
+
+void add_blocks(kir::Graph& graph) {
+    graph.add_block(kir::BasicBlock::StartBlockId);
+    graph.add_block(kir::BasicBlock::EndBlockId);
+}
+
+void add_main_function(kir::Module& module, int iterations, int n) {
+    auto& function = module[module.add_function(nullptr)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto init_block = graph.add_block();
+    auto loop_block = graph.add_block();
+    auto body_block = graph.add_block();
+    auto exit_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, init_block);
+    graph.add_edge(init_block, loop_block);
+    graph.add_edge(loop_block, body_block);
+    graph.add_edge(loop_block, exit_block);
+
+    graph.set_current_block(init_block);
+    Reg counter_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg total_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg iterations_reg = function.emit_load(Bytecode::Cload, constants.add(iterations));
+
+    graph.set_current_block(loop_block);
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LtI32, cond_reg, counter_reg, iterations_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, exit_block);
+
+    graph.set_current_block(body_block);
+    Reg n_reg = function.emit_load(Bytecode::Cload, constants.add(n));
+    Reg func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+    function.emit_call(func_reg, n_reg, { n_reg }, { n_reg });
+    function.emit_move(total_reg, n_reg);
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    function.emit_reg3(Bytecode::AddI32, counter_reg, counter_reg, one_reg);
+    function.emit_unconditional_jump(loop_block);
+
+    graph.set_current_block(exit_block);
+    auto print = vm::get_builtin_function_by_name("print");
+    Reg print_reg = function.emit_load_function(print->index, Bytecode::LoadBuiltin);
+    Reg arg_reg = function.allocate_register();
+    function.emit_move(arg_reg, total_reg);
+    function.emit_call(print_reg, arg_reg, { arg_reg }, {});
+    function.emit_return();
+}
+
+void add_sum_function(kir::Module& module, const kore::Function* func) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto init_block = graph.add_block();
+    auto loop_block = graph.add_block();
+    auto body_block = graph.add_block();
+    auto exit_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, init_block);
+    graph.add_edge(init_block, loop_block);
+    graph.add_edge(loop_block, body_block);
+    graph.add_edge(loop_block, exit_block);
+
+    graph.set_current_block(init_block);
+    Reg n_reg = function.allocate_register();
+    Reg total_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg counter_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+
+    graph.set_current_block(loop_block);
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LtI32, cond_reg, counter_reg, n_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, exit_block);
+
+    graph.set_current_block(body_block);
+    function.emit_reg3(Bytecode::AddI32, total_reg, total_reg, counter_reg);
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    function.emit_reg3(Bytecode::AddI32, counter_reg, counter_reg, one_reg);
+    function.emit_unconditional_jump(loop_block);
+
+    graph.set_current_block(exit_block);
+    function.emit_return({ total_reg });
+}
+
+BenchmarkResult run_benchmark(int iterations, int n, bool jit) {
+    kir::Kir kir;
+    kir::Module module(0, "sum.kore");
+
+    // KIR functions not backed by an AST function are main functions
+    kore::Function sum(
+        false,
+        Token(TokenType::Identifier, SourceLocation::unknown, "sum")
+    );
+
+    add_main_function(module, iterations, n);
+    add_sum_function(module, &sum);
+
+    kir::PeepholeOptimiser optimiser;
+    optimiser.optimise(module);
+    kir.add_module(module);
+
+    BytecodeGenerator2 code_generator;
+    auto buffer = code_generator.generate(kir);
+    std::istringstream iss(std::string(buffer.cbegin(), buffer.cend()));
+    auto loaded_module = load_module_from_stream(iss);
+
+    vm::Vm vm;
+
+    if (jit && !vm.enable_jit()) {
+        std::cerr << "jit is not supported on this platform" << std::endl;
+        std::exit(1);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    vm.run_module(loaded_module);
+    auto end = std::chrono::steady_clock::now();
+
+    if (jit) {
+        vm.dump_tier_stats(std::cout);
+    }
+
+    return BenchmarkResult{
+        vm.dispatch_count(),
+        std::chrono::duration<double>(end - start).count(),
+    };
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int n = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+    std::cout << "sum(" << n << ") x " << iterations << std::endl;
+
+    auto interpreted = run_benchmark(iterations, n, false);
+    auto jitted = run_benchmark(iterations, n, true);
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "interpreter: " << interpreted.dispatch_count << " dispatches, "
+              << interpreted.seconds << "s" << std::endl
+              << "jit:         " << jitted.dispatch_count << " dispatches, "
+              << jitted.seconds << "s" << std::endl
+              << std::setprecision(1)
+              << "speedup:     " << interpreted.seconds / jitted.seconds << "x" << std::endl;
+
+    return 0;
+}
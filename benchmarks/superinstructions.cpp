@@ -0,0 +1,180 @@
+// Benchmark of the number of instructions dispatched by the vm when running a
+// recursive factorial function (see tests/factorial.kore) with and without
+// the superinstructions selected by the peephole optimiser.
+//
+// The KIR is constructed by hand in the same shape the KIR lowering pass
+// generates for
+//
+//     func factorial(n i32) i32 {
+//         if n <= 1 { return n }
+//
+//         return n * factorial(n - 1)
+//     }
+//
+//     var i = 0
+//
+//     while i < iterations {
+//         factorial(n)
+//         i = i + 1
+//     }
+//
+// and is then compiled to bytecode, loaded and run like any other module.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ast/scanner/token.hpp"
+#include "ast/statements/function.hpp"
+#include "targets/bytecode/codegen/bytecode_codegen2.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/codegen/kir/peephole_optimiser.hpp"
+#include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/vm/vm.hpp"
+
+using namespace kore;
+
+struct BenchmarkResult {
+    std::uint64_t dispatch_count;
+    double seconds;
+    int fused_count;
+};
+
+void add_blocks(kir::Graph& graph) {
+    graph.add_block(kir::BasicBlock::StartBlockId);
+    graph.add_block(kir::BasicBlock::EndBlockId);
+}
+
+void add_main_function(kir::Module& module, int iterations, int n) {
+    auto& function = module[module.add_function(nullptr)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto init_block = graph.add_block();
+    auto loop_block = graph.add_block();
+    auto body_block = graph.add_block();
+    auto exit_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, init_block);
+    graph.add_edge(init_block, loop_block);
+    graph.add_edge(loop_block, body_block);
+    graph.add_edge(loop_block, exit_block);
+
+    graph.set_current_block(init_block);
+    Reg counter_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg iterations_reg = function.emit_load(Bytecode::Cload, constants.add(iterations));
+
+    graph.set_current_block(loop_block);
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LtI32, cond_reg, counter_reg, iterations_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, exit_block);
+
+    graph.set_current_block(body_block);
+    Reg n_reg = function.emit_load(Bytecode::Cload, constants.add(n));
+    Reg func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+    function.emit_call(func_reg, n_reg, { n_reg }, { n_reg });
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    function.emit_reg3(Bytecode::AddI32, counter_reg, counter_reg, one_reg);
+    function.emit_unconditional_jump(loop_block);
+
+    graph.set_current_block(exit_block);
+    function.emit_return();
+}
+
+void add_factorial_function(kir::Module& module, const kore::Function* func) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto cond_block = graph.add_block();
+    auto base_block = graph.add_block();
+    auto recursive_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, cond_block);
+    graph.add_edge(cond_block, base_block);
+    graph.add_edge(cond_block, recursive_block);
+
+    graph.set_current_block(cond_block);
+    Reg n_reg = function.allocate_register();
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LeI32, cond_reg, n_reg, one_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, recursive_block);
+
+    graph.set_current_block(base_block);
+    function.emit_return({ n_reg });
+
+    graph.set_current_block(recursive_block);
+    Reg one_reg2 = function.emit_load(Bytecode::Cload, constants.add(1));
+    Reg arg_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::SubI32, arg_reg, n_reg, one_reg2);
+    Reg func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+    function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+    Reg result_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::MultI32, result_reg, n_reg, arg_reg);
+    function.emit_return({ result_reg });
+}
+
+BenchmarkResult run_benchmark(int iterations, int n, bool superinstructions) {
+    kir::Kir kir;
+    kir::Module module(0, "factorial.kore");
+    int fused_count = 0;
+
+    // KIR functions not backed by an AST function are main functions
+    kore::Function factorial(
+        false,
+        Token(TokenType::Identifier, SourceLocation::unknown, "factorial")
+    );
+
+    add_main_function(module, iterations, n);
+    add_factorial_function(module, &factorial);
+
+    if (superinstructions) {
+        kir::PeepholeOptimiser optimiser;
+        optimiser.optimise(module);
+        fused_count = optimiser.fused_count();
+    }
+
+    kir.add_module(module);
+
+    BytecodeGenerator2 code_generator;
+    auto buffer = code_generator.generate(kir);
+    std::istringstream iss(std::string(buffer.cbegin(), buffer.cend()));
+    auto loaded_module = load_module_from_stream(iss);
+
+    vm::Vm vm;
+    auto start = std::chrono::steady_clock::now();
+    vm.run_module(loaded_module);
+    auto end = std::chrono::steady_clock::now();
+
+    return BenchmarkResult{
+        vm.dispatch_count(),
+        std::chrono::duration<double>(end - start).count(),
+        fused_count,
+    };
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+    int n = argc > 2 ? std::atoi(argv[2]) : 12;
+
+    std::cout << "factorial(" << n << ") x " << iterations << std::endl;
+
+    auto baseline = run_benchmark(iterations, n, false);
+    auto fused = run_benchmark(iterations, n, true);
+    auto reduction = 100.0 * (1.0 - double(fused.dispatch_count) / baseline.dispatch_count);
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "baseline:          " << baseline.dispatch_count << " dispatches, "
+              << baseline.seconds << "s" << std::endl
+              << "superinstructions: " << fused.dispatch_count << " dispatches, "
+              << fused.seconds << "s (" << fused.fused_count << " fused)" << std::endl
+              << std::setprecision(1)
+              << "reduction:         " << reduction << "%" << std::endl;
+
+    return 0;
+}
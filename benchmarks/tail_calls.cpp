@@ -0,0 +1,137 @@
+// Benchmark of deep recursion with and without tail calls. The KIR is
+// constructed by hand in the same shape the KIR lowering pass generates for
+//
+//     func countdown(n i32) i32 {
+//         if n <= 0 { return n }
+//
+//         return countdown(n - 1)
+//     }
+//
+//     print(countdown(depth))
+//
+// where the recursive call is either an ordinary call followed by a return
+// or a tail call. Ordinary calls push a call frame per level of recursion
+// and eventually overflow the register stack while tail calls run in
+// constant stack space.
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include "ast/scanner/token.hpp"
+#include "ast/statements/function.hpp"
+#include "targets/bytecode/codegen/bytecode_codegen2.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "targets/bytecode/vm/vm.hpp"
+
+using namespace kore;
+
+void add_blocks(kir::Graph& graph) {
+    graph.add_block(kir::BasicBlock::StartBlockId);
+    graph.add_block(kir::BasicBlock::EndBlockId);
+}
+
+void add_main_function(kir::Module& module, int depth) {
+    auto& function = module[module.add_function(nullptr)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto body_block = graph.add_block();
+    graph.add_edge(kir::BasicBlock::StartBlockId, body_block);
+
+    graph.set_current_block(body_block);
+    Reg depth_reg = function.emit_load(Bytecode::Cload, constants.add(depth));
+    Reg func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+    function.emit_call(func_reg, depth_reg, { depth_reg }, { depth_reg });
+
+    auto print = vm::get_builtin_function_by_name("print");
+    Reg print_reg = function.emit_load_function(print->index, Bytecode::LoadBuiltin);
+    function.emit_call(print_reg, depth_reg, { depth_reg }, {});
+    function.emit_return();
+}
+
+void add_countdown_function(kir::Module& module, const kore::Function* func, bool tail_calls) {
+    auto& function = module[module.add_function(func)];
+    auto& graph = function.graph();
+    auto& constants = module.constant_table();
+    add_blocks(graph);
+
+    auto cond_block = graph.add_block();
+    auto base_block = graph.add_block();
+    auto recursive_block = graph.add_block();
+
+    graph.add_edge(kir::BasicBlock::StartBlockId, cond_block);
+    graph.add_edge(cond_block, base_block);
+    graph.add_edge(cond_block, recursive_block);
+
+    graph.set_current_block(cond_block);
+    Reg n_reg = function.allocate_register();
+    Reg zero_reg = function.emit_load(Bytecode::Cload, constants.add(0));
+    Reg cond_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::LeI32, cond_reg, n_reg, zero_reg);
+    function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, recursive_block);
+
+    graph.set_current_block(base_block);
+    function.emit_return({ n_reg });
+
+    graph.set_current_block(recursive_block);
+    Reg one_reg = function.emit_load(Bytecode::Cload, constants.add(1));
+    Reg arg_reg = function.allocate_register();
+    function.emit_reg3(Bytecode::SubI32, arg_reg, n_reg, one_reg);
+    Reg func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+
+    if (tail_calls) {
+        function.emit_tail_call(func_reg, arg_reg, { arg_reg });
+    } else {
+        function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+        function.emit_return({ arg_reg });
+    }
+}
+
+double run_benchmark(int depth, bool tail_calls) {
+    kir::Kir kir;
+    kir::Module module(0, "countdown.kore");
+
+    // KIR functions not backed by an AST function are main functions
+    kore::Function countdown(
+        false,
+        Token(TokenType::Identifier, SourceLocation::unknown, "countdown")
+    );
+
+    add_main_function(module, depth);
+    add_countdown_function(module, &countdown, tail_calls);
+    kir.add_module(module);
+
+    BytecodeGenerator2 code_generator;
+    auto buffer = code_generator.generate(kir);
+    std::istringstream iss(std::string(buffer.cbegin(), buffer.cend()));
+    auto loaded_module = load_module_from_stream(iss);
+
+    vm::Vm vm;
+    auto start = std::chrono::steady_clock::now();
+    vm.run_module(loaded_module);
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+    int depth = argc > 1 ? std::atoi(argv[1]) : 10000000;
+
+    std::cout << "countdown(" << depth << ")" << std::endl;
+
+    std::cout << "calls:" << std::endl;
+    auto seconds = run_benchmark(depth, false);
+    std::cout << std::fixed << std::setprecision(3) << seconds << "s" << std::endl;
+
+    std::cout << "tail calls:" << std::endl;
+    seconds = run_benchmark(depth, true);
+    std::cout << std::fixed << std::setprecision(3) << seconds << "s" << std::endl;
+
+    return 0;
+}
@@ -14,6 +14,8 @@ namespace kore {
             SourceLocation(int lnum, int start_col, int end_col);
             virtual ~SourceLocation();
 
+            SourceLocation& operator=(const SourceLocation& location) = default;
+
             int lnum() const noexcept;
             int start() const noexcept;
             int end() const noexcept;
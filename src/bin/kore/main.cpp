@@ -1,4 +1,5 @@
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <string>
@@ -39,8 +40,87 @@ namespace kore {
             }
 
             vm::Vm vm;
+
+            if (args.tier_threshold > 0) {
+                vm.enable_tiering(args.tier_threshold);
+            } else if (args.tier_stats) {
+                vm.enable_tiering();
+            }
+
+            if (args.jit && !vm.enable_jit()) {
+                kore::warn("jit is not supported on this platform");
+            }
+
+            bool profile = args.profile || !args.profile_json_path.empty();
+
+            if (profile && !vm.enable_profiler()) {
+                kore::warn("vm was built without profiling support (KORE_VM_PROFILER)");
+                profile = false;
+            }
+
+            if (!args.sample_path.empty()) {
+                vm.enable_sampling(
+                    args.sample_frequency > 0 ? args.sample_frequency : vm::KORE_VM_SAMPLING_FREQUENCY,
+                    args.sample_pcs
+                );
+            }
+
+            if (args.heap_limit > 0) {
+                vm.set_heap_limit(static_cast<std::size_t>(args.heap_limit) << 20);
+            }
+
+            if (args.gc_stress) {
+                vm.enable_gc_stress();
+            }
+
             vm.run_path(args.path);
 
+            if (profile && args.profile) {
+                vm.dump_profile(std::cerr);
+            }
+
+            if (profile && !args.profile_json_path.empty()) {
+                std::ofstream ofs(args.profile_json_path);
+
+                if (!ofs) {
+                    kore::error("failed to write profile to '%s'", args.profile_json_path.c_str());
+                    return 1;
+                }
+
+                vm.dump_profile_json(ofs);
+            }
+
+            if (!args.sample_path.empty()) {
+                std::ofstream ofs(args.sample_path);
+
+                if (!ofs) {
+                    kore::error("failed to write samples to '%s'", args.sample_path.c_str());
+                    return 1;
+                }
+
+                vm.dump_samples(ofs);
+            }
+
+            if (args.tier_stats) {
+                vm.dump_tier_stats(std::cerr);
+            }
+
+            if (args.inline_cache_stats) {
+                vm.dump_inline_cache_stats(std::cerr);
+            }
+
+            if (args.load_stats) {
+                vm.dump_load_stats(std::cerr);
+            }
+
+            if (args.gc_stats) {
+                vm.dump_gc_stats(std::cerr);
+            }
+
+            if (args.dump_code) {
+                vm.dump_code(std::cerr);
+            }
+
             if (args.dump_registers) {
                 info_group("vm", "dumping registers");
                 vm.dump_registers(std::cerr);
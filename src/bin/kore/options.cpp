@@ -1,4 +1,5 @@
 #include <iostream>
+#include <stdexcept>
 
 #include "logging/logging.hpp"
 #include "options.hpp"
@@ -22,8 +23,65 @@ namespace kore {
         --version-only    Show the current version number only.
         --dump-registers  Dump all registers of the last call frame once
                           the vm is done executing
+        --jit             Compile hot functions to native machine code
+                          when they are tiered up (x86-64 only)
+        --tier-threshold=<n>
+                          Tier up functions after n calls or n backward
+                          jumps. Enables tiering [100]
+        --tier-stats      Show tier-up statistics once the vm is done
+                          executing. Enables tiering
+        --inline-cache-stats
+                          Show inline cache hits and misses of all call
+                          sites once the vm is done executing
+        --load-stats      Show how many functions were materialized, i.e.
+                          decoded because they were used, once the vm is
+                          done executing
+        --profile         Show instruction counts per opcode and per
+                          function and time spent in each function once
+                          the vm is done executing. Only instructions run
+                          by the interpreter are counted. Requires a vm
+                          built with KORE_VM_PROFILER
+        --profile-json=<path>
+                          Also write the profile as JSON to a file
+        --sample=<path>   Sample the call stack while running and write the
+                          samples as folded stacks for flame graph tools
+                          to a file
+        --sample-frequency=<hz>
+                          Number of samples per second of cpu time [1000]
+        --sample-pcs      Include the program counter and source line of
+                          each function in the sampled call stacks
+        --dump-code       Dump the decoded code of all functions once the
+                          vm is done executing, including call
+                          instructions quickened at run time
+        --heap-limit=<mb> Maximum size of all arrays in megabytes. Running
+                          out of memory is an error [4096]
+        --gc-stats        Show the number of garbage collections, their
+                          pause times and how much they freed once the vm
+                          is done executing
+        --gc-stress       Collect garbage on every allocation. Slow, only
+                          used to test the garbage collector
     )";
 
+    bool parse_positive_integer(const std::string& value, std::uint32_t& result) {
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+            return false;
+        }
+
+        try {
+            auto parsed = std::stoul(value);
+
+            if (parsed == 0 || parsed > UINT32_MAX) {
+                return false;
+            }
+
+            result = static_cast<std::uint32_t>(parsed);
+        } catch (const std::out_of_range&) {
+            return false;
+        }
+
+        return true;
+    }
+
     ParsedCommandLineArgs parse_commandline(int argc, char** args) {
         auto parsed_args = ParsedCommandLineArgs{};
 
@@ -47,6 +105,60 @@ namespace kore {
                     parsed_args.version_only = true;
                 } else if (arg == "--dump-registers") {
                     parsed_args.dump_registers = true;
+                } else if (arg == "--jit") {
+                    parsed_args.jit = true;
+                } else if (arg.rfind("--tier-threshold=", 0) == 0) {
+                    auto value = arg.substr(arg.find('=') + 1);
+
+                    if (!parse_positive_integer(value, parsed_args.tier_threshold)) {
+                        parsed_args.error_message = "Invalid tier threshold '" + value + "'";
+                        return parsed_args;
+                    }
+                } else if (arg == "--tier-stats") {
+                    parsed_args.tier_stats = true;
+                } else if (arg == "--inline-cache-stats") {
+                    parsed_args.inline_cache_stats = true;
+                } else if (arg == "--load-stats") {
+                    parsed_args.load_stats = true;
+                } else if (arg == "--profile") {
+                    parsed_args.profile = true;
+                } else if (arg.rfind("--profile-json=", 0) == 0) {
+                    parsed_args.profile_json_path = arg.substr(arg.find('=') + 1);
+
+                    if (parsed_args.profile_json_path.empty()) {
+                        parsed_args.error_message = "Missing path for --profile-json";
+                        return parsed_args;
+                    }
+                } else if (arg.rfind("--sample=", 0) == 0) {
+                    parsed_args.sample_path = arg.substr(arg.find('=') + 1);
+
+                    if (parsed_args.sample_path.empty()) {
+                        parsed_args.error_message = "Missing path for --sample";
+                        return parsed_args;
+                    }
+                } else if (arg.rfind("--sample-frequency=", 0) == 0) {
+                    auto value = arg.substr(arg.find('=') + 1);
+
+                    if (!parse_positive_integer(value, parsed_args.sample_frequency)
+                        || parsed_args.sample_frequency > 1000000) {
+                        parsed_args.error_message = "Invalid sample frequency '" + value + "'";
+                        return parsed_args;
+                    }
+                } else if (arg == "--sample-pcs") {
+                    parsed_args.sample_pcs = true;
+                } else if (arg == "--dump-code") {
+                    parsed_args.dump_code = true;
+                } else if (arg.rfind("--heap-limit=", 0) == 0) {
+                    auto value = arg.substr(arg.find('=') + 1);
+
+                    if (!parse_positive_integer(value, parsed_args.heap_limit)) {
+                        parsed_args.error_message = "Invalid heap limit '" + value + "'";
+                        return parsed_args;
+                    }
+                } else if (arg == "--gc-stats") {
+                    parsed_args.gc_stats = true;
+                } else if (arg == "--gc-stress") {
+                    parsed_args.gc_stress = true;
                 } else if (arg == "--") {
                     seen_double_dash = true;
                 } else {
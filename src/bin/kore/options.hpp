@@ -1,6 +1,7 @@
 #ifndef KORE_OPTIONS_HPP
 #define KORE_OPTIONS_HPP
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -16,6 +17,30 @@ namespace kore {
         bool help;
         bool repl_mode;
         bool dump_registers;
+        bool jit;
+        bool tier_stats;
+        bool inline_cache_stats;
+        bool load_stats;
+        bool dump_code;
+        bool profile;
+        bool gc_stats;
+        bool gc_stress;
+
+        // Empty if not given
+        fs::path profile_json_path;
+
+        // Empty if not given
+        fs::path sample_path;
+
+        // Zero if not given
+        std::uint32_t sample_frequency;
+        bool sample_pcs;
+
+        // Zero if not given
+        std::uint32_t tier_threshold;
+
+        // Heap limit in megabytes, zero if not given
+        std::uint32_t heap_limit;
 
         fs::path path;
     };
@@ -33,6 +33,8 @@ Options:
                                 applicable when --target is 'bytecode'.
     --typecheck-only            Only perform type checking, then exit.
     -m, --mem-stats             Show useful memory statistics while running.
+    --bytecode-v1               Write the version 1 bytecode format instead
+                                of the sectioned version 2 format.
 
     Debugging options:
 
@@ -172,6 +174,8 @@ Options:
                     parsed_args.colors = true;
                 } else if (arg == "--typecheck-only") {
                     parsed_args.typecheck_only = true;
+                } else if (arg == "--bytecode-v1") {
+                    parsed_args.bytecode_v1 = true;
                 } else if (arg == "--target") {
                     if (i + 1 < args.size()) {
                         parsed_args.target = args[i + 1];
@@ -46,6 +46,7 @@ namespace kore {
         bool compile_only = false;
         bool typecheck_only = false;
         bool mem_stats = false;
+        bool bytecode_v1 = false;
 
         std::string expr;
         std::vector<fs::path> paths;
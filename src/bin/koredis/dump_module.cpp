@@ -100,7 +100,22 @@ namespace koredis {
 
         auto longest_instruction_len = kore::bytecode_to_string(longest_instruction->value.opcode).size();
 
-        for (auto instruction : decoded_instructions) {
+        auto location = kore::SourceLocation::unknown;
+
+        for (std::size_t pc = 0; pc < decoded_instructions.size(); ++pc) {
+            auto instruction = decoded_instructions[pc];
+
+            // Show the source line before the first instruction generated
+            // for it
+            auto instruction_location = obj.source_location(pc);
+
+            if (!instruction_location.is_unknown()
+                && instruction_location.lnum() != location.lnum()) {
+                os << "  ; line " << instruction_location.colon_format() << std::endl;
+            }
+
+            location = instruction_location;
+
             os << dump_config.opcode_color_spec << "  " << attr_reset
                << std::left << std::setw(4)
                << instruction.byte_pos
@@ -116,6 +131,36 @@ namespace koredis {
         os << std::endl;
     }
 
+    void dump_container(
+        std::ostream& os,
+        const kore::BytecodeContainer& container,
+        const DumpConfig& dump_config
+    ) {
+        auto byte_order = container.header().byte_order == kore::ByteOrder::Big ? "big" : "little";
+
+        os << dump_config.version_color_spec << "byte order: "
+           << kore::ColorAttribute::Reset << byte_order << " endian"
+           << std::endl << std::endl;
+
+        kore::section(
+            "sections",
+            dump_config.section_color_spec,
+            0,
+            "%d",
+            static_cast<int>(container.sections().size())
+        );
+
+        for (auto& section : container.sections()) {
+            os << " " << std::left << std::setw(12)
+               << kore::section_kind_to_string(section.kind)
+               << " offset " << std::setw(8) << section.offset
+               << " size " << section.size
+               << std::right << std::endl;
+        }
+
+        os << std::endl;
+    }
+
     void dump_module(std::ostream& os, kore::Module& module, const DumpConfig& dump_config) {
         kore::Version compiler_version = module.get_compiler_version();
         kore::Version bytecode_version = module.get_bytecode_version();
@@ -2,6 +2,7 @@
 #define KOREDIS_DUMP_MODULE_HPP
 
 #include "logging/color_spec.hpp"
+#include "targets/bytecode/bytecode_container.hpp"
 #include "targets/bytecode/module.hpp"
 
 #include <ostream>
@@ -16,6 +17,13 @@ namespace koredis {
         kore::ColorSpec version_color_spec;
     };
 
+    /// Dump the byte order and section directory of a version 2 file
+    void dump_container(
+        std::ostream& os,
+        const kore::BytecodeContainer& container,
+        const DumpConfig& config
+    );
+
     void dump_module(std::ostream& os, kore::Module& module, const DumpConfig& config);
 }
 
@@ -4,9 +4,11 @@
 #include "logging/logging.hpp"
 #include "options.hpp"
 #include "dump_module.hpp"
+#include "targets/bytecode/bytecode_container.hpp"
 #include "targets/bytecode/module_load_error.hpp"
 #include "targets/bytecode/module.hpp"
 #include "targets/bytecode/module_loader.hpp"
+#include "utils/mapped_file.hpp"
 #include "version.hpp"
 
 namespace koredis {
@@ -34,6 +36,7 @@ namespace koredis {
 
             try {
                 kore::Module module = kore::load_module_from_path(path);
+                module.materialize_all();
 
                 const DumpConfig dump_config{
                     args.colors,
@@ -44,6 +47,13 @@ namespace koredis {
                     { kore::Color::White }
                 };
 
+                kore::MappedFile file(path);
+
+                if (kore::BytecodeContainer::is_container(file.data(), file.size())) {
+                    kore::BytecodeContainer container(file.data(), file.size());
+                    dump_container(std::cout, container, dump_config);
+                }
+
                 dump_module(std::cout, module, dump_config);
             } catch (kore::ModuleLoadError& ex) {
                 kore::error("disassembly of '%s' failed: %s", path.c_str(), ex.what());
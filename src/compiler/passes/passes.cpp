@@ -67,7 +67,9 @@ namespace kore {
         return Pass {
             "codegen:bytecode",
             [](PassContext& context) {
-                BytecodeGenerator2 code_generator;
+                BytecodeGenerator2 code_generator(
+                    context.args.bytecode_v1 ? 1 : BytecodeContainer::version
+                );
 
                 context.buffers.push_back(code_generator.generate(context.kir));
 
@@ -103,6 +105,9 @@ namespace kore {
             get_type_inference_pass(),
             get_type_checking_pass(),
             kir::get_kir_lowering_pass(),
+            kir::get_ref_count_optimisation_pass(),
+            kir::get_ownership_analysis_pass(),
+            kir::get_peephole_optimisation_pass(),
             get_bytecode_codegen_pass(),
             get_bytecode_write_pass()
         };
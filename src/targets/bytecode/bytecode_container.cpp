@@ -0,0 +1,438 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "targets/bytecode/bytecode_container.hpp"
+#include "targets/bytecode/module_load_error.hpp"
+#include "utils/endian.hpp"
+
+namespace kore {
+    std::uint32_t swap_bytes32(std::uint32_t value) {
+        return (value << 24)
+            | ((value & 0xff00) << 8)
+            | ((value >> 8) & 0xff00)
+            | (value >> 24);
+    }
+
+    std::uint64_t swap_bytes64(std::uint64_t value) {
+        return static_cast<std::uint64_t>(swap_bytes32(value & 0xffffffff)) << 32
+            | swap_bytes32(value >> 32);
+    }
+
+    std::size_t align_to(std::size_t value, std::size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    /// Check that a range lies within a region of the given size without
+    /// overflowing
+    bool in_bounds(std::uint64_t offset, std::uint64_t size, std::uint64_t region_size) {
+        return offset <= region_size && size <= region_size - offset;
+    }
+
+    std::string section_kind_to_string(SectionKind kind) {
+        switch (kind) {
+            case SectionKind::Strings:    return "strings";
+            case SectionKind::Constants:  return "constants";
+            case SectionKind::Functions:  return "functions";
+            case SectionKind::Code:       return "code";
+            case SectionKind::LineTables: return "line tables";
+            case SectionKind::StackMaps:  return "stack maps";
+        }
+
+        return "<unknown>";
+    }
+
+    ByteOrder host_byte_order() {
+        return is_big_endian() ? ByteOrder::Big : ByteOrder::Little;
+    }
+
+    BytecodeContainer::BytecodeContainer(const std::uint8_t* data, std::size_t size)
+        : _data(data),
+          _size(size) {
+        if (!is_container(data, size)) {
+            throw ModuleLoadError("not a version 2 kore bytecode file", 0);
+        }
+
+        std::memcpy(&_header, data, sizeof(_header));
+
+        if (_header.byte_order != ByteOrder::Little && _header.byte_order != ByteOrder::Big) {
+            throw ModuleLoadError("Unknown byte order", offsetof(ContainerHeader, byte_order));
+        }
+
+        _header.globals_count = to_host(_header.globals_count);
+        _header.module_index = to_host(_header.module_index);
+        _header.path_offset = to_host(_header.path_offset);
+        _header.path_size = to_host(_header.path_size);
+        _header.main_function_index = to_host(_header.main_function_index);
+        _header.section_count = to_host(_header.section_count);
+
+        auto directory_offset = sizeof(ContainerHeader);
+        auto directory_size = static_cast<std::uint64_t>(_header.section_count) * sizeof(SectionEntry);
+
+        if (!in_bounds(directory_offset, directory_size, _size)) {
+            throw ModuleLoadError("Section directory out of bounds", directory_offset);
+        }
+
+        for (std::uint32_t idx = 0; idx < _header.section_count; ++idx) {
+            auto entry_offset = directory_offset + idx * sizeof(SectionEntry);
+            SectionEntry section;
+
+            std::memcpy(&section, _data + entry_offset, sizeof(section));
+            section.kind = static_cast<SectionKind>(to_host(static_cast<std::uint32_t>(section.kind)));
+            section.offset = to_host(section.offset);
+            section.size = to_host(section.size);
+
+            if (section.offset % section_alignment != 0) {
+                throw ModuleLoadError("Misaligned section", entry_offset);
+            }
+
+            if (!in_bounds(section.offset, section.size, _size)) {
+                throw ModuleLoadError("Section out of bounds", entry_offset);
+            }
+
+            _sections.push_back(section);
+        }
+    }
+
+    bool BytecodeContainer::is_container(const std::uint8_t* data, std::size_t size) {
+        if (size < sizeof(ContainerHeader)) {
+            return false;
+        }
+
+        auto header = reinterpret_cast<const char*>(data);
+
+        return std::memcmp(header, "kore", 4) == 0
+            && header[offsetof(ContainerHeader, bytecode_version)] >= version;
+    }
+
+    const ContainerHeader& BytecodeContainer::header() const {
+        return _header;
+    }
+
+    const std::vector<SectionEntry>& BytecodeContainer::sections() const {
+        return _sections;
+    }
+
+    bool BytecodeContainer::is_host_byte_order() const {
+        return _header.byte_order == host_byte_order();
+    }
+
+    std::string BytecodeContainer::path() const {
+        auto bytes = section_range(SectionKind::Strings, _header.path_offset, _header.path_size);
+
+        return std::string(bytes, bytes + _header.path_size);
+    }
+
+    std::size_t BytecodeContainer::constant_count() const {
+        return table_size(SectionKind::Constants, sizeof(ConstantEntry));
+    }
+
+    ConstantEntry BytecodeContainer::constant(std::size_t index) const {
+        ConstantEntry entry;
+        auto bytes = section_range(
+            SectionKind::Constants,
+            index * sizeof(ConstantEntry),
+            sizeof(ConstantEntry)
+        );
+
+        std::memcpy(&entry, bytes, sizeof(entry));
+        entry.tag = to_host(entry.tag);
+        entry.value = to_host(entry.value);
+
+        return entry;
+    }
+
+    std::size_t BytecodeContainer::function_count() const {
+        return table_size(SectionKind::Functions, sizeof(FunctionEntry));
+    }
+
+    FunctionEntry BytecodeContainer::function(std::size_t index) const {
+        FunctionEntry entry;
+        auto bytes = section_range(
+            SectionKind::Functions,
+            index * sizeof(FunctionEntry),
+            sizeof(FunctionEntry)
+        );
+
+        std::memcpy(&entry, bytes, sizeof(entry));
+
+        // Every field is 32 bits wide
+        auto fields = reinterpret_cast<std::uint32_t*>(&entry);
+
+        for (std::size_t idx = 0; idx < sizeof(entry) / sizeof(std::uint32_t); ++idx) {
+            fields[idx] = to_host(fields[idx]);
+        }
+
+        return entry;
+    }
+
+    std::string BytecodeContainer::function_name(const FunctionEntry& entry) const {
+        auto bytes = section_range(SectionKind::Strings, entry.name_offset, entry.name_size);
+
+        return std::string(bytes, bytes + entry.name_size);
+    }
+
+    void BytecodeContainer::check_function(const FunctionEntry& entry) const {
+        function_code(entry);
+
+        if (entry.line_table_size > 0) {
+            section_range(SectionKind::LineTables, entry.line_table_offset, entry.line_table_size);
+        }
+
+        if (has_section(SectionKind::StackMaps)) {
+            stack_map_size(entry);
+        }
+    }
+
+    const std::uint8_t* BytecodeContainer::function_code(const FunctionEntry& entry) const {
+        return section_range(
+            SectionKind::Code,
+            static_cast<std::uint64_t>(entry.code_offset) * sizeof(bytecode_type),
+            static_cast<std::uint64_t>(entry.code_size) * sizeof(bytecode_type)
+        );
+    }
+
+    std::vector<bytecode_type> BytecodeContainer::copy_function_code(const FunctionEntry& entry) const {
+        auto bytes = function_code(entry);
+        std::vector<bytecode_type> code(entry.code_size);
+
+        std::memcpy(code.data(), bytes, code.size() * sizeof(bytecode_type));
+
+        if (!is_host_byte_order()) {
+            for (auto& instruction : code) {
+                instruction = swap_bytes32(instruction);
+            }
+        }
+
+        return code;
+    }
+
+    LineTable BytecodeContainer::function_line_table(const FunctionEntry& entry) const {
+        if (entry.line_table_size == 0) {
+            return LineTable();
+        }
+
+        auto bytes = section_range(
+            SectionKind::LineTables,
+            entry.line_table_offset,
+            entry.line_table_size
+        );
+
+        return LineTable(std::vector<std::uint8_t>(bytes, bytes + entry.line_table_size));
+    }
+
+    StackMap BytecodeContainer::function_stack_map(const FunctionEntry& entry) const {
+        if (!has_section(SectionKind::StackMaps)) {
+            return StackMap();
+        }
+
+        auto size = stack_map_size(entry);
+        auto bytes = section_range(
+            SectionKind::StackMaps,
+            static_cast<std::uint64_t>(entry.stack_map_offset) + sizeof(size),
+            size
+        );
+
+        return StackMap(std::vector<std::uint8_t>(bytes, bytes + size));
+    }
+
+    std::uint32_t BytecodeContainer::to_host(std::uint32_t value) const {
+        return is_host_byte_order() ? value : swap_bytes32(value);
+    }
+
+    std::uint64_t BytecodeContainer::to_host(std::uint64_t value) const {
+        return is_host_byte_order() ? value : swap_bytes64(value);
+    }
+
+    const SectionEntry& BytecodeContainer::get_section(SectionKind kind) const {
+        for (auto& section : _sections) {
+            if (section.kind == kind) {
+                return section;
+            }
+        }
+
+        throw ModuleLoadError("Missing " + section_kind_to_string(kind) + " section");
+    }
+
+    bool BytecodeContainer::has_section(SectionKind kind) const {
+        for (auto& section : _sections) {
+            if (section.kind == kind) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::uint32_t BytecodeContainer::stack_map_size(const FunctionEntry& entry) const {
+        std::uint32_t size;
+        auto bytes = section_range(SectionKind::StackMaps, entry.stack_map_offset, sizeof(size));
+
+        std::memcpy(&size, bytes, sizeof(size));
+        size = to_host(size);
+
+        section_range(
+            SectionKind::StackMaps,
+            static_cast<std::uint64_t>(entry.stack_map_offset) + sizeof(size),
+            size
+        );
+
+        return size;
+    }
+
+    const std::uint8_t* BytecodeContainer::section_range(
+        SectionKind kind,
+        std::uint64_t offset,
+        std::uint64_t size
+    ) const {
+        auto& section = get_section(kind);
+
+        if (!in_bounds(offset, size, section.size)) {
+            throw ModuleLoadError(
+                "Out of bounds of " + section_kind_to_string(kind) + " section",
+                static_cast<std::streamoff>(section.offset + offset)
+            );
+        }
+
+        return _data + section.offset + offset;
+    }
+
+    std::size_t BytecodeContainer::table_size(SectionKind kind, std::size_t entry_size) const {
+        auto& section = get_section(kind);
+
+        if (section.size % entry_size != 0) {
+            throw ModuleLoadError(
+                "Malformed " + section_kind_to_string(kind) + " section",
+                static_cast<std::streamoff>(section.offset)
+            );
+        }
+
+        return section.size / entry_size;
+    }
+
+    BytecodeContainerWriter::BytecodeContainerWriter(
+        std::uint32_t globals_count,
+        std::uint32_t module_index,
+        const std::string& path,
+        std::uint32_t main_function_index
+    ) {
+        std::memset(&_header, 0, sizeof(_header));
+        std::memcpy(_header.magic.data(), "kore", 4);
+        _header.compiler_version = { 1, 0, 0 };
+        _header.bytecode_version = { BytecodeContainer::version, 0, 0 };
+        _header.byte_order = host_byte_order();
+        _header.globals_count = globals_count;
+        _header.module_index = module_index;
+        _header.path_offset = add_string(path);
+        _header.path_size = path.size();
+        _header.main_function_index = main_function_index;
+    }
+
+    void BytecodeContainerWriter::add_constant(const vm::Value& value) {
+        switch (value.tag) {
+            case vm::ValueTag::I32:
+                _constants.push_back(ConstantEntry{
+                    static_cast<std::uint32_t>(value.tag),
+                    static_cast<std::uint32_t>(value.as_i32())
+                });
+                break;
+
+            default:
+                throw std::runtime_error("Unsupported value tag");
+        }
+    }
+
+    void BytecodeContainerWriter::add_function(
+        const std::string& name,
+        const SourceLocation& location,
+        std::uint32_t func_index,
+        std::uint32_t reg_count,
+        const bytecode_type* code,
+        std::size_t code_size,
+        const LineTable& line_table,
+        const StackMap& stack_map
+    ) {
+        FunctionEntry entry;
+        auto& line_table_data = line_table.data();
+        auto& stack_map_data = stack_map.data();
+        auto stack_map_size = static_cast<std::uint32_t>(stack_map_data.size());
+
+        std::memset(&entry, 0, sizeof(entry));
+        entry.name_offset = add_string(name);
+        entry.name_size = name.size();
+        entry.lnum = location.lnum();
+        entry.start = location.start();
+        entry.end = location.end();
+        entry.func_index = func_index;
+        entry.reg_count = reg_count;
+        entry.code_offset = _code.size();
+        entry.code_size = code_size;
+        entry.line_table_offset = _line_tables.size();
+        entry.line_table_size = line_table_data.size();
+        entry.stack_map_offset = _stack_maps.size();
+
+        _functions.push_back(entry);
+        _code.insert(_code.end(), code, code + code_size);
+        _line_tables.insert(_line_tables.end(), line_table_data.cbegin(), line_table_data.cend());
+
+        auto size_bytes = reinterpret_cast<const std::uint8_t*>(&stack_map_size);
+        _stack_maps.insert(_stack_maps.end(), size_bytes, size_bytes + sizeof(stack_map_size));
+        _stack_maps.insert(_stack_maps.end(), stack_map_data.cbegin(), stack_map_data.cend());
+    }
+
+    std::vector<std::uint8_t> BytecodeContainerWriter::write() const {
+        struct Section {
+            SectionKind kind;
+            const void* data;
+            std::size_t size;
+        };
+
+        std::vector<Section> sections{
+            { SectionKind::Strings, _strings.data(), _strings.size() },
+            { SectionKind::Constants, _constants.data(), _constants.size() * sizeof(ConstantEntry) },
+            { SectionKind::Functions, _functions.data(), _functions.size() * sizeof(FunctionEntry) },
+            { SectionKind::Code, _code.data(), _code.size() * sizeof(bytecode_type) },
+            { SectionKind::LineTables, _line_tables.data(), _line_tables.size() },
+            { SectionKind::StackMaps, _stack_maps.data(), _stack_maps.size() },
+        };
+
+        auto header = _header;
+        header.section_count = sections.size();
+
+        std::vector<SectionEntry> directory;
+        auto offset = sizeof(ContainerHeader) + sections.size() * sizeof(SectionEntry);
+
+        for (auto& section : sections) {
+            offset = align_to(offset, BytecodeContainer::section_alignment);
+            directory.push_back(SectionEntry{ section.kind, 0, offset, section.size });
+            offset += section.size;
+        }
+
+        std::vector<std::uint8_t> buffer(offset, 0);
+
+        std::memcpy(buffer.data(), &header, sizeof(header));
+        std::memcpy(
+            buffer.data() + sizeof(header),
+            directory.data(),
+            directory.size() * sizeof(SectionEntry)
+        );
+
+        for (std::size_t idx = 0; idx < sections.size(); ++idx) {
+            if (sections[idx].size > 0) {
+                std::memcpy(
+                    buffer.data() + directory[idx].offset,
+                    sections[idx].data,
+                    sections[idx].size
+                );
+            }
+        }
+
+        return buffer;
+    }
+
+    std::uint32_t BytecodeContainerWriter::add_string(const std::string& str) {
+        auto offset = _strings.size();
+        _strings.insert(_strings.end(), str.cbegin(), str.cend());
+
+        return offset;
+    }
+}
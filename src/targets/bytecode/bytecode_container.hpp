@@ -0,0 +1,233 @@
+#ifndef KORE_BYTECODE_CONTAINER_HPP
+#define KORE_BYTECODE_CONTAINER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ast/source_location.hpp"
+#include "targets/bytecode/codegen/bytecode.hpp"
+#include "targets/bytecode/line_table.hpp"
+#include "targets/bytecode/stack_map.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+
+namespace kore {
+    /// Version 2 of the compiled bytecode format
+    ///
+    /// Whereas version 1 is a big-endian stream that has to be read from
+    /// start to end, version 2 is a container of sections found through a
+    /// section directory following the header. Sections are aligned to
+    /// BytecodeContainer::section_alignment bytes and all numbers, including
+    /// instructions, are stored in the byte order declared in the header
+    /// which is the byte order of the machine that wrote it. Functions are
+    /// described by a fixed-size entry in the function table so a reader can
+    /// find any function without reading the others and, if the byte order
+    /// matches, execute its instructions directly from a mapped file
+    ///
+    /// Layout:
+    ///
+    ///     header
+    ///     section directory (one entry per section)
+    ///     sections (strings, constants, functions, code, line tables,
+    ///               stack maps)
+    ///
+    /// The stack map section is optional. Files written without it are
+    /// still read, but the garbage collector scans the registers of their
+    /// functions conservatively
+    enum class ByteOrder : std::uint8_t {
+        Little = 0,
+        Big = 1,
+    };
+
+    enum class SectionKind : std::uint32_t {
+        Strings = 1,
+        Constants = 2,
+        Functions = 3,
+        Code = 4,
+        LineTables = 5,
+        StackMaps = 6,
+    };
+
+    std::string section_kind_to_string(SectionKind kind);
+
+    struct ContainerHeader {
+        std::array<char, 4> magic;
+        std::array<char, 3> compiler_version;
+        std::array<char, 3> bytecode_version;
+        ByteOrder byte_order;
+        std::uint8_t reserved;
+        std::uint32_t globals_count;
+        std::uint32_t module_index;
+
+        // Module path in the string section
+        std::uint32_t path_offset;
+        std::uint32_t path_size;
+
+        std::uint32_t main_function_index;
+        std::uint32_t section_count;
+        std::uint32_t reserved2;
+    };
+
+    struct SectionEntry {
+        SectionKind kind;
+        std::uint32_t reserved;
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    struct ConstantEntry {
+        std::uint32_t tag;
+        std::uint32_t value;
+    };
+
+    struct FunctionEntry {
+        // Name in the string section
+        std::uint32_t name_offset;
+        std::uint32_t name_size;
+
+        std::int32_t lnum;
+        std::int32_t start;
+        std::int32_t end;
+        std::uint32_t func_index;
+        std::uint32_t reg_count;
+
+        // Instructions in the code section, in words
+        std::uint32_t code_offset;
+        std::uint32_t code_size;
+
+        // Encoded line table in the line table section, in bytes
+        std::uint32_t line_table_offset;
+        std::uint32_t line_table_size;
+
+        // Encoded stack map in the stack map section, in bytes, prefixed
+        // by its size as a 32-bit number
+        std::uint32_t stack_map_offset;
+    };
+
+    static_assert(sizeof(ContainerHeader) == 40, "Unexpected container header size");
+    static_assert(sizeof(SectionEntry) == 24, "Unexpected section entry size");
+    static_assert(sizeof(ConstantEntry) == 8, "Unexpected constant entry size");
+    static_assert(sizeof(FunctionEntry) == 48, "Unexpected function entry size");
+
+    /// Byte order of the machine we are running on
+    ByteOrder host_byte_order();
+
+    /// A version 2 bytecode container read from memory. Reading is
+    /// bounds-checked and values are converted to host byte order as they
+    /// are read. The memory must outlive the container
+    class BytecodeContainer final {
+        public:
+            static constexpr std::size_t section_alignment = 8;
+            static constexpr char version = 2;
+
+        public:
+            /// Read the header and section directory. Throws a
+            /// ModuleLoadError if they are malformed
+            BytecodeContainer(const std::uint8_t* data, std::size_t size);
+
+            /// Check if the data starts with a version 2 or later header
+            static bool is_container(const std::uint8_t* data, std::size_t size);
+
+            const ContainerHeader& header() const;
+            const std::vector<SectionEntry>& sections() const;
+            bool is_host_byte_order() const;
+            std::string path() const;
+
+            std::size_t constant_count() const;
+            ConstantEntry constant(std::size_t index) const;
+
+            std::size_t function_count() const;
+            FunctionEntry function(std::size_t index) const;
+            std::string function_name(const FunctionEntry& entry) const;
+
+            /// Check that the instructions and line table of a function are
+            /// within their sections without reading them. Throws a
+            /// ModuleLoadError if they are not
+            void check_function(const FunctionEntry& entry) const;
+
+            /// Get the instructions of a function as stored in the file
+            const std::uint8_t* function_code(const FunctionEntry& entry) const;
+
+            /// Get the instructions of a function in host byte order
+            std::vector<bytecode_type> copy_function_code(const FunctionEntry& entry) const;
+
+            LineTable function_line_table(const FunctionEntry& entry) const;
+
+            /// Get the stack map of a function, which is empty if the file
+            /// has no stack map section
+            StackMap function_stack_map(const FunctionEntry& entry) const;
+
+        private:
+            const std::uint8_t* _data;
+            std::size_t _size;
+            ContainerHeader _header;
+            std::vector<SectionEntry> _sections;
+
+        private:
+            std::uint32_t to_host(std::uint32_t value) const;
+            std::uint64_t to_host(std::uint64_t value) const;
+
+            const SectionEntry& get_section(SectionKind kind) const;
+            bool has_section(SectionKind kind) const;
+
+            /// Get the size of the stack map of a function. Throws a
+            /// ModuleLoadError if it is out of bounds
+            std::uint32_t stack_map_size(const FunctionEntry& entry) const;
+
+            /// Get a pointer to a range of a section. Throws a
+            /// ModuleLoadError if it is out of bounds
+            const std::uint8_t* section_range(
+                SectionKind kind,
+                std::uint64_t offset,
+                std::uint64_t size
+            ) const;
+
+            /// Get the number of entries in a section that is a table of
+            /// fixed-size entries
+            std::size_t table_size(SectionKind kind, std::size_t entry_size) const;
+    };
+
+    /// Writes a version 2 bytecode container in host byte order
+    class BytecodeContainerWriter final {
+        public:
+            BytecodeContainerWriter(
+                std::uint32_t globals_count,
+                std::uint32_t module_index,
+                const std::string& path,
+                std::uint32_t main_function_index
+            );
+
+            /// Add a constant. Throws a std::runtime_error for constants
+            /// that cannot be written yet
+            void add_constant(const vm::Value& value);
+
+            void add_function(
+                const std::string& name,
+                const SourceLocation& location,
+                std::uint32_t func_index,
+                std::uint32_t reg_count,
+                const bytecode_type* code,
+                std::size_t code_size,
+                const LineTable& line_table,
+                const StackMap& stack_map
+            );
+
+            std::vector<std::uint8_t> write() const;
+
+        private:
+            ContainerHeader _header;
+            std::vector<std::uint8_t> _strings;
+            std::vector<ConstantEntry> _constants;
+            std::vector<FunctionEntry> _functions;
+            std::vector<bytecode_type> _code;
+            std::vector<std::uint8_t> _line_tables;
+            std::vector<std::uint8_t> _stack_maps;
+
+        private:
+            std::uint32_t add_string(const std::string& str);
+    };
+}
+
+#endif // KORE_BYTECODE_CONTAINER_HPP
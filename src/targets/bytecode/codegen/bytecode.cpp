@@ -68,6 +68,33 @@ namespace kore {
             case JumpIfNot:      return "jumpifnot";
             case Call:           return "call";
             case Ret:            return "return";
+            case TailCall:       return "tailcall";
+            case AddI32K:        return "addi32k";
+            case SubI32K:        return "subi32k";
+            case JumpIfLtI32:    return "jumpiflti32";
+            case JumpIfGtI32:    return "jumpifgti32";
+            case JumpIfLeI32:    return "jumpiflei32";
+            case JumpIfGeI32:    return "jumpifgei32";
+            case JumpIfEqI32:    return "jumpifeqi32";
+            case JumpIfNeqI32:   return "jumpifneqi32";
+            case ArrayAllocBool: return "arrayallocbool";
+            case ArrayAllocI32:  return "arrayalloci32";
+            case ArrayAllocI64:  return "arrayalloci64";
+            case ArrayAllocF32:  return "arrayallocf32";
+            case ArrayAllocF64:  return "arrayallocf64";
+            case ArrayGetBool:   return "arraygetbool";
+            case ArrayGetI32:    return "arraygeti32";
+            case ArrayGetI64:    return "arraygeti64";
+            case ArrayGetF32:    return "arraygetf32";
+            case ArrayGetF64:    return "arraygetf64";
+            case ArraySetBool:   return "arraysetbool";
+            case ArraySetI32:    return "arrayseti32";
+            case ArraySetI64:    return "arrayseti64";
+            case ArraySetF32:    return "arraysetf32";
+            case ArraySetF64:    return "arraysetf64";
+            case CallDirect:     return "calldirect";
+            case CallBuiltin:    return "callbuiltin";
+            case CallGeneric:    return "callgeneric";
         }
     }
 
@@ -76,9 +103,23 @@ namespace kore {
     }
 
     bool is_variable_length_opcode(Bytecode bytecode) {
+        // Compare-and-branch instructions have a fixed size but take up an
+        // additional word for the jump offset
+        return is_compare_and_branch_opcode(bytecode);
+    }
+
+    bool is_variable_length_instruction(bytecode_type instruction) {
+        return is_variable_length_opcode(GET_OPCODE(instruction));
+    }
+
+    bool is_compare_and_branch_opcode(Bytecode bytecode) {
         switch (bytecode) {
-            case Call:
-            case Ret:
+            case JumpIfLtI32:
+            case JumpIfGtI32:
+            case JumpIfLeI32:
+            case JumpIfGeI32:
+            case JumpIfEqI32:
+            case JumpIfNeqI32:
                 return true;
 
             default:
@@ -86,8 +127,55 @@ namespace kore {
         }
     }
 
-    bool is_variable_length_instruction(bytecode_type instruction) {
-        return is_variable_length_opcode(GET_OPCODE(instruction));
+    bool is_array_alloc_opcode(Bytecode bytecode) {
+        switch (bytecode) {
+            case ArrayAlloc:
+            case ArrayAllocBool:
+            case ArrayAllocI32:
+            case ArrayAllocI64:
+            case ArrayAllocF32:
+            case ArrayAllocF64:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    bool is_array_access_opcode(Bytecode bytecode) {
+        switch (bytecode) {
+            case ArrayGet:
+            case ArrayGetBool:
+            case ArrayGetI32:
+            case ArrayGetI64:
+            case ArrayGetF32:
+            case ArrayGetF64:
+            case ArraySet:
+            case ArraySetBool:
+            case ArraySetI32:
+            case ArraySetI64:
+            case ArraySetF32:
+            case ArraySetF64:
+                return true;
+
+            default:
+                return false;
+        }
+    }
+
+    bool is_array_set_opcode(Bytecode bytecode) {
+        switch (bytecode) {
+            case ArraySet:
+            case ArraySetBool:
+            case ArraySetI32:
+            case ArraySetI64:
+            case ArraySetF32:
+            case ArraySetF64:
+                return true;
+
+            default:
+                return false;
+        }
     }
 
     std::ostream& operator<<(std::ostream& os, const Bytecode bytecode) {
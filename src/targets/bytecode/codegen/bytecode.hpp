@@ -128,9 +128,52 @@ namespace kore {
         JumpIf,
         JumpIfNot,
 
-        // Function calls
+        // Function calls. A tail call reuses the current call frame
         Call,
-        Ret
+        Ret,
+        TailCall,
+
+        // Superinstructions selected by the peephole optimiser. The
+        // arithmetic instructions take an 8-bit signed immediate as their
+        // third operand and the compare-and-branch instructions compare two
+        // registers and take the jump offset in an additional 32-bit word
+        AddI32K,
+        SubI32K,
+        JumpIfLtI32,
+        JumpIfGtI32,
+        JumpIfLeI32,
+        JumpIfGeI32,
+        JumpIfEqI32,
+        JumpIfNeqI32,
+
+        // Array instructions for arrays of a primitive element type which
+        // store their elements unboxed. They take the same operands as
+        // ArrayAlloc, ArrayGet and ArraySet
+        ArrayAllocBool,
+        ArrayAllocI32,
+        ArrayAllocI64,
+        ArrayAllocF32,
+        ArrayAllocF64,
+        ArrayGetBool,
+        ArrayGetI32,
+        ArrayGetI64,
+        ArrayGetF32,
+        ArrayGetF64,
+        ArraySetBool,
+        ArraySetI32,
+        ArraySetI64,
+        ArraySetF32,
+        ArraySetF64,
+
+        // Quickened call instructions. The vm rewrites a call site to one of
+        // these after its first execution so they never appear in compiled
+        // code. CallDirect and CallBuiltin call the function that the call
+        // site first saw as long as it keeps calling it and CallGeneric is a
+        // call site that has seen different functions and is not quickened
+        // again
+        CallDirect,
+        CallBuiltin,
+        CallGeneric
     };
 
     std::string bytecode_to_string(Bytecode bytecode);
@@ -139,6 +182,10 @@ namespace kore {
 
     bool is_variable_length_opcode(Bytecode bytecode);
     bool is_variable_length_instruction(bytecode_type instruction);
+    bool is_compare_and_branch_opcode(Bytecode bytecode);
+    bool is_array_alloc_opcode(Bytecode bytecode);
+    bool is_array_access_opcode(Bytecode bytecode);
+    bool is_array_set_opcode(Bytecode bytecode);
 
     std::ostream& operator<<(std::ostream& os, const Bytecode bytecode);
 }
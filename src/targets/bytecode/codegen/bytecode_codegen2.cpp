@@ -113,17 +113,26 @@ namespace kore {
         return _binop_map2[type_category][binop];
     }
 
-    BytecodeGenerator2::BytecodeGenerator2() {}
+    BytecodeGenerator2::BytecodeGenerator2(int format_version)
+        : _format_version(format_version) {
+        if (format_version != 1 && format_version != BytecodeContainer::version) {
+            throw std::runtime_error("Unsupported bytecode format version");
+        }
+    }
 
     BytecodeGenerator2::~BytecodeGenerator2() {}
 
     std::vector<std::uint8_t> BytecodeGenerator2::generate(kir::Kir& kir) {
+        if (_format_version == BytecodeContainer::version) {
+            return generate_container(kir);
+        }
+
         _buffer.clear();
 
         // Magic bytes + compiler and bytecode versions
         write_bytes("kore");
         write_bytes({ 1, 0, 0 });
-        write_bytes({ 1, 0, 0 });
+        write_bytes({ 1, 1, 0 });
 
         write_be32(kir.globals_count());
 
@@ -136,11 +145,47 @@ namespace kore {
             generate_for_module(module);
         }
 
-        patch_jumps();
-
         return _buffer;
     }
 
+    std::vector<std::uint8_t> BytecodeGenerator2::generate_container(kir::Kir& kir) {
+        if (kir.module_count() != 1) {
+            throw std::runtime_error("Version 2 bytecode only supports a single module");
+        }
+
+        auto& module = kir.main_module();
+        BytecodeContainerWriter writer(
+            kir.globals_count(),
+            module.index(),
+            module.path(),
+            module.main_function().index()
+        );
+
+        auto& constant_table = module.constant_table();
+
+        for (auto it = constant_table.sorted_cbegin(); it < constant_table.sorted_cend(); ++it) {
+            writer.add_constant(*it);
+        }
+
+        for (int idx = 0; idx < module.function_count(); ++idx) {
+            auto& function = module[idx];
+            generate_code(function);
+
+            writer.add_function(
+                function.name(),
+                function.location(),
+                function.index(),
+                function.max_regs_used(),
+                _code.data(),
+                _code.size(),
+                _line_table,
+                _stack_map
+            );
+        }
+
+        return writer.write();
+    }
+
     void BytecodeGenerator2::write_value(const vm::Value& value) {
         switch (value.tag) {
             case vm::ValueTag::I32:
@@ -190,12 +235,28 @@ namespace kore {
         write_be32(function.max_regs_used());
         write_be32(function.code_size());
 
+        generate_code(function);
+
+        for (auto instruction : _code) {
+            write_be32(instruction);
+        }
+
+        write_line_table();
+    }
+
+    void BytecodeGenerator2::generate_code(const kir::Function& function) {
         auto graph = function.graph();
+        _code.clear();
+        _line_table = LineTable();
+        _stack_map = StackMap();
+        _pc = 0;
 
         if (graph.size() == 0) {
             return;
         }
 
+        _stack_map_analyser.analyse(function);
+
         auto& source_block = graph[kir::BasicBlock::StartBlockId];
         std::queue<kir::BlockId> block_ids;
         block_ids.push(source_block.id);
@@ -215,26 +276,38 @@ namespace kore {
                 block_ids.push(*it);
             }
         }
+
+        // Block ids are only unique within a function so patch its jumps
+        // before generating code for the next function
+        patch_jumps();
     }
 
     void BytecodeGenerator2::generate_for_block(kir::BasicBlock& block) {
         // TODO: This only works if the basic blocks are sequentially ordered
-        _block_offsets[block.id] = _buffer.size();
+        _block_offsets[block.id] = code_offset();
+
+        for (std::size_t idx = 0; idx < block.instructions.size(); ++idx) {
+            if (kir::is_safepoint(block, idx)) {
+                _stack_map.add(_pc, _stack_map_analyser.roots(block.id, idx));
+            }
 
-        for (auto& instruction : block.instructions) {
-            generate_for_instruction(instruction);
+            generate_for_instruction(block.instructions[idx]);
         }
     }
 
     void BytecodeGenerator2::generate_for_instruction(kir::Instruction& instruction) {
         auto opcode = instruction.opcode;
 
+        // Program counters count instructions, not words, like the
+        // instructions decoded by the vm
+        _line_table.add(_pc++, instruction.location);
+
         if (auto ins_type = std::get_if<kir::OneRegister>(&instruction.type)) {
-            write_be32(KORE_MAKE_INSTRUCTION1(opcode, ins_type->reg));
+            emit(KORE_MAKE_INSTRUCTION1(opcode, ins_type->reg));
         } else if (auto ins_type = std::get_if<kir::TwoRegisters>(&instruction.type)) {
-            write_be32(KORE_MAKE_INSTRUCTION2(opcode, ins_type->reg1, ins_type->reg2));
+            emit(KORE_MAKE_INSTRUCTION2(opcode, ins_type->reg1, ins_type->reg2));
         } else if (auto ins_type = std::get_if<kir::ThreeRegisters>(&instruction.type)) {
-            write_be32(
+            emit(
                 KORE_MAKE_INSTRUCTION3(
                     opcode,
                     ins_type->reg1,
@@ -247,7 +320,7 @@ namespace kore {
                 save_patch_location(ins_type->value);
             }
 
-            write_be32(KORE_MAKE_REG_VALUE_INSTRUCTION(
+            emit(KORE_MAKE_REG_VALUE_INSTRUCTION(
                 opcode,
                 ins_type->reg,
                 ins_type->value
@@ -259,46 +332,54 @@ namespace kore {
                 save_patch_location(value);
             }
 
-            write_be32(KORE_MAKE_VALUE_INSTRUCTION(opcode, value));
-        } else if (auto ins_type = std::get_if<kir::CallV>(&instruction.type)) {
-            auto arg_registers = ins_type->arg_registers;
-            auto ret_registers = ins_type->ret_registers;
-
-            std::vector<std::uint8_t> bytes{
-                static_cast<std::uint8_t>(opcode),
-                static_cast<std::uint8_t>(ins_type->func_index),
-                static_cast<std::uint8_t>(arg_registers.size()),
-                static_cast<std::uint8_t>(ret_registers.size()),
-            };
-
-            bytes.insert(bytes.end(), arg_registers.cbegin(), arg_registers.cend());
-            bytes.insert(bytes.end(), ret_registers.cbegin(), ret_registers.cend());
+            emit(KORE_MAKE_VALUE_INSTRUCTION(opcode, value));
+        } else if (auto ins_type = std::get_if<kir::TwoRegistersAndValue>(&instruction.type)) {
+            if (is_compare_and_branch_opcode(opcode)) {
+                // The jump offset is stored in an additional word
+                save_patch_location(ins_type->value);
 
-            write_bytes(bytes);
+                emit(KORE_MAKE_INSTRUCTION2(opcode, ins_type->reg1, ins_type->reg2));
+                emit(0);
+            } else {
+                // Otherwise the value is an 8-bit immediate operand
+                emit(
+                    KORE_MAKE_INSTRUCTION3(
+                        opcode,
+                        ins_type->reg1,
+                        ins_type->reg2,
+                        ins_type->value
+                    )
+                );
+            }
+        } else if (auto ins_type = std::get_if<kir::CallV>(&instruction.type)) {
+            // Arguments are in consecutive registers starting at the base
+            // register so only their count is encoded
+            emit(
+                KORE_MAKE_INSTRUCTION3(
+                    opcode,
+                    ins_type->func_index,
+                    ins_type->base,
+                    ins_type->arg_registers.size()
+                )
+            );
         } else if (auto ins_type = std::get_if<kir::ReturnV>(&instruction.type)) {
             auto registers = ins_type->registers;
+            Reg first_reg = registers.empty() ? 0 : registers.front();
 
-            if (registers.empty()) {
-                write_be32(KORE_MAKE_INSTRUCTION1(opcode, 0));
-            } else {
-                std::vector<std::uint8_t> bytes{
-                    static_cast<std::uint8_t>(opcode),
-                    static_cast<std::uint8_t>(registers.size()),
-                };
-
-                bytes.insert(bytes.end(), registers.cbegin(), registers.cend());
+            emit(KORE_MAKE_INSTRUCTION2(opcode, first_reg, registers.size()));
+        }
+    }
 
-                if (bytes.size() < 4) {
-                    bytes.insert(bytes.cend(), 4 - bytes.size(), 0);
-                }
+    void BytecodeGenerator2::emit(bytecode_type instruction) {
+        _code.push_back(instruction);
+    }
 
-                write_bytes(bytes);
-            }
-        }
+    std::size_t BytecodeGenerator2::code_offset() const {
+        return _code.size() * sizeof(bytecode_type);
     }
 
     void BytecodeGenerator2::save_patch_location(kir::BlockId target_block_id) {
-        _patch_locations.push_back({ _buffer.size(), target_block_id });
+        _patch_locations.push_back({ code_offset(), target_block_id });
     }
 
     void BytecodeGenerator2::patch_jumps() {
@@ -307,10 +388,27 @@ namespace kore {
 
             // TODO: Check for too large relative offsets
 
-            // Pack the relative offset into the jump offset location in the buffer
-            _buffer[location + 2] = relative_offset >> 8;
-            _buffer[location + 3] = relative_offset & 0xff;
+            // Compare-and-branch instructions store the offset in their
+            // second word. The offset is still relative to the start of the
+            // instruction
+            auto word = location / sizeof(bytecode_type);
+            auto opcode = GET_OPCODE(_code[word]);
+            auto offset_word = is_compare_and_branch_opcode(opcode) ? word + 1 : word;
+
+            // Pack the relative offset into the low bits of the instruction
+            _code[offset_word] = (_code[offset_word] & ~VALUE_BITMASK)
+                | (relative_offset & VALUE_BITMASK);
         }
+
+        _block_offsets.clear();
+        _patch_locations.clear();
+    }
+
+    void BytecodeGenerator2::write_line_table() {
+        auto data = _line_table.data();
+
+        write_be32(data.size());
+        write_bytes(data);
     }
 
     void BytecodeGenerator2::write_bytes(const std::string& str) {
@@ -8,14 +8,18 @@
 
 #include "ast/expressions/string_expression.hpp"
 #include "ast/ast.hpp"
+#include "targets/bytecode/bytecode_container.hpp"
 #include "targets/bytecode/codegen/bytecode.hpp"
 #include "targets/bytecode/codegen/bytecode_array_writer.hpp"
 #include "targets/bytecode/codegen/kir/block_id.hpp"
 #include "targets/bytecode/codegen/kir/function.hpp"
 #include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/codegen/kir/stack_map_analyser.hpp"
 #include "targets/bytecode/compiled_object.hpp"
+#include "targets/bytecode/line_table.hpp"
 #include "targets/bytecode/module.hpp"
 #include "targets/bytecode/register.hpp"
+#include "targets/bytecode/stack_map.hpp"
 #include "targets/bytecode/vm/value_type.hpp"
 #include "types/scope.hpp"
 
@@ -28,25 +32,49 @@ namespace kore {
             using reg_iterator = std::vector<Reg>::iterator;
 
         public:
-            BytecodeGenerator2();
+            /// Create a generator for the given version of the bytecode
+            /// format. Version 1 is kept for tools that still read the
+            /// sequential big-endian format
+            BytecodeGenerator2(int format_version = BytecodeContainer::version);
             virtual ~BytecodeGenerator2();
 
             std::vector<std::uint8_t> generate(kir::Kir& kir);
 
         private:
+            int _format_version;
             std::vector<std::uint8_t> _buffer;
+
+            // Instructions of the function being generated in host byte
+            // order. Block offsets and patch locations are byte offsets into
+            // them
+            std::vector<bytecode_type> _code;
             std::map<kir::BlockId, std::size_t> _block_offsets;
             std::vector<std::pair<std::size_t, kir::BlockId>> _patch_locations;
 
+            // Line table of the function being generated and the index of
+            // the next instruction in it
+            LineTable _line_table;
+            std::size_t _pc = 0;
+
+            // Registers the garbage collector scans at each safepoint of
+            // the function being generated. Only written to version 2 files
+            kir::StackMapAnalyser _stack_map_analyser;
+            StackMap _stack_map;
+
         private:
+            std::vector<std::uint8_t> generate_container(kir::Kir& kir);
             void generate_for_module(const kir::Module& module);
             void generate_for_function(const kir::Function& function);
+            void generate_code(const kir::Function& function);
             void generate_for_block(kir::BasicBlock& block);
             void generate_for_instruction(kir::Instruction& instruction);
 
+            void emit(bytecode_type instruction);
+            std::size_t code_offset() const;
             void save_patch_location(kir::BlockId target_block_id);
             void patch_jumps();
 
+            void write_line_table();
             void write_value(const vm::Value& value);
             void write_constant_table(const ConstantTable& table);
             void write_bytes(const std::string& str);
@@ -1,5 +1,7 @@
 #include "targets/bytecode/codegen/kir/basic_block.hpp"
 
+#include <algorithm>
+
 namespace kore {
     namespace kir {
         BasicBlock::BasicBlock(BlockId id) : id(id) {}
@@ -11,5 +13,63 @@ namespace kore {
         BlockId BasicBlock::StartBlockId = 0;
         BlockId BasicBlock::EndBlockId = 1;
         BlockId BasicBlock::InvalidBlockId = -1;
+
+        bool leaves_function(const BasicBlock& block) {
+            return std::any_of(
+                block.instructions.begin(),
+                block.instructions.end(),
+                [](const Instruction& instruction) {
+                    return instruction.opcode == Bytecode::Ret || instruction.opcode == Bytecode::TailCall;
+                }
+            );
+        }
+
+        bool is_builtin_call(const BasicBlock& block, std::size_t idx) {
+            auto& call = block.instructions[idx];
+
+            if (call.opcode != Bytecode::Call) {
+                return false;
+            }
+
+            // Calls load their function into a register in the same block
+            // just before calling it
+            Reg func_reg = std::get<CallV>(call.type).func_index;
+
+            while (idx-- > 0) {
+                auto& instruction = block.instructions[idx];
+
+                if (uses_register(instruction, func_reg)) {
+                    return instruction.opcode == Bytecode::LoadBuiltin;
+                }
+            }
+
+            return false;
+        }
+
+        bool is_borrowed_by_builtins(const BasicBlock& block, std::size_t idx, Reg reg) {
+            auto& instructions = block.instructions;
+
+            for (++idx; idx < instructions.size(); ++idx) {
+                auto& instruction = instructions[idx];
+
+                if (!uses_register(instruction, reg)) {
+                    continue;
+                }
+
+                auto call = std::get_if<CallV>(&instruction.type);
+
+                if (!call || call->func_index == reg || !is_builtin_call(block, idx)) {
+                    return false;
+                }
+
+                auto& ret_registers = call->ret_registers;
+
+                if (std::find(ret_registers.begin(), ret_registers.end(), reg) != ret_registers.end()) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
     }
 }
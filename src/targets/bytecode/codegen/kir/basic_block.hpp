@@ -24,6 +24,20 @@ namespace kore {
             static BlockId InvalidBlockId;
         };
 
+        /// Whether a block leaves the function. The lowering pass adds an
+        /// edge from every branch of an if statement to the block after it
+        /// even if the branch returns
+        bool leaves_function(const BasicBlock& block);
+
+        /// Whether the function called by the instruction at an index of a
+        /// block is a builtin function
+        bool is_builtin_call(const BasicBlock& block, std::size_t idx);
+
+        /// Whether a register that an array is copied into at an index of a
+        /// block is only passed to builtin functions until a builtin function
+        /// returns a value in its place. Builtin functions borrow their
+        /// arguments and never keep a reference to them
+        bool is_borrowed_by_builtins(const BasicBlock& block, std::size_t idx, Reg reg);
     }
 }
 
@@ -1,3 +1,4 @@
+#include <array>
 #include <numeric>
 
 #include "ast/expressions/expressions.hpp"
@@ -5,6 +6,7 @@
 #include "targets/bytecode/codegen/kir/function.hpp"
 #include "targets/bytecode/codegen/kir/instruction.hpp"
 #include "targets/bytecode/vm/config.hpp"
+#include "types/array_type.hpp"
 #include "types/type_category.hpp"
 #include "types/unknown_type.hpp"
 
@@ -73,13 +75,44 @@ namespace kore {
             },
         };
 
+        // Allocation, get and set opcodes for arrays of each element type
+        // that is stored unboxed
+        std::map<TypeCategory, std::array<Bytecode, 3>> _typed_array_opcodes = {
+            { TypeCategory::Bool,      { Bytecode::ArrayAllocBool, Bytecode::ArrayGetBool, Bytecode::ArraySetBool } },
+            { TypeCategory::Integer32, { Bytecode::ArrayAllocI32,  Bytecode::ArrayGetI32,  Bytecode::ArraySetI32  } },
+            { TypeCategory::Integer64, { Bytecode::ArrayAllocI64,  Bytecode::ArrayGetI64,  Bytecode::ArraySetI64  } },
+            { TypeCategory::Float32,   { Bytecode::ArrayAllocF32,  Bytecode::ArrayGetF32,  Bytecode::ArraySetF32  } },
+            { TypeCategory::Float64,   { Bytecode::ArrayAllocF64,  Bytecode::ArrayGetF64,  Bytecode::ArraySetF64  } },
+        };
+
+        /// Get the allocation, get and set opcodes for an array type. Only
+        /// one-dimensional arrays of a primitive element type are typed
+        std::array<Bytecode, 3> get_array_opcodes(const Type* type) {
+            if (type->category() == TypeCategory::Array) {
+                auto array_type = type->as<const ArrayType>();
+
+                if (array_type->rank() == 1) {
+                    auto it = _typed_array_opcodes.find(array_type->element_type()->category());
+
+                    if (it != _typed_array_opcodes.end()) {
+                        return it->second;
+                    }
+                }
+            }
+
+            return { Bytecode::ArrayAlloc, Bytecode::ArrayGet, Bytecode::ArraySet };
+        }
+
+        bool is_reference_counted(const Type* type) {
+            return type->category() == TypeCategory::Array;
+        }
+
         Function::Function(FuncIndex index)
             : _index(index),
-              _func(nullptr),
-              _code_size(0) {}
+              _func(nullptr) {}
 
         Function::Function(FuncIndex index, const kore::Function* func)
-            : _index(index), _func(func), _code_size(0) {}
+            : _index(index), _func(func) {}
 
         Function::~Function() {}
 
@@ -92,8 +125,16 @@ namespace kore {
         }
 
         void Function::add_instruction(Instruction instruction) {
+            instruction.location = _current_location;
             _graph.current_block().instructions.push_back(instruction);
-            ++_code_size;
+        }
+
+        void Function::set_location(const SourceLocation& location) {
+            _current_location = location;
+        }
+
+        SourceLocation Function::current_location() const {
+            return _current_location;
         }
 
         void Function::set_register_state(Reg reg, RegisterState state) {
@@ -158,24 +199,26 @@ namespace kore {
         }
 
         void Function::free_register(Reg reg) {
-            if (register_type(reg)->is_value_type()) {
+            if (!is_reference_counted(register_type(reg))) {
                 return;
             }
 
-            emit_destroy(reg);
+            emit_refdec(reg);
             set_register_state(reg, RegisterState::Moved);
         }
 
         void Function::free_registers() {
-            // Destroy registers in the reverse order of how they were introduced
+            // Release registers in the reverse order of how they were
+            // introduced. Only registers with a reference counted type own a
+            // reference, others such as parameters borrow theirs
             for (int reg = _reg_count - 1; reg >= 0; --reg) {
                 switch (register_state(reg)) {
                     case RegisterState::Moved:
                         break;
 
                     case RegisterState::Available: {
-                        if (!register_type(reg)->is_value_type()) {
-                            emit_destroy(reg);
+                        if (is_reference_counted(register_type(reg))) {
+                            emit_refdec(reg);
                         }
                         break;
                     }
@@ -253,16 +296,27 @@ namespace kore {
             );
         }
 
-        Reg Function::emit_allocate_array(int size) {
+        Reg Function::emit_allocate_array(int size, const Type* type) {
             auto reg = allocate_register();
+            auto opcode = get_array_opcodes(type)[0];
 
-            add_instruction(
-                Instruction{ Bytecode::ArrayAlloc, RegisterAndValue{ reg, size } }
-            );
+            add_instruction(Instruction{ opcode, RegisterAndValue{ reg, size } });
 
             return reg;
         }
 
+        void Function::emit_array_get(const Type* type, Reg array, Reg index, Reg dst) {
+            auto opcode = get_array_opcodes(type)[1];
+
+            add_instruction(Instruction{ opcode, ThreeRegisters{ array, index, dst } });
+        }
+
+        void Function::emit_array_set(const Type* type, Reg array, Reg index, Reg value) {
+            auto opcode = get_array_opcodes(type)[2];
+
+            add_instruction(Instruction{ opcode, ThreeRegisters{ array, index, value } });
+        }
+
         void Function::emit_destroy(Reg reg) {
             add_instruction(Instruction{ Bytecode::Destroy, OneRegister{ reg } });
         }
@@ -277,13 +331,27 @@ namespace kore {
 
         void Function::emit_call(
             Reg func_reg,
+            Reg base,
             const std::vector<kore::Reg>& arg_registers,
             const std::vector<kore::Reg>& return_registers
         ) {
             add_instruction(
                 Instruction{
                     Bytecode::Call,
-                    CallV{ func_reg, arg_registers, return_registers },
+                    CallV{ func_reg, base, arg_registers, return_registers },
+                }
+            );
+        }
+
+        void Function::emit_tail_call(
+            Reg func_reg,
+            Reg base,
+            const std::vector<kore::Reg>& arg_registers
+        ) {
+            add_instruction(
+                Instruction{
+                    Bytecode::TailCall,
+                    CallV{ func_reg, base, arg_registers, {} },
                 }
             );
         }
@@ -321,12 +389,32 @@ namespace kore {
             return _func->location();
         }
 
+        int Function::arity() const {
+            return _func ? _func->arity() : 0;
+        }
+
+        const Type* Function::parameter_type(int idx) const {
+            return _func->parameter(idx)->type();
+        }
+
         int Function::max_regs_used() const noexcept {
             return _max_regs_used;
         }
 
+        int Function::register_count() const noexcept {
+            return _reg_count;
+        }
+
         int Function::code_size() const {
-            return _code_size;
+            // Count the instructions in each block since optimisation passes
+            // may have fused or removed instructions after they were added
+            std::size_t code_size = 0;
+
+            for (std::size_t id = 0; id < _graph.size(); ++id) {
+                code_size += _graph[id].instructions.size();
+            }
+
+            return code_size;
         }
     }
 }
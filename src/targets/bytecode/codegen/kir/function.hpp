@@ -14,6 +14,10 @@ namespace kore {
     namespace kir {
         using FuncIndex = unsigned int;
 
+        /// Whether values of a type live on the heap and are reference
+        /// counted
+        bool is_reference_counted(const Type* type);
+
         /// A function represented as KIR
         class Function final {
             public:
@@ -24,6 +28,11 @@ namespace kore {
                 Graph& graph();
                 const Graph& graph() const;
                 void add_instruction(Instruction instruction);
+
+                /// Set the source location of subsequently added instructions
+                void set_location(const SourceLocation& location);
+                SourceLocation current_location() const;
+
                 void set_register_state(Reg reg, RegisterState state);
                 void set_register_type(Reg reg, const Type* type);
                 Reg allocate_register();
@@ -40,32 +49,47 @@ namespace kore {
                 Reg emit_load_function(int func_index, Bytecode opcode);
                 Reg emit_binop(BinaryExpression& expr, Reg left, Reg right);
                 void emit_unconditional_jump(BlockId target_block_id);
-                void emit_move(Reg src, Reg dst);
+                void emit_move(Reg dst, Reg src);
                 void emit_conditional_jump(Bytecode opcode, Reg condition, BlockId target_block_id);
-                Reg emit_allocate_array(int size);
+                Reg emit_allocate_array(int size, const Type* type);
+                void emit_array_get(const Type* type, Reg array, Reg index, Reg dst);
+                void emit_array_set(const Type* type, Reg array, Reg index, Reg value);
                 void emit_destroy(Reg reg);
                 /* void destroy(Expression& expr, Reg reg); */
                 void emit_refinc(Reg reg);
                 void emit_refdec(Reg reg);
                 void emit_call(
                     Reg func_reg,
+                    Reg base,
                     const std::vector<kore::Reg>& arg_registers,
                     const std::vector<kore::Reg>& return_registers
                 );
+                void emit_tail_call(
+                    Reg func_reg,
+                    Reg base,
+                    const std::vector<kore::Reg>& arg_registers
+                );
                 void emit_return();
                 void emit_return(const std::vector<Reg>& regs);
 
                 FuncIndex index() const noexcept;
                 std::string name() const;
                 SourceLocation location() const;
+
+                /// The number of parameters and their types. Parameters are
+                /// passed in the first registers of the function
+                int arity() const;
+                const Type* parameter_type(int idx) const;
+
                 int max_regs_used() const noexcept;
+                int register_count() const noexcept;
                 int code_size() const;
 
             private:
                 FuncIndex _index;
                 const kore::Function* _func;
                 Graph _graph;
-                int _code_size;
+                SourceLocation _current_location;
 
                 // For now, we just use a very simple per-function register
                 // allocator with a maximum of 256 registers that just bumps a
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <ostream>
 
 #include "targets/bytecode/codegen/kir/graph.hpp"
@@ -45,6 +46,22 @@ namespace kore {
             return bb.id;
         }
 
+        BlockId Graph::add_entry_block() {
+            auto id = add_block();
+            auto& successors = _successors[BasicBlock::StartBlockId];
+
+            for (auto successor : successors) {
+                auto& predecessors = _predecessors[successor];
+                std::replace(predecessors.begin(), predecessors.end(), BasicBlock::StartBlockId, id);
+            }
+
+            _successors[id] = successors;
+            _predecessors[id] = { BasicBlock::StartBlockId };
+            _successors[BasicBlock::StartBlockId] = { id };
+
+            return id;
+        }
+
         bool Graph::has_block(BlockId id) {
             // TODO: Perhaps use a u32 and use the max value for invalid blocks
             return id >= 0 && id < static_cast<BlockId>(_blocks.size());
@@ -54,6 +71,10 @@ namespace kore {
             return _blocks[id];
         }
 
+        const BasicBlock& Graph::operator[](BlockId id) const {
+            return _blocks[id];
+        }
+
         BasicBlock& Graph::current_block() {
             return _blocks[_current_block];
         }
@@ -23,8 +23,13 @@ namespace kore {
                 BlockId add_block_as_current();
                 BlockId add_block(BlockId id);
                 BlockId add_block(BasicBlock& bb);
+
+                /// Add a block between the start block and its successors so
+                /// that it runs exactly once on entry to the function
+                BlockId add_entry_block();
                 bool has_block(BlockId id);
                 BasicBlock& operator[](BlockId id);
+                const BasicBlock& operator[](BlockId id) const;
                 BasicBlock& current_block();
                 void set_current_block(BlockId id);
                 std::size_t size() const;
@@ -1,7 +1,37 @@
 #include "targets/bytecode/codegen/kir/instruction.hpp"
 
+#include <algorithm>
+
 namespace kore {
     namespace kir {
+        static bool contains_register(const std::vector<Reg>& registers, Reg reg) {
+            return std::find(registers.begin(), registers.end(), reg) != registers.end();
+        }
+
+        bool uses_register(const Instruction& instruction, Reg reg) {
+            auto& type = instruction.type;
+
+            if (auto ins_type = std::get_if<OneRegister>(&type)) {
+                return ins_type->reg == reg;
+            } else if (auto ins_type = std::get_if<TwoRegisters>(&type)) {
+                return ins_type->reg1 == reg || ins_type->reg2 == reg;
+            } else if (auto ins_type = std::get_if<ThreeRegisters>(&type)) {
+                return ins_type->reg1 == reg || ins_type->reg2 == reg || ins_type->reg3 == reg;
+            } else if (auto ins_type = std::get_if<RegisterAndValue>(&type)) {
+                return ins_type->reg == reg;
+            } else if (auto ins_type = std::get_if<TwoRegistersAndValue>(&type)) {
+                return ins_type->reg1 == reg || ins_type->reg2 == reg;
+            } else if (auto ins_type = std::get_if<CallV>(&type)) {
+                return ins_type->func_index == reg
+                    || contains_register(ins_type->arg_registers, reg)
+                    || contains_register(ins_type->ret_registers, reg);
+            } else if (auto ins_type = std::get_if<ReturnV>(&type)) {
+                return contains_register(ins_type->registers, reg);
+            }
+
+            return false;
+        }
+
         std::ostream& operator<<(std::ostream& os, const Instruction instruction) {
             auto str_opcode = bytecode_to_string(instruction.opcode);
 
@@ -20,6 +50,11 @@ namespace kore {
                 os << " " << ins_type->reg << " " << ins_type->value;
             } else if (auto ins_type = std::get_if<kir::Value>(&instruction.type)) {
                 os << " " << ins_type->value;
+            } else if (auto ins_type = std::get_if<kir::TwoRegistersAndValue>(&instruction.type)) {
+                os << " "
+                   << ins_type->reg1 << " "
+                   << ins_type->reg2 << " "
+                   << ins_type->value;
             } else if (/*auto ins_type = */std::get_if<kir::CallV>(&instruction.type)) {
             } else if (/*auto ins_type = */std::get_if<kir::ReturnV>(&instruction.type)) {
             }
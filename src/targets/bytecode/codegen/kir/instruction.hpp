@@ -37,12 +37,22 @@ namespace kore {
             int value;
         };
 
+        struct TwoRegistersAndValue {
+            Reg reg1;
+            Reg reg2;
+            int value;
+        };
+
+        /// A call whose arguments are in consecutive registers starting at
+        /// the base register which is also where the return values end up
         struct CallV {
             Reg func_index;
+            Reg base;
             std::vector<kore::Reg> arg_registers;
             std::vector<kore::Reg> ret_registers;
         };
 
+        /// A return whose registers must be consecutive
         struct ReturnV {
             std::vector<kore::Reg> registers;
         };
@@ -53,6 +63,7 @@ namespace kore {
             ThreeRegisters,
             RegisterAndValue,
             Value,
+            TwoRegistersAndValue,
             CallV,
             ReturnV
         >;
@@ -72,8 +83,14 @@ namespace kore {
             Bytecode opcode;
 
             InstructionType type;
+
+            // Location of the source code the instruction was generated for
+            SourceLocation location = SourceLocation::unknown;
         };
 
+        /// Whether an instruction reads or writes a register
+        bool uses_register(const Instruction& instruction, Reg reg);
+
         std::ostream& operator<<(std::ostream& os, const Instruction instruction);
     }
 }
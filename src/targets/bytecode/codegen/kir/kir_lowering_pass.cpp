@@ -7,14 +7,24 @@
 #include "targets/bytecode/codegen/kir/kir_lowering_pass.hpp"
 #include "targets/bytecode/register.hpp"
 #include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "types/array_type.hpp"
 #include "types/function_type.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 namespace kore {
     namespace kir {
         KirLoweringPass::KirLoweringPass(const ParsedCommandLineArgs& args) : _args(&args) {}
 
+        /// Whether the elements of an array are reference counted, i.e.
+        /// they are arrays themselves
+        bool has_reference_counted_elements(const Type* type) {
+            auto array_type = type->as<const ArrayType>();
+
+            return array_type->rank() > 1 || is_reference_counted(array_type->element_type());
+        }
+
         Module KirLoweringPass::lower(const Ast& ast) {
             kore::analysis::FunctionNameVisitor function_name_visitor{};
 
@@ -28,11 +38,12 @@ namespace kore {
             add_kir_function(nullptr);
 
             for (auto const& statement : ast) {
-                statement->accept(*this);
+                lower_statement(statement.get());
             }
 
             // Emit a return instruction at the end of the main function so we
             // pop its call frame
+            current_function().free_registers();
             current_function().emit_return();
 
             _func_index_stack.pop();
@@ -44,33 +55,50 @@ namespace kore {
         void KirLoweringPass::visit(ArrayExpression& expr) {
             trace_kir("array expression", std::to_string(expr.size()));
 
-            auto function = current_function();
-            auto array_reg = function.emit_allocate_array(expr.size());
+            auto& function = current_function();
+            auto array_reg = function.emit_allocate_array(expr.size(), expr.type());
+            bool counted_elements = has_reference_counted_elements(expr.type());
 
             // Visit its expression in the array and store it in the array
             for (int idx = 0; idx < expr.size(); ++idx) {
                 auto element_expr = expr[idx];
                 Reg element_reg = visit_expression(element_expr);
 
+                // The array holds its own reference to the element
+                if (counted_elements) {
+                    function.emit_refinc(element_reg);
+                }
+
                 // Load the index into a register
-                Reg index_reg = function.emit_load(Bytecode::Cload, idx);
+                int index = current_module().constant_table().add(idx);
+                Reg index_reg = function.emit_load(Bytecode::Cload, index);
 
-                function.emit_reg3(Bytecode::ArraySet, array_reg, element_reg, index_reg);
+                function.emit_array_set(expr.type(), array_reg, index_reg, element_reg);
             }
 
             push_register(array_reg, expr.type());
         }
 
         void KirLoweringPass::visit(IndexExpression& expr) {
-            auto function = current_function();
+            auto& function = current_function();
             Reg reg = function.allocate_register();
             Reg indexed_reg = visit_expression(expr.expr());
             Reg index_expr_reg = visit_expression(expr.index_expr());
+            auto indexed_type = expr.expr()->type();
 
             // Emit code based on the type of the indexed expression
-            switch (expr.expr()->type()->category()) {
+            switch (indexed_type->category()) {
                 case kore::TypeCategory::Array: {
-                    function.emit_reg3(Bytecode::ArrayGet, indexed_reg, index_expr_reg, reg);
+                    function.emit_array_get(indexed_type, indexed_reg, index_expr_reg, reg);
+
+                    // Take a reference to an element that is itself an array
+                    // so it outlives being replaced in the indexed array
+                    if (has_reference_counted_elements(indexed_type)) {
+                        function.emit_refinc(reg);
+                        push_register(reg, expr.type());
+                        return;
+                    }
+
                     break;
                 }
 
@@ -92,11 +120,24 @@ namespace kore {
             Reg reg = pop_register();
             Reg indexed_reg = visit_expression(expr.expr());
             Reg index_expr_reg = visit_expression(expr.index_expr());
+            auto indexed_type = expr.expr()->type();
 
             // Emit code based on the type of the indexed expression
-            switch (expr.expr()->type()->category()) {
+            switch (indexed_type->category()) {
                 case kore::TypeCategory::Array: {
-                    current_function().emit_reg3(Bytecode::ArraySet, indexed_reg, index_expr_reg, reg);
+                    auto& function = current_function();
+
+                    // Take a reference to the new element before releasing
+                    // the one to the element it replaces
+                    if (has_reference_counted_elements(indexed_type)) {
+                        Reg old_element_reg = function.allocate_register();
+
+                        function.emit_refinc(reg);
+                        function.emit_array_get(indexed_type, indexed_reg, index_expr_reg, old_element_reg);
+                        function.emit_refdec(old_element_reg);
+                    }
+
+                    function.emit_array_set(indexed_type, indexed_reg, index_expr_reg, reg);
                     break;
                 }
 
@@ -154,11 +195,21 @@ namespace kore {
             auto entry = _scope_stack.find(expr.name());
 
             if (entry->is_global_scope()) {
-                auto reg = current_function().emit_load(Bytecode::Gload, expr, entry->reg);
+                auto& func = current_function();
+                auto reg = func.emit_load(Bytecode::Gload, expr, entry->reg);
+
+                // The register owns a reference besides the global's
+                if (is_reference_counted(expr.type())) {
+                    func.emit_refinc(reg);
+                }
+
                 push_register(reg, expr.type());
             } else {
+                // The type of a variable's register is set when it is
+                // defined and decides whether it owns its value, so reading
+                // a parameter must not turn it into an owner
                 check_register_state(expr, entry->reg);
-                push_register(entry->reg, expr.type());
+                push_register(entry->reg);
             }
         }
 
@@ -180,11 +231,19 @@ namespace kore {
             if (!entry) {
                 // NOTE: Is it always ok to directly use the rhs register?
                 _scope_stack.insert(&expr, rhs_reg);
-            } else {
+            } else if (entry->reg != rhs_reg) {
                 dst = entry->reg;
 
+                // Take a reference to the new value before releasing the old
+                // one in case they are the same array
+                if (is_reference_counted(func.register_type(dst))) {
+                    func.emit_refinc(rhs_reg);
+                }
+
                 // Free the register so whatever was there is freed
                 func.free_register(dst);
+                func.emit_move(dst, rhs_reg);
+                func.set_register_state(dst, RegisterState::Available);
             }
         }
 
@@ -245,7 +304,7 @@ namespace kore {
 
                 // Generate code for the branch
                 for (auto& statement : *branch) {
-                    statement->accept(*this);
+                    lower_statement(statement.get());
                 }
 
                 // TODO: This should actually only be generated if this is not
@@ -285,7 +344,7 @@ namespace kore {
             enter_function(func);
 
             for (auto& statement : func) {
-                statement->accept(*this);
+                lower_statement(statement.get());
             }
 
             exit_function();
@@ -301,12 +360,68 @@ namespace kore {
             return arg_registers;
         }
 
+        bool are_consecutive(const Regs& registers) {
+            for (std::size_t idx = 1; idx < registers.size(); ++idx) {
+                if (registers[idx] != registers[0] + static_cast<Reg>(idx)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        Regs KirLoweringPass::make_consecutive(const Regs& registers, Reg first_temp_reg) {
+            auto& func = current_function();
+
+            // Registers can be used as is if they are consecutive temporaries
+            // at the top of the register window. Registers below
+            // first_temp_reg, such as those of variables, may not be
+            // overwritten so their values are moved instead. Neither may
+            // registers that own a reference since they are released later
+            auto owns_reference = [&func](Reg reg) {
+                return is_reference_counted(func.register_type(reg));
+            };
+
+            if (registers.empty()
+                || (registers.front() >= first_temp_reg
+                && registers.back() + 1 == func.register_count()
+                && are_consecutive(registers)
+                && std::none_of(registers.begin(), registers.end(), owns_reference))) {
+                return registers;
+            }
+
+            Regs consecutive_registers = func.allocate_registers(registers.size());
+
+            for (std::size_t idx = 0; idx < registers.size(); ++idx) {
+                func.emit_move(consecutive_registers[idx], registers[idx]);
+            }
+
+            return consecutive_registers;
+        }
+
         void KirLoweringPass::visit(class Call& call) {
+            // Push all return registers
+            for (auto reg : lower_call(call, false)) {
+                push_register(reg);
+            }
+        }
+
+        Regs KirLoweringPass::lower_call(class Call& call, bool tail_call) {
             auto& func = current_function();
-            Regs arg_registers = visit_function_arguments(call);
+            Reg first_temp_reg = func.register_count();
+
+            // The callee's register window starts at the first argument so
+            // arguments must be in consecutive registers at the top of the
+            // caller's register window
+            Regs arg_registers = make_consecutive(
+                visit_function_arguments(call),
+                first_temp_reg
+            );
+
             auto opcode = Bytecode::LoadFunction;
             int func_index = -1;
             int return_register_count = 0;
+            const FunctionType* func_type = nullptr;
 
             // Check if this is a built-in function
             auto builtin_function = vm::get_builtin_function_by_name(call.name());
@@ -315,53 +430,100 @@ namespace kore {
                 trace_kir("builtin call", call.name());
                 opcode = Bytecode::LoadBuiltin;
                 func_index = builtin_function->index;
-                return_register_count = builtin_function->type->return_arity();
+                func_type = builtin_function->type();
             } else {
                 trace_kir("call", call.name());
 
                 auto user_func = _functions[call.name()];
                 func_index = user_func.func_index;
-                return_register_count = user_func.func->type()->return_arity();
+                func_type = user_func.func->type();
             }
 
-            Regs return_registers = func.allocate_registers(return_register_count);
+            return_register_count = func_type->return_arity();
 
-            func.emit_call(
-                func.emit_load_function(func_index, opcode),
-                arg_registers,
-                return_registers
-            );
+            // Return values end up at the start of the callee's register
+            // window so make sure the window fits all of them
+            Reg base = arg_registers.empty() ? func.register_count() : arg_registers.front();
+            int extra_register_count = base + return_register_count - func.register_count();
 
-            // Push all return registers
-            for (auto reg : return_registers) {
-                push_register(reg);
+            if (extra_register_count > 0) {
+                func.allocate_registers(extra_register_count);
+            }
+
+            Regs return_registers;
+
+            for (int idx = 0; idx < return_register_count; ++idx) {
+                return_registers.push_back(base + idx);
+            }
+
+            // The function register is read before the call overwrites it
+            // so it can be part of the callee's register window
+            Reg func_reg = func.emit_load_function(func_index, opcode);
+
+            if (tail_call) {
+                func.emit_tail_call(func_reg, base, arg_registers);
+            } else {
+                func.emit_call(func_reg, base, arg_registers, return_registers);
+
+                // Arguments are borrowed by the callee and the caller owns
+                // the returned values which replace them
+                for (int idx = 0; idx < return_register_count; ++idx) {
+                    func.set_register_type(return_registers[idx], func_type->return_type(idx));
+                }
             }
+
+            return return_registers;
         }
 
         void KirLoweringPass::visit(Return& ret) {
             trace_kir("return");
             auto& func = current_function();
 
-            // If the return statement returns an expression, generate code
-            // for it, then get its register
-            if (ret.expr_count() > 0) {
+            // If the return statement directly returns the values of a call,
+            // emit a tail call that reuses the current call frame instead
+            //
+            // Nothing is released before a tail call since its arguments
+            // may borrow the values of local variables
+            if (ret.expr_count() == 1 && ret.get_expr(0)->expr_type() == ExpressionType::Call) {
+                trace_kir("tail call");
+                lower_call(*static_cast<class Call*>(ret.get_expr(0)), true);
+            } else if (ret.expr_count() > 0) {
+                // If the return statement returns an expression, generate code
+                // for it, then get its register
                 std::vector<Reg> regs;
 
                 for (auto& expr : ret) {
                     regs.push_back(visit_expression(expr.get()));
                 }
 
-                func.emit_return(regs);
+                // The caller owns the returned values. Values the function
+                // only borrows, or returns more than once, need a reference
+                // of their own
+                for (std::size_t idx = 0; idx < regs.size(); ++idx) {
+                    auto reg = regs[idx];
+                    bool owned = is_reference_counted(func.register_type(reg))
+                        && std::find(regs.begin(), regs.begin() + idx, reg) == regs.begin() + idx;
+
+                    if (is_reference_counted(ret.get_expr(idx)->type()) && !owned) {
+                        func.emit_refinc(reg);
+                    }
 
-                for (auto reg : regs) {
                     func.set_register_state(reg, RegisterState::Moved);
                 }
+
+                // Return values are moved to the start of the register window
+                // by the return instruction so they must be consecutive
+                if (!are_consecutive(regs)) {
+                    regs = make_consecutive(regs, func.register_count());
+                }
+
+                func.free_registers();
+                func.emit_return(regs);
             } else {
                 // Otherwise return zero registers
+                func.free_registers();
                 func.emit_return();
             }
-
-            func.free_registers();
         }
 
         void KirLoweringPass::trace_kir(const std::string& name, const std::string& msg) {
@@ -415,8 +577,26 @@ namespace kore {
             graph.add_edge(BasicBlock::StartBlockId, graph.add_block_as_current());
         }
 
+        void KirLoweringPass::lower_statement(Statement* statement) {
+            auto& func = current_function();
+            auto location = func.current_location();
+
+            func.set_location(statement->location());
+            statement->accept(*this);
+
+            // Instructions emitted by an enclosing statement after this one,
+            // such as the jumps of an if statement, belong to the enclosing
+            // statement
+            func.set_location(location);
+        }
+
         Reg KirLoweringPass::visit_expression(Expression* expr) {
+            auto& func = current_function();
+            auto location = func.current_location();
+
+            func.set_location(expr->location());
             expr->accept(*this);
+            func.set_location(location);
 
             return pop_register();
         }
@@ -63,7 +63,12 @@ namespace kore {
                 void add_kir_function(kore::Function* function);
                 Regs visit_function_arguments(class Call& call);
                 Regs allocate_function_return_registers(class Call& call);
+                Regs make_consecutive(const Regs& registers, Reg first_temp_reg);
+                Regs lower_call(class Call& call, bool tail_call);
 
+                /// Lower a statement or expression and attribute the
+                /// instructions emitted for it to its source location
+                void lower_statement(Statement* statement);
                 Reg visit_expression(Expression* expr);
                 void check_register_state(Identifier& expr, Reg reg);
                 void push_register(Reg reg);
@@ -0,0 +1,389 @@
+#include <algorithm>
+#include <iterator>
+
+#include "targets/bytecode/codegen/kir/ownership_analyser.hpp"
+
+namespace kore {
+    namespace kir {
+        bool is_release(const Instruction& instruction) {
+            return instruction.opcode == Bytecode::RefDec || instruction.opcode == Bytecode::Destroy;
+        }
+
+        /// Add the registers that an instruction may assign an array to. A
+        /// destroyed register is assigned a cleared value
+        void add_assigned_registers(const Instruction& instruction, std::set<Reg>& assigned) {
+            auto opcode = instruction.opcode;
+            auto& type = instruction.type;
+
+            if (is_array_alloc_opcode(opcode) || opcode == Bytecode::Gload || opcode == Bytecode::LoadBool) {
+                assigned.insert(std::get<RegisterAndValue>(type).reg);
+            } else if (opcode == Bytecode::ArrayGet) {
+                assigned.insert(std::get<ThreeRegisters>(type).reg3);
+            } else if (opcode == Bytecode::Move) {
+                assigned.insert(std::get<TwoRegisters>(type).reg1);
+            } else if (opcode == Bytecode::Destroy) {
+                assigned.insert(std::get<OneRegister>(type).reg);
+            } else if (auto call = std::get_if<CallV>(&type)) {
+                assigned.insert(call->ret_registers.begin(), call->ret_registers.end());
+            }
+        }
+
+        OwnershipAnalyser::OwnershipAnalyser() {}
+
+        OwnershipAnalyser::~OwnershipAnalyser() {}
+
+        void OwnershipAnalyser::analyse(Kir& kir) {
+            for (auto& module : kir) {
+                analyse(module);
+            }
+        }
+
+        void OwnershipAnalyser::analyse(Module& module) {
+            for (auto& function : module) {
+                analyse(function);
+            }
+        }
+
+        void OwnershipAnalyser::analyse(Function& function) {
+            auto& graph = function.graph();
+
+            find_owned_registers(function);
+
+            if (!_owned.empty()) {
+                for (std::size_t id = 0; id < graph.size(); ++id) {
+                    find_uses(graph[id]);
+                }
+
+                compute_liveness(function);
+                place_destroys(function);
+            }
+
+            add_drop_flags(function);
+        }
+
+        int OwnershipAnalyser::placed_count() const noexcept {
+            return _placed_count;
+        }
+
+        int OwnershipAnalyser::drop_flag_count() const noexcept {
+            return _drop_flag_count;
+        }
+
+        void OwnershipAnalyser::find_owned_registers(Function& function) {
+            auto& graph = function.graph();
+
+            _owned.clear();
+            _uses.clear();
+            _defs.clear();
+            _live_in.clear();
+            _live_out.clear();
+
+            // Remove the destroys of owned registers, which the lowering
+            // pass emits before returning, to place them anew
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                auto& instructions = graph[id].instructions;
+
+                for (auto& instruction : instructions) {
+                    if (instruction.opcode == Bytecode::Destroy) {
+                        _owned.insert(std::get<OneRegister>(instruction.type).reg);
+                    }
+                }
+
+                instructions.erase(
+                    std::remove_if(
+                        instructions.begin(),
+                        instructions.end(),
+                        [](const Instruction& instruction) {
+                            return instruction.opcode == Bytecode::Destroy;
+                        }
+                    ),
+                    instructions.end()
+                );
+            }
+        }
+
+        void OwnershipAnalyser::find_uses(BasicBlock& block) {
+            auto& instructions = block.instructions;
+            auto& uses = _uses[block.id];
+            auto& defs = _defs[block.id];
+
+            // Copies of owned registers borrowed by builtin functions
+            std::unordered_map<Reg, Reg> borrows;
+
+            uses.assign(instructions.size(), {});
+            defs.assign(instructions.size(), {});
+
+            for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                auto& instruction = instructions[idx];
+
+                for (auto reg : _owned) {
+                    if (!uses_register(instruction, reg)) {
+                        continue;
+                    }
+
+                    if (is_array_alloc_opcode(instruction.opcode)) {
+                        defs[idx].insert(reg);
+                    } else {
+                        uses[idx].insert(reg);
+                    }
+                }
+
+                for (auto [copy, reg] : borrows) {
+                    if (uses_register(instruction, copy)) {
+                        uses[idx].insert(reg);
+                    }
+                }
+
+                // A borrow ends when the builtin function returns a value in
+                // place of the copy
+                if (auto call = std::get_if<CallV>(&instruction.type)) {
+                    for (auto ret_reg : call->ret_registers) {
+                        borrows.erase(ret_reg);
+                    }
+                } else if (instruction.opcode == Bytecode::Move) {
+                    auto move = std::get<TwoRegisters>(instruction.type);
+
+                    if (_owned.find(move.reg2) != _owned.end()) {
+                        borrows[move.reg1] = move.reg2;
+                    }
+                }
+            }
+        }
+
+        void OwnershipAnalyser::compute_liveness(Function& function) {
+            auto& graph = function.graph();
+            std::unordered_map<BlockId, RegisterSet> upward_uses;
+            std::unordered_map<BlockId, RegisterSet> block_defs;
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                auto& uses = _uses[id];
+                auto& defs = _defs[id];
+
+                for (std::size_t idx = 0; idx < uses.size(); ++idx) {
+                    for (auto reg : uses[idx]) {
+                        if (block_defs[id].find(reg) == block_defs[id].end()) {
+                            upward_uses[id].insert(reg);
+                        }
+                    }
+
+                    block_defs[id].insert(defs[idx].begin(), defs[idx].end());
+                }
+            }
+
+            // Iterate backwards over the blocks until the live registers
+            // reach a fixed point since loops jump back to earlier blocks
+            bool changed = true;
+
+            while (changed) {
+                changed = false;
+
+                for (BlockId id = static_cast<BlockId>(graph.size()) - 1; id >= 0; --id) {
+                    RegisterSet live_out;
+
+                    if (graph.has_successors(id) && !leaves_function(graph[id])) {
+                        for (auto succ = graph.successor_begin(id); succ != graph.successor_end(id); ++succ) {
+                            live_out.insert(_live_in[*succ].begin(), _live_in[*succ].end());
+                        }
+                    }
+
+                    RegisterSet live_in = upward_uses[id];
+
+                    std::set_difference(
+                        live_out.begin(),
+                        live_out.end(),
+                        block_defs[id].begin(),
+                        block_defs[id].end(),
+                        std::inserter(live_in, live_in.end())
+                    );
+
+                    if (live_in != _live_in[id] || live_out != _live_out[id]) {
+                        _live_in[id] = std::move(live_in);
+                        _live_out[id] = std::move(live_out);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        void OwnershipAnalyser::place_destroys(Function& function) {
+            auto& graph = function.graph();
+
+            // Registers to destroy after each instruction and at the start
+            // of each block
+            std::unordered_map<BlockId, std::unordered_map<std::size_t, RegisterSet>> destroys;
+            std::unordered_map<BlockId, RegisterSet> entry_destroys;
+
+            for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                auto& uses = _uses[id];
+                auto& defs = _defs[id];
+                auto live = _live_out[id];
+
+                // A register dies at its last use, or where it is assigned
+                // if it is never used
+                for (std::size_t idx = uses.size(); idx-- > 0;) {
+                    for (auto reg : uses[idx]) {
+                        if (live.find(reg) == live.end()) {
+                            destroys[id][idx].insert(reg);
+                        }
+                    }
+
+                    for (auto reg : defs[idx]) {
+                        if (live.find(reg) == live.end() && uses[idx].find(reg) == uses[idx].end()) {
+                            destroys[id][idx].insert(reg);
+                        }
+
+                        live.erase(reg);
+                    }
+
+                    live.insert(uses[idx].begin(), uses[idx].end());
+                }
+
+                // A register that is live along only some of the edges out of
+                // the block dies along the others
+                if (_live_out[id].empty()) {
+                    continue;
+                }
+
+                for (auto succ = graph.successor_begin(id); succ != graph.successor_end(id); ++succ) {
+                    for (auto reg : _live_out[id]) {
+                        if (_live_in[*succ].find(reg) == _live_in[*succ].end()) {
+                            entry_destroys[*succ].insert(reg);
+                        }
+                    }
+                }
+            }
+
+            for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                auto& instructions = graph[id].instructions;
+                std::vector<Instruction> placed;
+                auto location = instructions.empty() ? SourceLocation::unknown : instructions.front().location;
+
+                for (auto reg : entry_destroys[id]) {
+                    placed.push_back(Instruction{ Bytecode::Destroy, OneRegister{ reg }, location });
+                    ++_placed_count;
+                }
+
+                for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                    placed.push_back(instructions[idx]);
+
+                    for (auto reg : destroys[id][idx]) {
+                        placed.push_back(Instruction{ Bytecode::Destroy, OneRegister{ reg }, instructions[idx].location });
+                        ++_placed_count;
+                    }
+                }
+
+                instructions = std::move(placed);
+            }
+        }
+
+        void OwnershipAnalyser::add_drop_flags(Function& function) {
+            auto& graph = function.graph();
+            RegisterSet released;
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                for (auto& instruction : graph[id].instructions) {
+                    if (is_release(instruction)) {
+                        released.insert(std::get<OneRegister>(instruction.type).reg);
+                    }
+                }
+            }
+
+            if (released.empty()) {
+                return;
+            }
+
+            // Find the released registers that are assigned on every path
+            // into each block. Nothing is assigned when the function is
+            // entered and blocks start out with everything assigned until
+            // the paths into them are known
+            std::unordered_map<BlockId, RegisterSet> assigned_in;
+            std::unordered_map<BlockId, RegisterSet> assigned_out;
+
+            for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                if (id != BasicBlock::StartBlockId) {
+                    assigned_in[id] = released;
+                    assigned_out[id] = released;
+                }
+            }
+
+            bool changed = true;
+
+            while (changed) {
+                changed = false;
+
+                for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                    if (id == BasicBlock::StartBlockId || !graph.has_predecessors(id)) {
+                        continue;
+                    }
+
+                    RegisterSet assigned = released;
+
+                    for (auto pred = graph.predecessor_begin(id); pred != graph.predecessor_end(id); ++pred) {
+                        RegisterSet intersection;
+
+                        std::set_intersection(
+                            assigned.begin(),
+                            assigned.end(),
+                            assigned_out[*pred].begin(),
+                            assigned_out[*pred].end(),
+                            std::inserter(intersection, intersection.end())
+                        );
+
+                        assigned = std::move(intersection);
+                    }
+
+                    assigned_in[id] = assigned;
+
+                    for (auto& instruction : graph[id].instructions) {
+                        add_assigned_registers(instruction, assigned);
+                    }
+
+                    for (auto it = assigned.begin(); it != assigned.end();) {
+                        it = released.find(*it) == released.end() ? assigned.erase(it) : std::next(it);
+                    }
+
+                    if (assigned != assigned_out[id]) {
+                        assigned_out[id] = std::move(assigned);
+                        changed = true;
+                    }
+                }
+            }
+
+            // Registers that may be released before they are assigned need
+            // a drop flag
+            RegisterSet flagged;
+
+            for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                auto assigned = assigned_in[id];
+
+                for (auto& instruction : graph[id].instructions) {
+                    if (is_release(instruction)) {
+                        auto reg = std::get<OneRegister>(instruction.type).reg;
+
+                        if (assigned.find(reg) == assigned.end()) {
+                            flagged.insert(reg);
+                        }
+                    }
+
+                    add_assigned_registers(instruction, assigned);
+                }
+            }
+
+            if (flagged.empty()) {
+                return;
+            }
+
+            // The register itself is the drop flag. Releasing a register
+            // that holds false instead of an array does nothing
+            auto current_block_id = graph.current_block().id;
+            graph.set_current_block(graph.add_entry_block());
+
+            for (auto reg : flagged) {
+                function.add_instruction(Instruction{ Bytecode::LoadBool, RegisterAndValue{ reg, 0 } });
+                ++_drop_flag_count;
+            }
+
+            graph.set_current_block(current_block_id);
+        }
+    }
+}
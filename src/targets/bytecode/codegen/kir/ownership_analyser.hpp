@@ -0,0 +1,78 @@
+#ifndef KORE_KIR_OWNERSHIP_ANALYSER_HPP
+#define KORE_KIR_OWNERSHIP_ANALYSER_HPP
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "targets/bytecode/codegen/kir/function.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/codegen/kir/module.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Ownership and borrow analysis over the control flow graph of a
+        /// function which decides statically where arrays are freed:
+        ///
+        /// * An array uniquely owned by a register, i.e. one the reference
+        ///   count optimiser releases with Destroy, is destroyed right after
+        ///   the last use of the register along every path through the
+        ///   function instead of when the function returns. Uses of a copy
+        ///   borrowed by a builtin function count as uses of the register.
+        ///   If the register is live at the end of a block but not at the
+        ///   start of a successor, it is destroyed at the start of that
+        ///   successor.
+        /// * Destroy clears its register so an array destroyed on several
+        ///   paths into a join is only freed once. Registers that are not
+        ///   assigned on every path to an instruction releasing them, i.e.
+        ///   maybe moved at a join, get a drop flag: they are cleared when
+        ///   the function is entered so releasing them before they are
+        ///   assigned does nothing.
+        ///
+        /// The analysis must run after the KIR lowering pass since it emits
+        /// releases that rely on drop flags
+        class OwnershipAnalyser final {
+            public:
+                OwnershipAnalyser();
+                virtual ~OwnershipAnalyser();
+
+                void analyse(Kir& kir);
+                void analyse(Module& module);
+                void analyse(Function& function);
+
+                /// The number of Destroy instructions placed after the last
+                /// use of a register so far
+                int placed_count() const noexcept;
+
+                /// The number of registers given a drop flag so far
+                int drop_flag_count() const noexcept;
+
+            private:
+                using RegisterSet = std::set<Reg>;
+
+                int _placed_count = 0;
+                int _drop_flag_count = 0;
+
+                // Registers that uniquely own an array in the current function
+                RegisterSet _owned;
+
+                // The owned registers each instruction of a block uses and
+                // assigns
+                std::unordered_map<BlockId, std::vector<RegisterSet>> _uses;
+                std::unordered_map<BlockId, std::vector<RegisterSet>> _defs;
+
+                // Owned registers live at the start and end of each block
+                std::unordered_map<BlockId, RegisterSet> _live_in;
+                std::unordered_map<BlockId, RegisterSet> _live_out;
+
+            private:
+                void find_owned_registers(Function& function);
+                void find_uses(BasicBlock& block);
+                void compute_liveness(Function& function);
+                void place_destroys(Function& function);
+                void add_drop_flags(Function& function);
+        };
+    }
+}
+
+#endif // KORE_KIR_OWNERSHIP_ANALYSER_HPP
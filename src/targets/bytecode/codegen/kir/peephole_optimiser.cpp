@@ -0,0 +1,260 @@
+#include <limits>
+#include <map>
+
+#include "targets/bytecode/codegen/kir/peephole_optimiser.hpp"
+
+namespace kore {
+    namespace kir {
+        // Map a comparison to the compare-and-branch opcodes that replace it
+        // when followed by a JumpIf and a JumpIfNot respectively. Negating
+        // the comparison for JumpIfNot is only valid for integers
+        std::map<Bytecode, std::pair<Bytecode, Bytecode>> _compare_and_branch_opcodes = {
+            { Bytecode::LtI32,  { Bytecode::JumpIfLtI32,  Bytecode::JumpIfGeI32  } },
+            { Bytecode::GtI32,  { Bytecode::JumpIfGtI32,  Bytecode::JumpIfLeI32  } },
+            { Bytecode::LeI32,  { Bytecode::JumpIfLeI32,  Bytecode::JumpIfGtI32  } },
+            { Bytecode::GeI32,  { Bytecode::JumpIfGeI32,  Bytecode::JumpIfLtI32  } },
+            { Bytecode::EqI32,  { Bytecode::JumpIfEqI32,  Bytecode::JumpIfNeqI32 } },
+            { Bytecode::NeqI32, { Bytecode::JumpIfNeqI32, Bytecode::JumpIfEqI32  } },
+        };
+
+        std::map<Bytecode, Bytecode> _constant_operand_opcodes = {
+            { Bytecode::AddI32, Bytecode::AddI32K },
+            { Bytecode::SubI32, Bytecode::SubI32K },
+        };
+
+        PeepholeOptimiser::PeepholeOptimiser() {}
+
+        PeepholeOptimiser::~PeepholeOptimiser() {}
+
+        void PeepholeOptimiser::optimise(Kir& kir) {
+            for (auto& module : kir) {
+                optimise(module);
+            }
+        }
+
+        void PeepholeOptimiser::optimise(Module& module) {
+            for (auto& function : module) {
+                optimise(module, function);
+            }
+        }
+
+        void PeepholeOptimiser::optimise(Module& module, Function& function) {
+            auto& graph = function.graph();
+
+            count_register_uses(function);
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                fuse_compare_and_branch(graph[id]);
+                fuse_constant_operands(module, function, graph[id]);
+            }
+
+            remove_fused_instructions(function);
+        }
+
+        int PeepholeOptimiser::fused_count() const noexcept {
+            return _fused_count;
+        }
+
+        void PeepholeOptimiser::count_register_uses(Function& function) {
+            auto& graph = function.graph();
+
+            _register_uses.clear();
+            _constant_loads.clear();
+            _removed.clear();
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                auto& instructions = graph[id].instructions;
+
+                for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                    auto& instruction = instructions[idx];
+                    auto& type = instruction.type;
+
+                    if (auto ins_type = std::get_if<OneRegister>(&type)) {
+                        ++_register_uses[ins_type->reg];
+                    } else if (auto ins_type = std::get_if<TwoRegisters>(&type)) {
+                        ++_register_uses[ins_type->reg1];
+                        ++_register_uses[ins_type->reg2];
+                    } else if (auto ins_type = std::get_if<ThreeRegisters>(&type)) {
+                        ++_register_uses[ins_type->reg1];
+                        ++_register_uses[ins_type->reg2];
+                        ++_register_uses[ins_type->reg3];
+                    } else if (auto ins_type = std::get_if<RegisterAndValue>(&type)) {
+                        ++_register_uses[ins_type->reg];
+
+                        if (instruction.opcode == Bytecode::Cload) {
+                            _constant_loads[ins_type->reg] = { static_cast<BlockId>(id), idx };
+                        }
+                    } else if (auto ins_type = std::get_if<TwoRegistersAndValue>(&type)) {
+                        ++_register_uses[ins_type->reg1];
+                        ++_register_uses[ins_type->reg2];
+                    } else if (auto ins_type = std::get_if<CallV>(&type)) {
+                        ++_register_uses[ins_type->func_index];
+
+                        for (auto reg : ins_type->arg_registers) {
+                            ++_register_uses[reg];
+                        }
+
+                        for (auto reg : ins_type->ret_registers) {
+                            ++_register_uses[reg];
+                        }
+                    } else if (auto ins_type = std::get_if<ReturnV>(&type)) {
+                        for (auto reg : ins_type->registers) {
+                            ++_register_uses[reg];
+                        }
+                    }
+                }
+            }
+        }
+
+        void PeepholeOptimiser::fuse_compare_and_branch(BasicBlock& block) {
+            auto& instructions = block.instructions;
+
+            for (std::size_t idx = 0; idx + 1 < instructions.size(); ++idx) {
+                auto& compare = instructions[idx];
+                auto& jump = instructions[idx + 1];
+                auto entry = _compare_and_branch_opcodes.find(compare.opcode);
+
+                if (entry == _compare_and_branch_opcodes.end()) {
+                    continue;
+                }
+
+                if (jump.opcode != Bytecode::JumpIf && jump.opcode != Bytecode::JumpIfNot) {
+                    continue;
+                }
+
+                auto compare_type = std::get_if<ThreeRegisters>(&compare.type);
+                auto jump_type = std::get_if<RegisterAndValue>(&jump.type);
+
+                // The result of the comparison must only be used by the jump
+                if (!compare_type || !jump_type || jump_type->reg != compare_type->reg1) {
+                    continue;
+                }
+
+                if (_register_uses[compare_type->reg1] != 2) {
+                    continue;
+                }
+
+                auto opcode = jump.opcode == Bytecode::JumpIf
+                    ? entry->second.first
+                    : entry->second.second;
+
+                compare = Instruction{
+                    opcode,
+                    TwoRegistersAndValue{
+                        compare_type->reg2,
+                        compare_type->reg3,
+                        jump_type->value
+                    },
+                    compare.location
+                };
+
+                _removed.insert({ block.id, ++idx });
+                ++_fused_count;
+            }
+        }
+
+        void PeepholeOptimiser::fuse_constant_operands(
+            Module& module,
+            Function& function,
+            BasicBlock& block
+        ) {
+            for (auto& instruction : block.instructions) {
+                auto entry = _constant_operand_opcodes.find(instruction.opcode);
+
+                if (entry == _constant_operand_opcodes.end()) {
+                    continue;
+                }
+
+                auto ins_type = std::get_if<ThreeRegisters>(&instruction.type);
+
+                if (!ins_type) {
+                    continue;
+                }
+
+                Reg dst_reg = ins_type->reg1;
+                Reg reg = ins_type->reg2;
+                Reg constant_reg = ins_type->reg3;
+                int value = 0;
+
+                if (!get_small_constant(module, function, constant_reg, value)) {
+                    // Addition is commutative so also try the left operand
+                    if (instruction.opcode != Bytecode::AddI32) {
+                        continue;
+                    }
+
+                    std::swap(reg, constant_reg);
+
+                    if (!get_small_constant(module, function, constant_reg, value)) {
+                        continue;
+                    }
+                }
+
+                _removed.insert(_constant_loads[constant_reg]);
+
+                instruction = Instruction{
+                    entry->second,
+                    TwoRegistersAndValue{ dst_reg, reg, value },
+                    instruction.location
+                };
+
+                ++_fused_count;
+            }
+        }
+
+        bool PeepholeOptimiser::get_small_constant(
+            Module& module,
+            Function& function,
+            Reg reg,
+            int& value
+        ) {
+            auto entry = _constant_loads.find(reg);
+
+            // The constant must only be used by the instruction being fused
+            if (entry == _constant_loads.end() || _register_uses[reg] != 2) {
+                return false;
+            }
+
+            auto [block_id, idx] = entry->second;
+            auto& load = function.graph()[block_id].instructions[idx];
+            auto index = std::get<RegisterAndValue>(load.type).value;
+            auto constant = module.constant_table().get(index);
+
+            if (constant.tag != vm::ValueTag::I32) {
+                return false;
+            }
+
+            // The immediate operand is a signed 8-bit value
+            auto i32_value = constant.as_i32();
+
+            if (i32_value < std::numeric_limits<std::int8_t>::min()
+                || i32_value > std::numeric_limits<std::int8_t>::max()) {
+                return false;
+            }
+
+            value = i32_value;
+
+            return true;
+        }
+
+        void PeepholeOptimiser::remove_fused_instructions(Function& function) {
+            if (_removed.empty()) {
+                return;
+            }
+
+            auto& graph = function.graph();
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                auto& instructions = graph[id].instructions;
+                std::vector<Instruction> kept;
+
+                for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                    if (_removed.find({ static_cast<BlockId>(id), idx }) == _removed.end()) {
+                        kept.push_back(instructions[idx]);
+                    }
+                }
+
+                instructions = std::move(kept);
+            }
+        }
+    }
+}
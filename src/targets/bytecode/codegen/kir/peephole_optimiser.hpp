@@ -0,0 +1,64 @@
+#ifndef KORE_KIR_PEEPHOLE_OPTIMISER_HPP
+#define KORE_KIR_PEEPHOLE_OPTIMISER_HPP
+
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+#include "targets/bytecode/codegen/kir/function.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/codegen/kir/module.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Peephole optimiser that fuses common instruction sequences into
+        /// superinstructions to reduce the number of instructions the vm
+        /// needs to dispatch:
+        ///
+        /// * A 32-bit integer comparison immediately followed by a conditional
+        ///   jump on its result becomes a single compare-and-branch
+        ///   instruction, e.g. JumpIfLtI32.
+        /// * A 32-bit integer addition or subtraction where one operand is a
+        ///   small constant becomes an instruction with an immediate operand,
+        ///   e.g. AddI32K.
+        ///
+        /// Instructions are only fused if the intermediate register is not
+        /// used by any other instruction in the function
+        class PeepholeOptimiser final {
+            public:
+                PeepholeOptimiser();
+                virtual ~PeepholeOptimiser();
+
+                void optimise(Kir& kir);
+                void optimise(Module& module);
+                void optimise(Module& module, Function& function);
+
+                /// The number of superinstructions created so far
+                int fused_count() const noexcept;
+
+            private:
+                using InstructionLocation = std::pair<BlockId, std::size_t>;
+
+                int _fused_count = 0;
+
+                // The number of times each register is referenced by an
+                // instruction in the current function
+                std::unordered_map<Reg, int> _register_uses;
+
+                // Location of the Cload instruction that loads each register
+                std::unordered_map<Reg, InstructionLocation> _constant_loads;
+
+                // Instructions made redundant by fusion
+                std::set<InstructionLocation> _removed;
+
+            private:
+                void count_register_uses(Function& function);
+                void fuse_compare_and_branch(BasicBlock& block);
+                void fuse_constant_operands(Module& module, Function& function, BasicBlock& block);
+                bool get_small_constant(Module& module, Function& function, Reg reg, int& value);
+                void remove_fused_instructions(Function& function);
+        };
+    }
+}
+
+#endif // KORE_KIR_PEEPHOLE_OPTIMISER_HPP
@@ -0,0 +1,202 @@
+#include "targets/bytecode/codegen/kir/ref_count_optimiser.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Whether an instruction may change the reference count of any
+        /// array, including by calling a function that does
+        bool changes_ref_counts(const Instruction& instruction) {
+            switch (instruction.opcode) {
+                case Bytecode::RefInc:
+                case Bytecode::RefDec:
+                case Bytecode::Destroy:
+                    return true;
+
+                default:
+                    return std::holds_alternative<CallV>(instruction.type)
+                        || std::holds_alternative<ReturnV>(instruction.type);
+            }
+        }
+
+        RefCountOptimiser::RefCountOptimiser() {}
+
+        RefCountOptimiser::~RefCountOptimiser() {}
+
+        void RefCountOptimiser::optimise(Kir& kir) {
+            for (auto& module : kir) {
+                optimise(module);
+            }
+        }
+
+        void RefCountOptimiser::optimise(Module& module) {
+            find_global_loads(module);
+
+            for (auto& function : module) {
+                optimise(module, function);
+            }
+        }
+
+        void RefCountOptimiser::optimise(Module& module, Function& function) {
+            auto& graph = function.graph();
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                cancel_pairs(graph[id]);
+            }
+
+            find_shared_registers(module, function);
+            destroy_unique_registers(function);
+        }
+
+        int RefCountOptimiser::cancelled_count() const noexcept {
+            return _cancelled_count;
+        }
+
+        int RefCountOptimiser::destroyed_count() const noexcept {
+            return _destroyed_count;
+        }
+
+        void RefCountOptimiser::cancel_pairs(BasicBlock& block) {
+            auto& instructions = block.instructions;
+            std::vector<bool> removed(instructions.size(), false);
+
+            for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                if (instructions[idx].opcode != Bytecode::RefInc) {
+                    continue;
+                }
+
+                Reg reg = std::get<OneRegister>(instructions[idx].type).reg;
+
+                for (std::size_t next_idx = idx + 1; next_idx < instructions.size(); ++next_idx) {
+                    auto& next = instructions[next_idx];
+
+                    if (removed[next_idx]) {
+                        continue;
+                    }
+
+                    if (next.opcode == Bytecode::RefDec && std::get<OneRegister>(next.type).reg == reg) {
+                        removed[idx] = true;
+                        removed[next_idx] = true;
+                        ++_cancelled_count;
+                        break;
+                    }
+
+                    if (changes_ref_counts(next) || uses_register(next, reg)) {
+                        break;
+                    }
+                }
+            }
+
+            std::vector<Instruction> kept;
+
+            for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                if (!removed[idx]) {
+                    kept.push_back(instructions[idx]);
+                }
+            }
+
+            instructions = std::move(kept);
+        }
+
+        void RefCountOptimiser::find_global_loads(Module& module) {
+            _global_loads.clear();
+
+            for (auto& function : module) {
+                auto& graph = function.graph();
+
+                for (std::size_t id = 0; id < graph.size(); ++id) {
+                    for (auto& instruction : graph[id].instructions) {
+                        if (instruction.opcode == Bytecode::Gload) {
+                            _global_loads.insert(std::get<RegisterAndValue>(instruction.type).value);
+                        }
+                    }
+                }
+            }
+        }
+
+        void RefCountOptimiser::find_shared_registers(Module& module, Function& function) {
+            auto& graph = function.graph();
+
+            _allocations.clear();
+            _shared.clear();
+
+            // Globals are the registers of the main function
+            if (function.index() == module.main_function().index()) {
+                _shared.insert(_global_loads.begin(), _global_loads.end());
+            }
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                find_shared_registers(graph[id]);
+            }
+        }
+
+        void RefCountOptimiser::find_shared_registers(BasicBlock& block) {
+            auto& instructions = block.instructions;
+
+            for (std::size_t idx = 0; idx < instructions.size(); ++idx) {
+                auto& instruction = instructions[idx];
+                auto opcode = instruction.opcode;
+                auto& type = instruction.type;
+
+                if (auto ins_type = std::get_if<OneRegister>(&type)) {
+                    // Releasing a register does not share its array
+                    if (opcode != Bytecode::RefDec && opcode != Bytecode::Destroy) {
+                        _shared.insert(ins_type->reg);
+                    }
+                } else if (auto ins_type = std::get_if<TwoRegisters>(&type)) {
+                    // Both registers refer to the same array after a move
+                    // unless the copy is only borrowed by builtin functions
+                    _shared.insert(ins_type->reg1);
+
+                    if (opcode != Bytecode::Move || !is_borrowed_by_builtins(block, idx, ins_type->reg1)) {
+                        _shared.insert(ins_type->reg2);
+                    }
+                } else if (auto ins_type = std::get_if<ThreeRegisters>(&type)) {
+                    // Accessing an element does not share the indexed array
+                    if (!is_array_access_opcode(opcode)) {
+                        _shared.insert(ins_type->reg1);
+                    }
+
+                    _shared.insert(ins_type->reg2);
+                    _shared.insert(ins_type->reg3);
+                } else if (auto ins_type = std::get_if<RegisterAndValue>(&type)) {
+                    if (is_array_alloc_opcode(opcode)) {
+                        ++_allocations[ins_type->reg];
+                    } else {
+                        _shared.insert(ins_type->reg);
+                    }
+                } else if (auto ins_type = std::get_if<TwoRegistersAndValue>(&type)) {
+                    _shared.insert(ins_type->reg1);
+                    _shared.insert(ins_type->reg2);
+                } else if (auto ins_type = std::get_if<CallV>(&type)) {
+                    _shared.insert(ins_type->func_index);
+                    _shared.insert(ins_type->ret_registers.begin(), ins_type->ret_registers.end());
+
+                    if (!is_builtin_call(block, idx)) {
+                        _shared.insert(ins_type->arg_registers.begin(), ins_type->arg_registers.end());
+                    }
+                } else if (auto ins_type = std::get_if<ReturnV>(&type)) {
+                    _shared.insert(ins_type->registers.begin(), ins_type->registers.end());
+                }
+            }
+        }
+
+        void RefCountOptimiser::destroy_unique_registers(Function& function) {
+            auto& graph = function.graph();
+
+            for (std::size_t id = 0; id < graph.size(); ++id) {
+                for (auto& instruction : graph[id].instructions) {
+                    if (instruction.opcode != Bytecode::RefDec) {
+                        continue;
+                    }
+
+                    Reg reg = std::get<OneRegister>(instruction.type).reg;
+                    auto entry = _allocations.find(reg);
+
+                    if (entry != _allocations.end() && entry->second == 1 && _shared.find(reg) == _shared.end()) {
+                        instruction.opcode = Bytecode::Destroy;
+                        ++_destroyed_count;
+                    }
+                }
+            }
+        }
+    }
+}
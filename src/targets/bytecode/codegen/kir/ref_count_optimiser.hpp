@@ -0,0 +1,69 @@
+#ifndef KORE_KIR_REF_COUNT_OPTIMISER_HPP
+#define KORE_KIR_REF_COUNT_OPTIMISER_HPP
+
+#include <set>
+#include <unordered_map>
+
+#include "targets/bytecode/codegen/kir/function.hpp"
+#include "targets/bytecode/codegen/kir/kir.hpp"
+#include "targets/bytecode/codegen/kir/module.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Optimiser that removes reference counting the KIR lowering pass
+        /// emits but which can never free an array early or late:
+        ///
+        /// * A RefInc immediately followed by a RefDec of the same register
+        ///   cancel out and are both removed. Other instructions may come in
+        ///   between as long as they do not use the register and do not
+        ///   change any reference count, e.g. through a call.
+        /// * An array that is only ever referenced by the register it was
+        ///   allocated into is uniquely owned and its reference count is
+        ///   always one. Releasing it with RefDec becomes Destroy which frees
+        ///   the array without touching its reference count. The register
+        ///   may be read, written and passed to builtin functions which
+        ///   borrow it for the duration of the call, but not be copied
+        ///   anywhere else, returned or stored in another array. Registers of
+        ///   the main function that other functions read as globals are
+        ///   never uniquely owned
+        class RefCountOptimiser final {
+            public:
+                RefCountOptimiser();
+                virtual ~RefCountOptimiser();
+
+                void optimise(Kir& kir);
+                void optimise(Module& module);
+                void optimise(Module& module, Function& function);
+
+                /// The number of RefInc and RefDec pairs removed so far
+                int cancelled_count() const noexcept;
+
+                /// The number of RefDec instructions replaced by Destroy so far
+                int destroyed_count() const noexcept;
+
+            private:
+                int _cancelled_count = 0;
+                int _destroyed_count = 0;
+
+                // The number of array allocations into each register in the
+                // current function
+                std::unordered_map<Reg, int> _allocations;
+
+                // Registers that may share their array with another register
+                std::set<Reg> _shared;
+
+                // Indices of the globals loaded by any function of the
+                // current module
+                std::set<int> _global_loads;
+
+            private:
+                void cancel_pairs(BasicBlock& block);
+                void find_global_loads(Module& module);
+                void find_shared_registers(Module& module, Function& function);
+                void find_shared_registers(BasicBlock& block);
+                void destroy_unique_registers(Function& function);
+        };
+    }
+}
+
+#endif // KORE_KIR_REF_COUNT_OPTIMISER_HPP
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <iterator>
+
+#include "targets/bytecode/codegen/kir/stack_map_analyser.hpp"
+
+namespace kore {
+    namespace kir {
+        bool is_safepoint(const BasicBlock& block, std::size_t idx) {
+            auto opcode = block.instructions[idx].opcode;
+
+            return is_array_alloc_opcode(opcode)
+                || (opcode == Bytecode::Call && !is_builtin_call(block, idx));
+        }
+
+        /// Add the registers that an instruction reads
+        void add_used_registers(const Instruction& instruction, std::set<Reg>& used) {
+            auto opcode = instruction.opcode;
+            auto& type = instruction.type;
+
+            if (auto ins_type = std::get_if<OneRegister>(&type)) {
+                used.insert(ins_type->reg);
+            } else if (auto ins_type = std::get_if<TwoRegisters>(&type)) {
+                used.insert(ins_type->reg2);
+            } else if (auto ins_type = std::get_if<ThreeRegisters>(&type)) {
+                if (is_array_set_opcode(opcode)) {
+                    used.insert({ ins_type->reg1, ins_type->reg2, ins_type->reg3 });
+                } else if (is_array_access_opcode(opcode)) {
+                    used.insert({ ins_type->reg1, ins_type->reg2 });
+                } else {
+                    used.insert({ ins_type->reg2, ins_type->reg3 });
+                }
+            } else if (auto ins_type = std::get_if<RegisterAndValue>(&type)) {
+                if (opcode == Bytecode::JumpIf || opcode == Bytecode::JumpIfNot) {
+                    used.insert(ins_type->reg);
+                }
+            } else if (auto ins_type = std::get_if<TwoRegistersAndValue>(&type)) {
+                if (is_compare_and_branch_opcode(opcode)) {
+                    used.insert({ ins_type->reg1, ins_type->reg2 });
+                } else {
+                    used.insert(ins_type->reg2);
+                }
+            } else if (auto ins_type = std::get_if<CallV>(&type)) {
+                used.insert(ins_type->func_index);
+                used.insert(ins_type->arg_registers.begin(), ins_type->arg_registers.end());
+            } else if (auto ins_type = std::get_if<ReturnV>(&type)) {
+                used.insert(ins_type->registers.begin(), ins_type->registers.end());
+            }
+        }
+
+        /// Add the registers that an instruction assigns
+        void add_defined_registers(const Instruction& instruction, std::set<Reg>& defined) {
+            auto opcode = instruction.opcode;
+            auto& type = instruction.type;
+
+            if (auto ins_type = std::get_if<TwoRegisters>(&type)) {
+                // The first operand of a global store is a global index
+                if (opcode != Bytecode::Gstore) {
+                    defined.insert(ins_type->reg1);
+                }
+            } else if (auto ins_type = std::get_if<ThreeRegisters>(&type)) {
+                if (is_array_set_opcode(opcode)) {
+                    return;
+                } else if (is_array_access_opcode(opcode)) {
+                    defined.insert(ins_type->reg3);
+                } else {
+                    defined.insert(ins_type->reg1);
+                }
+            } else if (auto ins_type = std::get_if<RegisterAndValue>(&type)) {
+                if (opcode != Bytecode::JumpIf && opcode != Bytecode::JumpIfNot) {
+                    defined.insert(ins_type->reg);
+                }
+            } else if (auto ins_type = std::get_if<TwoRegistersAndValue>(&type)) {
+                if (!is_compare_and_branch_opcode(opcode)) {
+                    defined.insert(ins_type->reg1);
+                }
+            } else if (auto ins_type = std::get_if<CallV>(&type)) {
+                defined.insert(ins_type->ret_registers.begin(), ins_type->ret_registers.end());
+            }
+        }
+
+        /// Update the registers that may hold a heap object with the
+        /// registers an instruction assigns
+        void transfer_pointers(const Instruction& instruction, std::set<Reg>& pointers) {
+            auto opcode = instruction.opcode;
+            std::set<Reg> defined;
+            add_defined_registers(instruction, defined);
+
+            bool holds_pointers = is_array_alloc_opcode(opcode)
+                || opcode == Bytecode::ArrayGet
+                || opcode == Bytecode::Gload
+                || opcode == Bytecode::Call;
+
+            if (opcode == Bytecode::Move) {
+                auto move = std::get<TwoRegisters>(instruction.type);
+                holds_pointers = pointers.find(move.reg2) != pointers.end();
+            } else if (opcode == Bytecode::Destroy) {
+                // Destroy clears its register
+                pointers.erase(std::get<OneRegister>(instruction.type).reg);
+            }
+
+            for (auto reg : defined) {
+                if (holds_pointers) {
+                    pointers.insert(reg);
+                } else {
+                    pointers.erase(reg);
+                }
+            }
+        }
+
+        StackMapAnalyser::StackMapAnalyser() {}
+
+        StackMapAnalyser::~StackMapAnalyser() {}
+
+        void StackMapAnalyser::analyse(const Function& function) {
+            _pointers_in.clear();
+            _live_out.clear();
+            _roots.clear();
+
+            find_pointers(function);
+            compute_liveness(function);
+            find_roots(function);
+        }
+
+        std::vector<Reg> StackMapAnalyser::roots(BlockId id, std::size_t idx) const {
+            auto block_roots = _roots.find(id);
+
+            if (block_roots == _roots.end()) {
+                return {};
+            }
+
+            auto entry = block_roots->second.find(idx);
+
+            return entry == block_roots->second.end() ? std::vector<Reg>{} : entry->second;
+        }
+
+        void StackMapAnalyser::find_pointers(const Function& function) {
+            auto& graph = function.graph();
+
+            // Parameters are in the first registers when the function is
+            // entered
+            auto& entry_pointers = _pointers_in[BasicBlock::StartBlockId];
+
+            for (int idx = 0; idx < function.arity(); ++idx) {
+                if (is_reference_counted(function.parameter_type(idx))) {
+                    entry_pointers.insert(idx);
+                }
+            }
+
+            // Propagate forwards along the edges until a fixed point is
+            // reached since loops jump back to earlier blocks
+            bool changed = true;
+
+            while (changed) {
+                changed = false;
+
+                for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                    if (!graph.has_successors(id) || leaves_function(graph[id])) {
+                        continue;
+                    }
+
+                    auto pointers = _pointers_in[id];
+
+                    for (auto& instruction : graph[id].instructions) {
+                        transfer_pointers(instruction, pointers);
+                    }
+
+                    for (auto succ = graph.successor_cbegin(id); succ != graph.successor_cend(id); ++succ) {
+                        auto& succ_pointers = _pointers_in[*succ];
+                        auto size = succ_pointers.size();
+
+                        succ_pointers.insert(pointers.begin(), pointers.end());
+                        changed = changed || succ_pointers.size() != size;
+                    }
+                }
+            }
+        }
+
+        void StackMapAnalyser::compute_liveness(const Function& function) {
+            auto& graph = function.graph();
+            std::unordered_map<BlockId, RegisterSet> upward_uses;
+            std::unordered_map<BlockId, RegisterSet> block_defs;
+            std::unordered_map<BlockId, RegisterSet> live_in;
+
+            for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                for (auto& instruction : graph[id].instructions) {
+                    RegisterSet used;
+                    add_used_registers(instruction, used);
+
+                    for (auto reg : used) {
+                        if (block_defs[id].find(reg) == block_defs[id].end()) {
+                            upward_uses[id].insert(reg);
+                        }
+                    }
+
+                    add_defined_registers(instruction, block_defs[id]);
+                }
+            }
+
+            bool changed = true;
+
+            while (changed) {
+                changed = false;
+
+                for (BlockId id = static_cast<BlockId>(graph.size()) - 1; id >= 0; --id) {
+                    RegisterSet live_out;
+
+                    if (graph.has_successors(id) && !leaves_function(graph[id])) {
+                        for (auto succ = graph.successor_cbegin(id); succ != graph.successor_cend(id); ++succ) {
+                            live_out.insert(live_in[*succ].begin(), live_in[*succ].end());
+                        }
+                    }
+
+                    RegisterSet block_live_in = upward_uses[id];
+
+                    std::set_difference(
+                        live_out.begin(),
+                        live_out.end(),
+                        block_defs[id].begin(),
+                        block_defs[id].end(),
+                        std::inserter(block_live_in, block_live_in.end())
+                    );
+
+                    if (block_live_in != live_in[id] || live_out != _live_out[id]) {
+                        live_in[id] = std::move(block_live_in);
+                        _live_out[id] = std::move(live_out);
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        void StackMapAnalyser::find_roots(const Function& function) {
+            auto& graph = function.graph();
+
+            for (BlockId id = 0; id < static_cast<BlockId>(graph.size()); ++id) {
+                auto& block = graph[id];
+                auto& instructions = block.instructions;
+
+                // Registers that may hold a heap object before each
+                // instruction
+                std::vector<RegisterSet> pointers_before;
+                auto pointers = _pointers_in[id];
+
+                for (auto& instruction : instructions) {
+                    pointers_before.push_back(pointers);
+                    transfer_pointers(instruction, pointers);
+                }
+
+                auto live = _live_out[id];
+
+                for (std::size_t idx = instructions.size(); idx-- > 0;) {
+                    RegisterSet defined;
+                    RegisterSet used;
+                    add_defined_registers(instructions[idx], defined);
+                    add_used_registers(instructions[idx], used);
+
+                    if (is_safepoint(block, idx)) {
+                        auto& roots = _roots[id][idx];
+
+                        for (auto reg : live) {
+                            if (defined.find(reg) == defined.end()
+                                && pointers_before[idx].find(reg) != pointers_before[idx].end()) {
+                                roots.push_back(reg);
+                            }
+                        }
+                    }
+
+                    for (auto reg : defined) {
+                        live.erase(reg);
+                    }
+
+                    live.insert(used.begin(), used.end());
+                }
+            }
+        }
+    }
+}
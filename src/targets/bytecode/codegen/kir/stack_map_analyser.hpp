@@ -0,0 +1,64 @@
+#ifndef KORE_KIR_STACK_MAP_ANALYSER_HPP
+#define KORE_KIR_STACK_MAP_ANALYSER_HPP
+
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "targets/bytecode/codegen/kir/function.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Whether the vm may collect garbage while running an instruction,
+        /// i.e. if it allocates a heap object or calls a function that may.
+        /// Builtin functions never allocate
+        bool is_safepoint(const BasicBlock& block, std::size_t idx);
+
+        /// Computes the stack map of a function for the garbage collector:
+        /// the registers that may hold a heap object and are live across
+        /// each safepoint of the function.
+        ///
+        /// * A forward analysis finds the registers that may hold a heap
+        ///   object before each instruction. Heap objects come from array
+        ///   allocations, elements of arrays of register values, globals,
+        ///   parameters of a reference counted type and values returned by
+        ///   calls, and are copied by moves.
+        /// * A backward analysis finds the registers that are live after
+        ///   each instruction. Releasing a register uses it so arrays are
+        ///   kept alive until reference counting frees them.
+        ///
+        /// Registers the safepoint itself assigns are not roots since their
+        /// old value is overwritten
+        class StackMapAnalyser final {
+            public:
+                StackMapAnalyser();
+                virtual ~StackMapAnalyser();
+
+                void analyse(const Function& function);
+
+                /// The registers that are roots at a safepoint in ascending
+                /// order. Empty if the instruction is not a safepoint
+                std::vector<Reg> roots(BlockId id, std::size_t idx) const;
+
+            private:
+                using RegisterSet = std::set<Reg>;
+
+                // Registers that may hold a heap object at the start of each
+                // block
+                std::unordered_map<BlockId, RegisterSet> _pointers_in;
+
+                // Registers live at the end of each block
+                std::unordered_map<BlockId, RegisterSet> _live_out;
+
+                // Roots at the safepoints of each block by instruction index
+                std::unordered_map<BlockId, std::unordered_map<std::size_t, std::vector<Reg>>> _roots;
+
+            private:
+                void find_pointers(const Function& function);
+                void compute_liveness(const Function& function);
+                void find_roots(const Function& function);
+        };
+    }
+}
+
+#endif // KORE_KIR_STACK_MAP_ANALYSER_HPP
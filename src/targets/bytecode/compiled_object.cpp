@@ -23,12 +23,48 @@ namespace kore {
         int func_index,
         int locals_count,
         int reg_count,
-        const std::vector<bytecode_type>& instructions
+        const std::vector<bytecode_type>& instructions,
+        const LineTable& line_table
     ) : _name(name),
         _func_index(func_index),
         _location(location),
         _local_count(locals_count),
         _instructions(instructions),
+        _line_table(line_table),
+        _reg_count(reg_count),
+        _max_regs_used(0) {}
+
+    CompiledObject::CompiledObject(
+        const std::string& name,
+        const SourceLocation& location,
+        int func_index,
+        int locals_count,
+        int reg_count,
+        const bytecode_type* instructions,
+        std::size_t code_size,
+        const LineTable& line_table
+    ) : _name(name),
+        _func_index(func_index),
+        _location(location),
+        _local_count(locals_count),
+        _borrowed_instructions(instructions),
+        _borrowed_code_size(code_size),
+        _line_table(line_table),
+        _reg_count(reg_count),
+        _max_regs_used(0) {}
+
+    CompiledObject::CompiledObject(
+        const std::string& name,
+        const SourceLocation& location,
+        int func_index,
+        int locals_count,
+        int reg_count,
+        Loader loader
+    ) : _name(name),
+        _func_index(func_index),
+        _location(location),
+        _local_count(locals_count),
+        _loader(loader),
         _reg_count(reg_count),
         _max_regs_used(0) {}
 
@@ -77,7 +113,7 @@ namespace kore {
     }
 
     int CompiledObject::code_size() const {
-        return _instructions.size();
+        return _borrowed_instructions ? _borrowed_code_size : _instructions.size();
     }
 
     bool CompiledObject::is_main_object() const {
@@ -89,18 +125,108 @@ namespace kore {
     }
 
     const bytecode_type& CompiledObject::operator[](int index) const {
-        return _instructions[index];
+        return instructions()[index];
     }
 
     CompiledObject::instruction_iterator CompiledObject::begin() const {
-        return _instructions.begin();
+        return instructions();
     }
 
     CompiledObject::instruction_iterator CompiledObject::end() const {
-        return _instructions.end();
+        return instructions() + code_size();
     }
 
     const bytecode_type* CompiledObject::instructions() const {
-        return _instructions.data();
+        return _borrowed_instructions ? _borrowed_instructions : _instructions.data();
+    }
+
+    void CompiledObject::set_code(
+        const std::vector<bytecode_type>& instructions,
+        const LineTable& line_table
+    ) {
+        _instructions = instructions;
+        _borrowed_instructions = nullptr;
+        _borrowed_code_size = 0;
+        _line_table = line_table;
+    }
+
+    void CompiledObject::set_code(
+        const bytecode_type* instructions,
+        std::size_t code_size,
+        const LineTable& line_table
+    ) {
+        _instructions.clear();
+        _borrowed_instructions = instructions;
+        _borrowed_code_size = code_size;
+        _line_table = line_table;
+    }
+
+    void CompiledObject::load() {
+        if (_loader) {
+            // Release the loader and whatever it holds on to once it has
+            // done its job
+            auto loader = std::move(_loader);
+            _loader = nullptr;
+
+            loader(*this);
+        }
+    }
+
+    void CompiledObject::set_materialized() {
+        _materialized = true;
+    }
+
+    bool CompiledObject::is_materialized() const {
+        return _materialized;
+    }
+
+    void CompiledObject::decode(const ConstantTable& constants) {
+        _decoded = vm::decode_instructions(instructions(), code_size(), constants);
+
+        auto call_count = std::count_if(
+            _decoded.cbegin(),
+            _decoded.cend(),
+            [](const vm::DecodedInstruction& instruction) {
+                return instruction.opcode == Bytecode::Call;
+            }
+        );
+
+        // The caches must not be reallocated once instructions point to them
+        _inline_caches.assign(call_count, vm::InlineCache{});
+        auto cache = _inline_caches.data();
+
+        for (auto& instruction : _decoded) {
+            if (instruction.opcode == Bytecode::Call) {
+                instruction.cache = cache++;
+            }
+        }
+    }
+
+    const vm::DecodedInstruction* CompiledObject::decoded_instructions() const {
+        return _decoded.data();
+    }
+
+    int CompiledObject::decoded_size() const {
+        return _decoded.size();
+    }
+
+    SourceLocation CompiledObject::source_location(std::size_t pc) const {
+        return _line_table.lookup(pc);
+    }
+
+    const LineTable& CompiledObject::line_table() const {
+        return _line_table;
+    }
+
+    void CompiledObject::set_stack_map(const StackMap& stack_map) {
+        _stack_map = stack_map;
+    }
+
+    const StackMap& CompiledObject::stack_map() const {
+        return _stack_map;
+    }
+
+    vm::TierState& CompiledObject::tier_state() const {
+        return _tier_state;
     }
 }
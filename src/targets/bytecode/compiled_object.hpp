@@ -1,6 +1,7 @@
 #ifndef KORE_COMPILED_CODE_HPP
 #define KORE_COMPILED_CODE_HPP
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -8,6 +9,11 @@
 #include "ast/statements/function.hpp"
 #include "targets/bytecode/register.hpp"
 #include "targets/bytecode/codegen/bytecode.hpp"
+#include "targets/bytecode/line_table.hpp"
+#include "targets/bytecode/stack_map.hpp"
+#include "targets/bytecode/vm/decoded_instruction.hpp"
+#include "targets/bytecode/vm/inline_cache.hpp"
+#include "targets/bytecode/vm/tier_state.hpp"
 #include "pointer_types.hpp"
 
 namespace kore {
@@ -21,7 +27,11 @@ namespace kore {
             friend class BytecodeArrayWriter;
             friend class BytecodeFormatWriter;
 
-            using instruction_iterator = std::vector<bytecode_type>::const_iterator;
+            using instruction_iterator = const bytecode_type*;
+
+            /// Sets the instructions and line table of a function that was
+            /// created without them
+            using Loader = std::function<void(CompiledObject&)>;
 
         public:
             CompiledObject();
@@ -33,7 +43,32 @@ namespace kore {
                 int func_index,
                 int locals_count,
                 int reg_count,
-                const std::vector<bytecode_type>& instructions
+                const std::vector<bytecode_type>& instructions,
+                const LineTable& line_table = LineTable()
+            );
+
+            /// Create a compiled object whose instructions are not copied but
+            /// point into memory that must outlive it, such as a mapped file
+            CompiledObject(
+                const std::string& name,
+                const SourceLocation& location,
+                int func_index,
+                int locals_count,
+                int reg_count,
+                const bytecode_type* instructions,
+                std::size_t code_size,
+                const LineTable& line_table
+            );
+
+            /// Create a compiled object whose instructions and line table
+            /// are only set by the loader once it is materialized
+            CompiledObject(
+                const std::string& name,
+                const SourceLocation& location,
+                int func_index,
+                int locals_count,
+                int reg_count,
+                Loader loader
             );
             virtual ~CompiledObject();
 
@@ -56,6 +91,44 @@ namespace kore {
             instruction_iterator end() const;
             const bytecode_type* instructions() const;
 
+            void set_code(
+                const std::vector<bytecode_type>& instructions,
+                const LineTable& line_table
+            );
+            void set_code(
+                const bytecode_type* instructions,
+                std::size_t code_size,
+                const LineTable& line_table
+            );
+
+            /// Run the loader of the function if it has not been run yet
+            void load();
+
+            /// Mark the function as loaded, decoded and verified. Done by
+            /// Module::materialize
+            void set_materialized();
+            bool is_materialized() const;
+
+            /// Decode the instructions for execution by the vm and give
+            /// each call instruction an inline cache
+            void decode(const ConstantTable& constants);
+            const vm::DecodedInstruction* decoded_instructions() const;
+            int decoded_size() const;
+
+            /// Get the source location of the instruction at pc
+            SourceLocation source_location(std::size_t pc) const;
+            const LineTable& line_table() const;
+
+            /// Set the registers the garbage collector scans at each
+            /// safepoint. Functions without a stack map are scanned
+            /// conservatively
+            void set_stack_map(const StackMap& stack_map);
+            const StackMap& stack_map() const;
+
+            /// Hotness counters and current tier used by the vm to decide
+            /// when to re-optimise the function
+            vm::TierState& tier_state() const;
+
         private:
             std::string _name;
             int _func_index = -1;
@@ -63,6 +136,18 @@ namespace kore {
             int _local_count = 0;
             std::vector<bytecode_type> _instructions;
 
+            // Instructions borrowed from elsewhere instead of _instructions
+            const bytecode_type* _borrowed_instructions = nullptr;
+            std::size_t _borrowed_code_size = 0;
+            std::vector<vm::DecodedInstruction> _decoded;
+            std::vector<vm::InlineCache> _inline_caches;
+            LineTable _line_table;
+            StackMap _stack_map;
+
+            // Set until the function has been loaded
+            Loader _loader;
+            bool _materialized = false;
+
             // TODO: Add a pointer to the containing module here
 
             // For now, we just use a very simple register allocator with
@@ -70,6 +155,10 @@ namespace kore {
             int _reg_count = 0;
 
             int _max_regs_used = 0;
+
+            // Execution state maintained by the vm which does not change
+            // the compiled code itself
+            mutable vm::TierState _tier_state;
     };
 }
 
@@ -40,6 +40,10 @@ namespace kore {
         return _constants[idx];
     }
 
+    const vm::Value* ConstantTable::get_pointer(ConstantTable::index_type idx) const {
+        return &_constants[idx];
+    }
+
     size_t ConstantTable::size() const {
         return _constants.size();
     }
@@ -23,6 +23,7 @@ namespace kore {
             index_type add(f64 value);
             index_type add(vm::Value constant);
             vm::Value get(index_type idx) const;
+            const vm::Value* get_pointer(index_type idx) const;
             size_t size() const;
             void clear();
 
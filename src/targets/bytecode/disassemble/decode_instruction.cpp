@@ -10,24 +10,6 @@
 #include "utils/unused_parameter.hpp"
 
 namespace koredis {
-    // TODO: Check byte_offset range
-    std::vector<kore::Reg> decode_registers(int& pos, int& byte_offset, int count, const kore::CompiledObject& obj) {
-        int i = 0;
-        std::vector<kore::Reg> registers;
-        kore::bytecode_type ins = obj[pos];
-
-        while (i++ < count) {
-            registers.push_back((ins >> (24 - 8 * byte_offset++)) & 0xff);
-
-            if (byte_offset == 4) {
-                ins = obj[++pos];
-                byte_offset = 0;
-            }
-        }
-
-        return registers;
-    }
-
     Instruction decode_instruction(
         int& pos,
         int& byte_pos,
@@ -50,12 +32,34 @@ namespace koredis {
                 break;
             }
 
+            case kore::Bytecode::RefInc:
+            case kore::Bytecode::RefDec:
+            case kore::Bytecode::Destroy: {
+                decoded_instruction = Instruction{
+                    pos++,
+                    byte_pos,
+                    {
+                        opcode,
+                        kore::kir::OneRegister{
+                            static_cast<kore::Reg>(GET_REG1(instruction))
+                        }
+                    }
+                };
+                break;
+            }
+
             case kore::Bytecode::LoadBool:
             case kore::Bytecode::Cload:
             case kore::Bytecode::LoadFunction:
             case kore::Bytecode::Gload:
             case kore::Bytecode::JumpIf:
-            case kore::Bytecode::JumpIfNot: {
+            case kore::Bytecode::JumpIfNot:
+            case kore::Bytecode::ArrayAlloc:
+            case kore::Bytecode::ArrayAllocBool:
+            case kore::Bytecode::ArrayAllocI32:
+            case kore::Bytecode::ArrayAllocI64:
+            case kore::Bytecode::ArrayAllocF32:
+            case kore::Bytecode::ArrayAllocF64: {
                 decoded_instruction = Instruction{
                     pos++,
                     byte_pos,
@@ -71,8 +75,7 @@ namespace koredis {
             }
 
             case kore::Bytecode::Move:
-            case kore::Bytecode::Gstore:
-            case kore::Bytecode::ArrayAlloc: {
+            case kore::Bytecode::Gstore: {
                 decoded_instruction = Instruction{
                     pos++,
                     byte_pos,
@@ -132,7 +135,17 @@ namespace koredis {
             case kore::Bytecode::NeqF32:
             case kore::Bytecode::NeqF64:
             case kore::Bytecode::ArrayGet:
-            case kore::Bytecode::ArraySet: {
+            case kore::Bytecode::ArraySet:
+            case kore::Bytecode::ArrayGetBool:
+            case kore::Bytecode::ArrayGetI32:
+            case kore::Bytecode::ArrayGetI64:
+            case kore::Bytecode::ArrayGetF32:
+            case kore::Bytecode::ArrayGetF64:
+            case kore::Bytecode::ArraySetBool:
+            case kore::Bytecode::ArraySetI32:
+            case kore::Bytecode::ArraySetI64:
+            case kore::Bytecode::ArraySetF32:
+            case kore::Bytecode::ArraySetF64: {
                 decoded_instruction = Instruction{
                     pos++,
                     byte_pos,
@@ -162,44 +175,89 @@ namespace koredis {
                 break;
             }
 
-            case kore::Bytecode::Call: {
-                int func_reg = GET_REG1(instruction);
-                int arg_count = GET_REG2(instruction);
-                int return_count = GET_REG3(instruction);
+            case kore::Bytecode::AddI32K:
+            case kore::Bytecode::SubI32K: {
+                decoded_instruction = Instruction{
+                    pos++,
+                    byte_pos,
+                    {
+                        opcode,
+                        kore::kir::TwoRegistersAndValue{
+                            static_cast<kore::Reg>(GET_REG1(instruction)),
+                            static_cast<kore::Reg>(GET_REG2(instruction)),
+                            static_cast<std::int8_t>(GET_REG3(instruction))
+                        }
+                    }
+                };
+                break;
+            }
+
+            case kore::Bytecode::JumpIfLtI32:
+            case kore::Bytecode::JumpIfGtI32:
+            case kore::Bytecode::JumpIfLeI32:
+            case kore::Bytecode::JumpIfGeI32:
+            case kore::Bytecode::JumpIfEqI32:
+            case kore::Bytecode::JumpIfNeqI32: {
                 int start_pos = pos++;
-                int byte_offset = 0;
 
-                auto arg_regs = decode_registers(pos, byte_offset, arg_count, obj);
-                auto ret_regs = decode_registers(pos, byte_offset, return_count, obj);
+                // The jump offset is in the following word
+                if (pos >= obj.code_size()) {
+                    throw kore::ModuleLoadError("Failed to decode truncated instruction", byte_pos);
+                }
 
                 decoded_instruction = Instruction{
                     start_pos,
                     byte_pos,
-                    { opcode, kore::kir::CallV{ func_reg, arg_regs, ret_regs } }
+                    {
+                        opcode,
+                        kore::kir::TwoRegistersAndValue{
+                            static_cast<kore::Reg>(GET_REG1(instruction)),
+                            static_cast<kore::Reg>(GET_REG2(instruction)),
+                            static_cast<std::int16_t>(GET_OFFSET(obj[pos++]))
+                        }
+                    }
                 };
 
-                // Advance 4 positions for the instruction size + any additional
-                // argument and return registers
-                byte_pos += 4 + byte_offset;
+                byte_pos += 8;
                 byte_pos_advanced = true;
                 break;
             }
 
+            case kore::Bytecode::Call:
+            case kore::Bytecode::TailCall: {
+                int func_reg = GET_REG1(instruction);
+                int base = GET_REG2(instruction);
+                int arg_count = GET_REG3(instruction);
+                std::vector<kore::Reg> arg_regs;
+
+                // Arguments are in consecutive registers starting at the
+                // base register. The number of return values is not encoded
+                for (int idx = 0; idx < arg_count; ++idx) {
+                    arg_regs.push_back(base + idx);
+                }
+
+                decoded_instruction = Instruction{
+                    pos++,
+                    byte_pos,
+                    { opcode, kore::kir::CallV{ func_reg, base, arg_regs, {} } }
+                };
+                break;
+            }
+
             case kore::Bytecode::Ret: {
-                int regs = GET_REG1(instruction);
-                int byte_offset = 2;
-                auto ret_regs = decode_registers(pos, byte_offset, regs, obj);
+                int first_reg = GET_REG1(instruction);
+                int ret_count = GET_REG2(instruction);
+                std::vector<kore::Reg> ret_regs;
+
+                for (int idx = 0; idx < ret_count; ++idx) {
+                    ret_regs.push_back(first_reg + idx);
+                }
 
                 decoded_instruction = Instruction{
                     pos++,
                     byte_pos,
                     { opcode, kore::kir::ReturnV{ ret_regs } }
                 };
-
-                // Advance at least the instruction size if there were less than
-                // 3 regsiters otherwise account for the additional return registers
-                byte_pos += std::max(byte_offset, 4);
-                byte_pos_advanced = true;
                 break;
             }
 
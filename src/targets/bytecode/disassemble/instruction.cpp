@@ -1,4 +1,5 @@
 #include "instruction.hpp"
+#include "targets/bytecode/compiled_object.hpp"
 #include "targets/bytecode/module_load_error.hpp"
 #include "targets/bytecode/register.hpp"
 #include "targets/bytecode/vm/builtins/builtins.hpp"
@@ -65,8 +66,11 @@ namespace koredis {
         // Special-case output for more complex opcodes
         auto instruction_type = instruction.value.type;
 
-        if (std::get_if<kore::kir::OneRegister>(&instruction_type)) {
-            // TODO:
+        if (auto ins_type = std::get_if<kore::kir::OneRegister>(&instruction_type)) {
+            // Noop has no register
+            if (ins_type->reg != kore::INVALID_REGISTER) {
+                os << " " << reg(ins_type->reg);
+            }
         } else if (auto ins_type = std::get_if<kore::kir::TwoRegisters>(&instruction_type)) {
             if (instruction.value.opcode == kore::Bytecode::Gstore) {
                 os << " " << constant(ins_type->reg1) << " " << reg(ins_type->reg2);
@@ -86,6 +90,8 @@ namespace koredis {
                 auto target_pos = instruction.byte_pos + value;
 
                 os << " " << ins_type->value << " [target: " << target_pos << "]";
+            } else if (kore::is_array_alloc_opcode(opcode)) {
+                os << " " << value;
             } else if (opcode == kore::Bytecode::LoadBool) {
                 os << " " << (value == 1 ? "true" : "false");
             } else if (opcode == kore::LoadFunction) {
@@ -122,14 +128,23 @@ namespace koredis {
             auto target_pos = instruction.byte_pos + value;
 
             os << " " << value << " [target: " << target_pos << "]";
+        } else if (auto ins_type = std::get_if<kore::kir::TwoRegistersAndValue>(&instruction_type)) {
+            auto value = ins_type->value;
+            os << " " << reg(ins_type->reg1) << " " << reg(ins_type->reg2);
+
+            if (kore::is_compare_and_branch_opcode(instruction.value.opcode)) {
+                auto target_pos = instruction.byte_pos + value;
+
+                os << " " << value << " [target: " << target_pos << "]";
+            } else {
+                os << " " << value;
+            }
         } else if (auto ins_type = std::get_if<kore::kir::CallV>(&instruction_type)) {
             os << " " << reg(ins_type->func_index)
+               << " " << reg(ins_type->base)
                << " " << regs(ins_type->arg_registers)
-               << " " << regs(ins_type->ret_registers)
                << " [args: "
-               << ins_type->arg_registers.size()
-               << ", returns: "
-               << ins_type->ret_registers.size() << "]";
+               << ins_type->arg_registers.size() << "]";
         } else if (auto ins_type = std::get_if<kore::kir::ReturnV>(&instruction_type)) {
             os << " " << regs(ins_type->registers);
         }
@@ -137,6 +152,133 @@ namespace koredis {
         return os;
     }
 
+    std::ostream& format_decoded_instruction(
+        std::ostream& os,
+        std::size_t pos,
+        const kore::vm::DecodedInstruction& instruction
+    ) {
+        auto opcode = instruction.opcode;
+        os << pos << ": " << kore::bytecode_to_string(opcode);
+
+        switch (opcode) {
+            case kore::Bytecode::Noop:
+                break;
+
+            case kore::Bytecode::Cload: {
+                os << " " << reg(instruction.reg1);
+
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                os << " [" << instruction.raw_constant << "]";
+#else
+                os << " [" << *instruction.constant << "]";
+#endif
+                break;
+            }
+
+            case kore::Bytecode::LoadBool:
+                os << " " << reg(instruction.reg1)
+                   << " " << (instruction.value == 1 ? "true" : "false");
+                break;
+
+            case kore::Bytecode::LoadBuiltin:
+            case kore::Bytecode::LoadFunction:
+            case kore::Bytecode::ArrayAlloc:
+            case kore::Bytecode::ArrayAllocBool:
+            case kore::Bytecode::ArrayAllocI32:
+            case kore::Bytecode::ArrayAllocI64:
+            case kore::Bytecode::ArrayAllocF32:
+            case kore::Bytecode::ArrayAllocF64:
+                os << " " << reg(instruction.reg1) << " " << instruction.value;
+                break;
+
+            case kore::Bytecode::Gload:
+                os << " " << reg(instruction.reg1) << " " << constant(instruction.reg2);
+                break;
+
+            case kore::Bytecode::Gstore:
+                os << " " << constant(instruction.reg1) << " " << reg(instruction.reg2);
+                break;
+
+            case kore::Bytecode::Move:
+                os << " " << reg(instruction.reg1) << " " << reg(instruction.reg2);
+                break;
+
+            case kore::Bytecode::Jump:
+                os << " [target: " << instruction.target << "]";
+                break;
+
+            case kore::Bytecode::JumpIf:
+            case kore::Bytecode::JumpIfNot:
+                os << " " << reg(instruction.reg1)
+                   << " [target: " << instruction.target << "]";
+                break;
+
+            case kore::Bytecode::AddI32K:
+            case kore::Bytecode::SubI32K:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " " << instruction.value;
+                break;
+
+            case kore::Bytecode::JumpIfLtI32:
+            case kore::Bytecode::JumpIfGtI32:
+            case kore::Bytecode::JumpIfLeI32:
+            case kore::Bytecode::JumpIfGeI32:
+            case kore::Bytecode::JumpIfEqI32:
+            case kore::Bytecode::JumpIfNeqI32:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " [target: " << instruction.target << "]";
+                break;
+
+            case kore::Bytecode::Call:
+            case kore::Bytecode::TailCall:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " [args: " << instruction.reg3 << "]";
+                break;
+
+            case kore::Bytecode::CallGeneric:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " [args: " << instruction.reg3
+                   << ", misses: " << instruction.cache->misses << "]";
+                break;
+
+            case kore::Bytecode::CallDirect:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " [args: " << instruction.reg3
+                   << ", cached: " << instruction.cache->func->name()
+                   << ", hits: " << instruction.cache->hits << "]";
+                break;
+
+            case kore::Bytecode::CallBuiltin:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " [args: " << instruction.reg3
+                   << ", cached: " << instruction.cache->builtin->name << " (builtin)"
+                   << ", hits: " << instruction.cache->hits << "]";
+                break;
+
+            case kore::Bytecode::Ret: {
+                for (int idx = 0; idx < instruction.reg2; ++idx) {
+                    os << " " << reg(instruction.reg1 + idx);
+                }
+
+                break;
+            }
+
+            default:
+                os << " " << reg(instruction.reg1)
+                   << " " << reg(instruction.reg2)
+                   << " " << reg(instruction.reg3);
+                break;
+        }
+
+        return os;
+    }
+
     /* std::ostream& operator<<(std::ostream& os, const Instruction instruction) { */
     /*     os << instruction.byte_pos << ": " << bytecode_to_string(instruction.value.opcode); */
         
@@ -8,6 +8,7 @@
 #include "targets/bytecode/codegen/kir/instruction.hpp"
 #include "targets/bytecode/module.hpp"
 #include "targets/bytecode/register.hpp"
+#include "targets/bytecode/vm/decoded_instruction.hpp"
 
 namespace koredis {
     struct Instruction {
@@ -19,6 +20,15 @@ namespace koredis {
 
     std::ostream& format_registers(std::ostream& os, Instruction instruction, kore::Module& module);
 
+    /// Format an instruction decoded by the vm at its index in the decoded
+    /// code. Unlike compiled code, this may contain instructions that the
+    /// vm has quickened at run time
+    std::ostream& format_decoded_instruction(
+        std::ostream& os,
+        std::size_t pos,
+        const kore::vm::DecodedInstruction& instruction
+    );
+
     /* std::ostream& operator<<(std::ostream& os, const Instruction instruction); */
 }
 
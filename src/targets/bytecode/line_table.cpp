@@ -0,0 +1,95 @@
+#include <algorithm>
+
+#include "targets/bytecode/line_table.hpp"
+#include "utils/leb128.hpp"
+
+namespace kore {
+    bool is_same_location(const SourceLocation& location1, const SourceLocation& location2) {
+        return location1.lnum() == location2.lnum()
+            && location1.start() == location2.start()
+            && location1.end() == location2.end();
+    }
+
+    LineTable::LineTable() {}
+
+    LineTable::LineTable(const std::vector<std::uint8_t>& data) : _data(data) {}
+
+    void LineTable::add(std::size_t pc, const SourceLocation& location) {
+        if (is_same_location(location, _last_location)) {
+            return;
+        }
+
+        write_uleb128(pc - _last_pc, _data);
+        write_sleb128(location.lnum() - _last_location.lnum(), _data);
+        write_sleb128(location.start() - _last_location.start(), _data);
+        write_sleb128(location.end() - _last_location.end(), _data);
+
+        _last_pc = pc;
+        _last_location = location;
+        _decoded = false;
+    }
+
+    SourceLocation LineTable::lookup(std::size_t pc) const {
+        if (!_decoded) {
+            decode();
+        }
+
+        // Find the last entry at or before the program counter
+        auto it = std::upper_bound(
+            _entries.cbegin(),
+            _entries.cend(),
+            pc,
+            [](std::size_t pc, const Entry& entry) {
+                return pc < entry.pc;
+            }
+        );
+
+        if (it == _entries.cbegin()) {
+            return SourceLocation::unknown;
+        }
+
+        return std::prev(it)->location;
+    }
+
+    const std::vector<std::uint8_t>& LineTable::data() const {
+        return _data;
+    }
+
+    bool LineTable::empty() const {
+        return _data.empty();
+    }
+
+    void LineTable::decode() const {
+        std::size_t pos = 0;
+        std::size_t pc = 0;
+        SourceLocation location;
+
+        _entries.clear();
+
+        // The table is decoded on demand, typically when reporting an error,
+        // so a truncated table only loses the locations after it instead of
+        // failing
+        while (pos < _data.size()) {
+            std::uint64_t pc_delta;
+            std::int64_t lnum_delta, start_delta, end_delta;
+
+            if (!read_uleb128(_data, pos, pc_delta)
+                || !read_sleb128(_data, pos, lnum_delta)
+                || !read_sleb128(_data, pos, start_delta)
+                || !read_sleb128(_data, pos, end_delta)) {
+                break;
+            }
+
+            pc += pc_delta;
+            location = SourceLocation(
+                location.lnum() + lnum_delta,
+                location.start() + start_delta,
+                location.end() + end_delta
+            );
+
+            _entries.push_back(Entry{ pc, location });
+        }
+
+        _decoded = true;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef KORE_LINE_TABLE_HPP
+#define KORE_LINE_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ast/source_location.hpp"
+
+namespace kore {
+    /// Maps the instructions of a function to their source locations
+    ///
+    /// Entries are only added where the source location changes and are
+    /// stored as a compact sequence of variable-length deltas to the
+    /// previous entry, i.e. an unsigned program counter delta followed by
+    /// signed deltas of the line, start column and end column. The encoded
+    /// table is what is written to and read from compiled files and is only
+    /// decoded the first time a location is looked up
+    class LineTable final {
+        public:
+            LineTable();
+            LineTable(const std::vector<std::uint8_t>& data);
+
+            /// Set the source location of the instructions starting at pc.
+            /// Program counters must be added in ascending order
+            void add(std::size_t pc, const SourceLocation& location);
+
+            /// Get the source location of the instruction at pc or an
+            /// unknown location if there is none
+            SourceLocation lookup(std::size_t pc) const;
+
+            const std::vector<std::uint8_t>& data() const;
+            bool empty() const;
+
+        private:
+            struct Entry {
+                std::size_t pc;
+                SourceLocation location;
+            };
+
+            std::vector<std::uint8_t> _data;
+
+            // The last entry added, which deltas are relative to
+            std::size_t _last_pc = 0;
+            SourceLocation _last_location;
+
+            mutable std::vector<Entry> _entries;
+            mutable bool _decoded = false;
+
+        private:
+            void decode() const;
+    };
+}
+
+#endif // KORE_LINE_TABLE_HPP
@@ -1,6 +1,7 @@
 #include "module.hpp"
 #include "targets/bytecode/constant_table_tag.hpp"
 #include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "targets/bytecode/vm/verifier.hpp"
 
 namespace kore {
     Module::Module() : Module(0, "") {}
@@ -87,14 +88,16 @@ namespace kore {
         ));
 
         std::string name = func.name();
-        _function_map[name] = _objects.back().get();
+        _function_map[_objects.back()->name()] = _objects.back().get();
+        _function_index_map[_objects.back()->func_index()] = _objects.back().get();
 
         return _function_map[name];
     }
 
     CompiledObject* Module::new_function_from_name(const std::string& name) {
         _objects.emplace_back(std::make_unique<CompiledObject>(name, get_free_function_index()));
-        _function_map[name] = _objects.back().get();
+        _function_map[_objects.back()->name()] = _objects.back().get();
+        _function_index_map[_objects.back()->func_index()] = _objects.back().get();
 
         return _function_map[name];
     }
@@ -117,6 +120,12 @@ namespace kore {
         return _objects[index].get();
     }
 
+    const CompiledObject* Module::find_function(int func_index) const {
+        auto it = _function_index_map.find(func_index);
+
+        return it != _function_index_map.end() ? it->second : nullptr;
+    }
+
     void Module::add_function(
         const std::string& name,
         int lnum,
@@ -125,20 +134,100 @@ namespace kore {
         int func_index,
         int locals_count,
         int reg_count,
-        const std::vector<bytecode_type>& instructions
+        const std::vector<bytecode_type>& instructions,
+        const LineTable& line_table
     ) {
-        auto location = SourceLocation(lnum, start, end);
+        add_object(std::make_unique<CompiledObject>(
+            name,
+            SourceLocation(lnum, start, end),
+            func_index,
+            locals_count,
+            reg_count,
+            instructions,
+            line_table
+        ));
+    }
 
-        _objects.emplace_back(std::make_unique<CompiledObject>(
+    void Module::add_function(
+        const std::string& name,
+        int lnum,
+        int start,
+        int end,
+        int func_index,
+        int locals_count,
+        int reg_count,
+        const bytecode_type* instructions,
+        std::size_t code_size,
+        const LineTable& line_table
+    ) {
+        add_object(std::make_unique<CompiledObject>(
+            name,
+            SourceLocation(lnum, start, end),
+            func_index,
+            locals_count,
+            reg_count,
+            instructions,
+            code_size,
+            line_table
+        ));
+    }
+
+    void Module::add_function_stub(
+        const std::string& name,
+        int lnum,
+        int start,
+        int end,
+        int func_index,
+        int locals_count,
+        int reg_count,
+        CompiledObject::Loader loader
+    ) {
+        add_object(std::make_unique<CompiledObject>(
             name,
-            location,
+            SourceLocation(lnum, start, end),
             func_index,
             locals_count,
             reg_count,
-            instructions
+            loader
         ));
+    }
+
+    void Module::materialize(CompiledObject* func) {
+        if (func->is_materialized()) {
+            return;
+        }
+
+        func->load();
+        func->decode(_constants);
+
+        // Verify once here so the vm's dispatch loop does not need to
+        // check operands of the instructions it runs
+        vm::Verifier(*this).verify(*func);
+
+        func->set_materialized();
+        ++_materialized_count;
+    }
+
+    void Module::materialize_all() {
+        for (auto& object : _objects) {
+            materialize(object.get());
+        }
+    }
+
+    int Module::materialized_count() const {
+        return _materialized_count;
+    }
+
+    void Module::set_storage(std::shared_ptr<const void> storage) {
+        _storage = storage;
+    }
 
-        _function_map[name] = _objects.back().get();
+    void Module::add_object(CompiledObject::pointer object) {
+        // Functions are decoded when they are materialized by the vm so
+        // functions that are never used cost little more than their name
+        _objects.emplace_back(std::move(object));
+        _function_map[_objects.back()->name()] = _objects.back().get();
+        _function_index_map[_objects.back()->func_index()] = _objects.back().get();
     }
 
     int Module::get_free_function_index() {
@@ -3,6 +3,7 @@
 
 #include <array>
 #include <filesystem>
+#include <memory>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -66,6 +67,24 @@ namespace kore {
             /* const CompiledObject* main_object() const; */
             CompiledObject* get_function(const std::string& name);
             CompiledObject* get_function_by_index(size_t index);
+
+            /// Find a function by its function index, as used by
+            /// LoadFunction instructions
+            const CompiledObject* find_function(int func_index) const;
+            void add_function(
+                const std::string& name,
+                int lnum,
+                int start,
+                int end,
+                int func_index,
+                int locals_count,
+                int reg_count,
+                const std::vector<bytecode_type>& instructions,
+                const LineTable& line_table = LineTable()
+            );
+
+            /// Add a function whose instructions are not copied but point
+            /// into the module's storage
             void add_function(
                 const std::string& name,
                 int lnum,
@@ -74,9 +93,40 @@ namespace kore {
                 int func_index,
                 int locals_count,
                 int reg_count,
-                const std::vector<bytecode_type>& instructions
+                const bytecode_type* instructions,
+                std::size_t code_size,
+                const LineTable& line_table
             );
 
+            /// Add a function that is only loaded and decoded once it is
+            /// materialized, i.e. when it is first used
+            void add_function_stub(
+                const std::string& name,
+                int lnum,
+                int start,
+                int end,
+                int func_index,
+                int locals_count,
+                int reg_count,
+                CompiledObject::Loader loader
+            );
+
+            /// Load, decode and verify a function for execution unless that
+            /// has already been done. Throws a ModuleLoadError if the
+            /// function cannot be decoded or verified
+            void materialize(CompiledObject* func);
+
+            /// Materialize all functions, e.g. before writing or
+            /// disassembling the module
+            void materialize_all();
+
+            /// Number of functions materialized so far
+            int materialized_count() const;
+
+            /// Keep memory that functions point into, such as a mapped file,
+            /// alive for as long as the module
+            void set_storage(std::shared_ptr<const void> storage);
+
         private:
             // The version of the compiler used to compile this module
             Version _compiler_version;
@@ -91,9 +141,18 @@ namespace kore {
             // Map a function name to its compiled code
             function_map _function_map;
 
+            // Map a function index to its compiled code
+            std::unordered_map<int, CompiledObject*> _function_index_map;
+
             ConstantTable _constants;
 
+            // Memory that functions borrow their instructions from
+            std::shared_ptr<const void> _storage;
+
             int _global_indices;
+            int _materialized_count = 0;
+
+            void add_object(CompiledObject::pointer object);
 
             // TODO: Probably move this into CompiledObject
             static int get_free_function_index();
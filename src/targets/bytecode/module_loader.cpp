@@ -1,10 +1,13 @@
+#include <cstdint>
+#include <iterator>
 #include <stdexcept>
-#include <fstream>
 
+#include "targets/bytecode/bytecode_container.hpp"
 #include "targets/bytecode/module_load_error.hpp"
 #include "targets/bytecode/module_loader.hpp"
 #include "targets/bytecode/vm/value_type.hpp"
 #include "utils/endian.hpp"
+#include "utils/mapped_file.hpp"
 
 namespace kore {
     using BytecodeMagic = std::array<char, 4>;
@@ -12,67 +15,103 @@ namespace kore {
 
     BytecodeMagic bytecode_magic {'k', 'o', 'r', 'e'};
 
-    // TODO: Create a byte_io.hpp file for safe reading of bytes
-    void read_bytes(
-        std::istream& is,
-        std::size_t count,
-        std::vector<std::uint32_t>& buffer
-    ) {
-        int bytes_to_read = count;
-        std::array<char, 4> data;
-
-        while (bytes_to_read > 0) {
-            data.fill(0);
-            is.read(data.data(), bytes_to_read >= 4 ? 4 : bytes_to_read);
-
-            buffer.push_back(
-                (data[0] & 0xff) << 24 |
-                (data[1] & 0xff) << 16 |
-                (data[2] & 0xff) << 8  |
-                (data[3] & 0xff)
-            );
+    // First bytecode version where functions are followed by a line table
+    BytecodeVersion line_table_version {1, 1, 0};
 
-            bytes_to_read -= 4;
-        }
-    }
+    /// Reads a compiled module from memory and checks that every read stays
+    /// within its bounds
+    class BytecodeReader final {
+        public:
+            BytecodeReader(const std::uint8_t* data, std::size_t size)
+                : _data(data),
+                  _size(size) {}
+
+            std::size_t pos() const noexcept {
+                return _pos;
+            }
+
+            std::size_t remaining() const noexcept {
+                return _size - _pos;
+            }
+
+            const std::uint8_t* current() const noexcept {
+                return _data + _pos;
+            }
+
+            /// Get a pointer to the next count bytes and move past them
+            const std::uint8_t* read_bytes(std::size_t count) {
+                if (count > remaining()) {
+                    throw ModuleLoadError(
+                        "Unexpected end of file",
+                        static_cast<std::streamoff>(_pos)
+                    );
+                }
 
-    void read_magic(std::istream& is) {
+                auto bytes = _data + _pos;
+                _pos += count;
+
+                return bytes;
+            }
+
+            std::uint8_t read8() {
+                return *read_bytes(1);
+            }
+
+            std::uint32_t read_be32() {
+                auto bytes = read_bytes(4);
+
+                return static_cast<std::uint32_t>(bytes[0]) << 24
+                    | static_cast<std::uint32_t>(bytes[1]) << 16
+                    | static_cast<std::uint32_t>(bytes[2]) << 8
+                    | static_cast<std::uint32_t>(bytes[3]);
+            }
+
+        private:
+            const std::uint8_t* _data;
+            std::size_t _size;
+            std::size_t _pos = 0;
+    };
+
+    void read_magic(BytecodeReader& reader) {
         BytecodeMagic magic_header;
+        auto bytes = reader.read_bytes(magic_header.size());
 
-        is.read(magic_header.data(), 4);
+        std::copy(bytes, bytes + magic_header.size(), magic_header.begin());
 
         if (magic_header != bytecode_magic) {
-            throw ModuleLoadError("not a kore bytecode file", is.tellg());
+            throw ModuleLoadError(
+                "not a kore bytecode file",
+                static_cast<std::streamoff>(reader.pos())
+            );
         }
     }
 
-    BytecodeVersion read_version(std::istream& is) {
+    BytecodeVersion read_version(BytecodeReader& reader) {
         BytecodeVersion version;
+        auto bytes = reader.read_bytes(version.size());
 
-        is.read(version.data(), 3);
+        std::copy(bytes, bytes + version.size(), version.begin());
 
         return version;
     }
 
-    std::string read_string(std::istream& is) {
-        auto size = kore::read_be32(is);
-        std::vector<char> bytes(size);
-
-        is.read(bytes.data(), size);
+    std::string read_string(BytecodeReader& reader) {
+        auto size = reader.read_be32();
+        auto bytes = reader.read_bytes(size);
 
-        return std::string(bytes.cbegin(), bytes.cend());
-    } 
+        return std::string(bytes, bytes + size);
+    }
 
-    void load_constant_table(std::istream& is, kore::Module& module) {
-        auto constant_table_size = kore::read_be32(is);
+    void load_constant_table(BytecodeReader& reader, kore::Module& module) {
+        auto constant_table_size = reader.read_be32();
 
         for (decltype(constant_table_size) i = 0; i < constant_table_size; ++i) {
-            auto tag = static_cast<kore::vm::ValueTag>(kore::read8(is));
+            auto tag = static_cast<kore::vm::ValueTag>(reader.read8());
 
             // TODO: Fix signedness of values
             switch (tag) {
                 case kore::vm::ValueTag::I32: {
-                    module.add_constant(vm::Value::from_i32(kore::read_be32(is)));
+                    module.add_constant(vm::Value::from_i32(reader.read_be32()));
                     break;
                 }
 
@@ -82,66 +121,109 @@ namespace kore {
         }
     }
 
-    void load_instruction(
-        std::istream& is,
-        std::vector<kore::bytecode_type>& instructions
-    ) {
-        auto instruction = kore::read_be32(is);
-        auto opcode = GET_OPCODE(instruction);
-
-        if (!kore::is_variable_length_opcode(opcode)) {
-            instructions.push_back(instruction);
-        } else {
-            switch (opcode) {
-                case kore::Bytecode::Call: {
-                    instructions.push_back(instruction);
-                    int arg_count = GET_REG2(instruction);
-                    int ret_count = GET_REG3(instruction);
-                    auto total_count = arg_count + ret_count;
-
-                    // Read the argument and return registers
-                    if (total_count > 0) {
-                        read_bytes(is, total_count, instructions);
-                    }
-
-                    break;
-                }
+    /// Skip past the instructions of a function and get the number of words
+    /// they take up
+    std::size_t skip_instructions(BytecodeReader& reader, std::uint32_t code_size) {
+        auto start = reader.pos();
 
-                case kore::Bytecode::Ret: {
-                    int reg_count = GET_REG1(instruction);
-                    instructions.push_back(instruction);
+        for (decltype(code_size) i = 0; i < code_size; ++i) {
+            auto instruction = reader.read_be32();
+            auto opcode = GET_OPCODE(instruction);
 
-                    // Read the return registers accounting for the two
-                    // registers that are part of the first 32 bits of the
-                    // instruction
-                    if (reg_count > 2) {
-                        read_bytes(is, reg_count, instructions);
-                    }
+            if (!kore::is_variable_length_opcode(opcode)) {
+                continue;
+            }
 
+            switch (opcode) {
+                case kore::Bytecode::JumpIfLtI32:
+                case kore::Bytecode::JumpIfGtI32:
+                case kore::Bytecode::JumpIfLeI32:
+                case kore::Bytecode::JumpIfGeI32:
+                case kore::Bytecode::JumpIfEqI32:
+                case kore::Bytecode::JumpIfNeqI32: {
+                    // Skip the word containing the jump offset
+                    reader.read_bytes(sizeof(bytecode_type));
                     break;
                 }
 
                 default:
-                    throw ModuleLoadError("Unknown opcode", is.tellg(), opcode);
+                    throw ModuleLoadError(
+                        "Unknown opcode",
+                        static_cast<std::streamoff>(reader.pos()),
+                        opcode
+                    );
             }
         }
+
+        return (reader.pos() - start) / sizeof(bytecode_type);
+    }
+
+    /// Check if instructions stored in big-endian byte order can be
+    /// executed where they are without being copied
+    bool can_borrow_instructions(const std::uint8_t* bytes) {
+        auto address = reinterpret_cast<std::uintptr_t>(bytes);
+
+        return kore::is_big_endian() && address % alignof(bytecode_type) == 0;
     }
 
-    void load_function(std::istream& is, kore::Module& module) {
-        std::string name = read_string(is);
+    kore::LineTable load_line_table(BytecodeReader& reader) {
+        auto size = reader.read_be32();
+        auto bytes = reader.read_bytes(size);
 
-        auto lnum = kore::read_be32(is);
-        auto start = kore::read_be32(is);
-        auto end = kore::read_be32(is);
-        auto func_index = kore::read_be32(is);
-        /* auto locals_count = kore::read_be32(is); */
-        auto reg_count = kore::read_be32(is);
-        auto code_size = kore::read_be32(is);
+        // The table is kept encoded and only decoded when a location is
+        // first looked up, e.g. when reporting an error
+        return kore::LineTable(std::vector<std::uint8_t>(bytes, bytes + size));
+    }
 
+    void load_function(
+        BytecodeReader& reader,
+        kore::Module& module,
+        const BytecodeVersion& bytecode_version
+    ) {
+        std::string name = read_string(reader);
+
+        auto lnum = reader.read_be32();
+        auto start = reader.read_be32();
+        auto end = reader.read_be32();
+        auto func_index = reader.read_be32();
+        /* auto locals_count = reader.read_be32(); */
+        auto reg_count = reader.read_be32();
+        auto code_size = reader.read_be32();
+
+        auto code = reader.current();
+        auto word_count = skip_instructions(reader, code_size);
+
+        kore::LineTable line_table;
+
+        if (bytecode_version >= line_table_version) {
+            line_table = load_line_table(reader);
+        }
+
+        if (can_borrow_instructions(code)) {
+            module.add_function(
+                name,
+                lnum,
+                start,
+                end,
+                func_index,
+                0,
+                reg_count,
+                reinterpret_cast<const bytecode_type*>(code),
+                word_count,
+                line_table
+            );
+
+            return;
+        }
+
+        // Otherwise convert the instructions to host byte order
         std::vector<kore::bytecode_type> instructions;
+        BytecodeReader code_reader(code, word_count * sizeof(bytecode_type));
 
-        for (decltype(code_size) i = 0; i < code_size; ++i) {
-            load_instruction(is, instructions);
+        instructions.reserve(word_count);
+
+        for (std::size_t i = 0; i < word_count; ++i) {
+            instructions.push_back(code_reader.read_be32());
         }
 
         module.add_function(
@@ -152,74 +234,175 @@ namespace kore {
             func_index,
             0,
             reg_count,
-            instructions
+            instructions,
+            line_table
         );
     }
 
-    void load_functions(std::istream& is, kore::Module& module) {
-        std::uint32_t function_count = kore::read_be32(is);
+    void load_functions(
+        BytecodeReader& reader,
+        kore::Module& module,
+        const BytecodeVersion& bytecode_version
+    ) {
+        std::uint32_t function_count = reader.read_be32();
 
         for (std::uint32_t i = 0; i < function_count; ++i) {
-            load_function(is, module);
+            load_function(reader, module, bytecode_version);
         }
     }
 
-    kore::Module load_module(std::istream& is) {
-        auto module_index = kore::read_be32(is);
-        auto module_path = read_string(is);
+    kore::Module load_module(BytecodeReader& reader, const BytecodeVersion& bytecode_version) {
+        auto module_index = reader.read_be32();
+        auto module_path = read_string(reader);
         kore::Module module{ module_index, module_path };
 
-        load_constant_table(is, module);
-        load_functions(is, module);
+        load_constant_table(reader, module);
+        load_functions(reader, module, bytecode_version);
 
         return module;
     }
 
-    kore::Module load_module_from_path(const fs::path& path) {
-        std::ifstream ifs(path);
+    /// Check if instructions stored in a container can be executed where
+    /// they are without being copied
+    bool can_borrow_instructions(const BytecodeContainer& container, const std::uint8_t* bytes) {
+        auto address = reinterpret_cast<std::uintptr_t>(bytes);
+
+        return container.is_host_byte_order() && address % alignof(bytecode_type) == 0;
+    }
+
+    /// Load a version 2 module. Functions are added as stubs that are
+    /// loaded from the container when they are materialized, so the
+    /// container must live as long as the module's storage
+    kore::Module load_container(std::shared_ptr<const BytecodeContainer> container) {
+        auto& header = container->header();
+        kore::Module module{ header.module_index, container->path() };
 
-        if (!ifs) {
-            throw std::runtime_error("failed to open file");
+        for (std::size_t idx = 0; idx < container->constant_count(); ++idx) {
+            auto constant = container->constant(idx);
+
+            switch (static_cast<kore::vm::ValueTag>(constant.tag)) {
+                case kore::vm::ValueTag::I32:
+                    module.add_constant(vm::Value::from_i32(constant.value));
+                    break;
+
+                default:
+                    throw ModuleLoadError("Unsupported constant tag", -1, constant.tag);
+            }
+        }
+
+        for (std::size_t idx = 0; idx < container->function_count(); ++idx) {
+            auto entry = container->function(idx);
+
+            // Only check the function now and leave reading its
+            // instructions and line table until it is first used
+            container->check_function(entry);
+
+            module.add_function_stub(
+                container->function_name(entry),
+                entry.lnum,
+                entry.start,
+                entry.end,
+                entry.func_index,
+                0,
+                entry.reg_count,
+                [container, entry](kore::CompiledObject& func) {
+                    auto code = container->function_code(entry);
+                    auto line_table = container->function_line_table(entry);
+
+                    if (can_borrow_instructions(*container, code)) {
+                        func.set_code(
+                            reinterpret_cast<const bytecode_type*>(code),
+                            entry.code_size,
+                            line_table
+                        );
+                    } else {
+                        func.set_code(container->copy_function_code(entry), line_table);
+                    }
+
+                    func.set_stack_map(container->function_stack_map(entry));
+                }
+            );
         }
 
-        return load_module_from_stream(ifs);
+        module.set_compiler_version(header.compiler_version);
+        module.set_bytecode_version(header.bytecode_version);
+        module.set_global_indices_count(header.globals_count);
+
+        return module;
     }
 
-    kore::Module load_module_from_stream(std::istream& is) {
-        if (!is) {
-            throw std::runtime_error("failed to read from stream");
+    /// Load a module from memory kept alive by storage. Functions point
+    /// directly into the memory when their instructions are already in host
+    /// byte order
+    kore::Module load_module_from_memory(
+        const std::uint8_t* data,
+        std::size_t size,
+        std::shared_ptr<const void> storage
+    ) {
+        if (BytecodeContainer::is_container(data, size)) {
+            auto module = load_container(std::make_shared<BytecodeContainer>(data, size));
+            module.set_storage(storage);
+
+            return module;
         }
 
+        BytecodeReader reader(data, size);
+
         // Read magic header
-        read_magic(is);
+        read_magic(reader);
 
         // Read compiler/bytecode versions
-        BytecodeVersion compiler_version = read_version(is);
-        BytecodeVersion bytecode_version = read_version(is);
+        BytecodeVersion compiler_version = read_version(reader);
+        BytecodeVersion bytecode_version = read_version(reader);
 
         // Read global indices count
-        auto global_indices_count = kore::read_be32(is);
+        auto global_indices_count = reader.read_be32();
 
         // Read main module index
-        kore::read_be32(is);
+        reader.read_be32();
 
         // Read main function index
-        kore::read_be32(is);
+        reader.read_be32();
 
-        auto module_count = kore::read_be32(is);
+        auto module_count = reader.read_be32();
 
         if (module_count == 0) {
-            throw ModuleLoadError("zero modules in file", is.tellg());
+            throw ModuleLoadError("zero modules in file", static_cast<std::streamoff>(reader.pos()));
         } else if (module_count > 1) {
-            throw ModuleLoadError("only one module is currently supported", is.tellg());
+            throw ModuleLoadError(
+                "only one module is currently supported",
+                static_cast<std::streamoff>(reader.pos())
+            );
         }
 
-        auto module = load_module(is);
+        auto module = load_module(reader, bytecode_version);
 
         module.set_compiler_version(compiler_version);
         module.set_bytecode_version(bytecode_version);
         module.set_global_indices_count(global_indices_count);
+        module.set_storage(storage);
 
         return module;
     }
+
+    kore::Module load_module_from_path(const fs::path& path) {
+        // Map the file instead of reading it through a stream so the loader
+        // does not have to copy it
+        auto file = std::make_shared<MappedFile>(path);
+
+        return load_module_from_memory(file->data(), file->size(), file);
+    }
+
+    kore::Module load_module_from_stream(std::istream& is) {
+        if (!is) {
+            throw std::runtime_error("failed to read from stream");
+        }
+
+        auto buffer = std::make_shared<std::vector<std::uint8_t>>(
+            std::istreambuf_iterator<char>(is),
+            std::istreambuf_iterator<char>()
+        );
+
+        return load_module_from_memory(buffer->data(), buffer->size(), buffer);
+    }
 }
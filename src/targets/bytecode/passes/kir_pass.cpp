@@ -1,5 +1,8 @@
 #include "targets/bytecode/codegen/kir/kir.hpp"
 #include "targets/bytecode/codegen/kir/kir_lowering_pass.hpp"
+#include "targets/bytecode/codegen/kir/ownership_analyser.hpp"
+#include "targets/bytecode/codegen/kir/peephole_optimiser.hpp"
+#include "targets/bytecode/codegen/kir/ref_count_optimiser.hpp"
 #include "targets/bytecode/passes/kir_pass.hpp"
 
 namespace kore {
@@ -23,5 +26,44 @@ namespace kore {
                 }
             };
         }
+
+        Pass get_ref_count_optimisation_pass() {
+            return Pass {
+                "reference count optimisation",
+                [](PassContext& context) {
+                    RefCountOptimiser optimiser;
+
+                    optimiser.optimise(context.kir);
+
+                    return PassResult{ true, {} };
+                }
+            };
+        }
+
+        Pass get_ownership_analysis_pass() {
+            return Pass {
+                "ownership analysis",
+                [](PassContext& context) {
+                    OwnershipAnalyser analyser;
+
+                    analyser.analyse(context.kir);
+
+                    return PassResult{ true, {} };
+                }
+            };
+        }
+
+        Pass get_peephole_optimisation_pass() {
+            return Pass {
+                "peephole optimisation",
+                [](PassContext& context) {
+                    PeepholeOptimiser optimiser;
+
+                    optimiser.optimise(context.kir);
+
+                    return PassResult{ true, {} };
+                }
+            };
+        }
     }
 }
@@ -6,6 +6,9 @@
 namespace kore {
     namespace kir {
         Pass get_kir_lowering_pass();
+        Pass get_ref_count_optimisation_pass();
+        Pass get_ownership_analysis_pass();
+        Pass get_peephole_optimisation_pass();
     }
 }
 
@@ -0,0 +1,104 @@
+#include <algorithm>
+
+#include "targets/bytecode/stack_map.hpp"
+#include "utils/leb128.hpp"
+
+namespace kore {
+    StackMap::StackMap() : _decoded(true) {}
+
+    StackMap::StackMap(const std::vector<std::uint8_t>& data) : _data(data) {}
+
+    void StackMap::add(std::size_t pc, const std::vector<Reg>& registers) {
+        if (!_decoded) {
+            decode();
+        }
+
+        write_uleb128(pc - _last_pc, _data);
+        write_uleb128(registers.size(), _data);
+
+        for (auto reg : registers) {
+            write_uleb128(reg, _data);
+        }
+
+        _last_pc = pc;
+        _entries.push_back(Entry{ pc, registers });
+    }
+
+    const std::vector<Reg>* StackMap::lookup(std::size_t pc) const {
+        if (!_decoded) {
+            decode();
+        }
+
+        auto it = std::lower_bound(
+            _entries.cbegin(),
+            _entries.cend(),
+            pc,
+            [](const Entry& entry, std::size_t pc) {
+                return entry.pc < pc;
+            }
+        );
+
+        if (it == _entries.cend() || it->pc != pc) {
+            return nullptr;
+        }
+
+        return &it->registers;
+    }
+
+    const std::vector<StackMap::Entry>& StackMap::entries() const {
+        if (!_decoded) {
+            decode();
+        }
+
+        return _entries;
+    }
+
+    const std::vector<std::uint8_t>& StackMap::data() const {
+        return _data;
+    }
+
+    bool StackMap::empty() const {
+        return _data.empty();
+    }
+
+    void StackMap::decode() const {
+        std::size_t pos = 0;
+        std::size_t pc = 0;
+
+        _entries.clear();
+
+        // A truncated map only loses the safepoints after it whose frames
+        // are then scanned conservatively
+        while (pos < _data.size()) {
+            std::uint64_t pc_delta, count;
+
+            if (!read_uleb128(_data, pos, pc_delta) || !read_uleb128(_data, pos, count)) {
+                break;
+            }
+
+            Entry entry{ pc + pc_delta, {} };
+            bool complete = true;
+
+            for (std::uint64_t idx = 0; idx < count; ++idx) {
+                std::uint64_t reg;
+
+                if (!read_uleb128(_data, pos, reg)) {
+                    complete = false;
+                    break;
+                }
+
+                entry.registers.push_back(static_cast<Reg>(reg));
+            }
+
+            if (!complete) {
+                break;
+            }
+
+            pc = entry.pc;
+            _entries.push_back(std::move(entry));
+        }
+
+        _last_pc = pc;
+        _decoded = true;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef KORE_STACK_MAP_HPP
+#define KORE_STACK_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "targets/bytecode/register.hpp"
+
+namespace kore {
+    /// Maps the safepoints of a function, i.e. the instructions during
+    /// which the vm may collect garbage, to the registers that may hold a
+    /// heap object and are live across them. Only these registers of a
+    /// call frame are roots for the garbage collector
+    ///
+    /// Safepoints are instructions that allocate a heap object and calls,
+    /// since the called function may allocate. The encoded map is a
+    /// sequence of entries each made up of an unsigned program counter
+    /// delta to the previous entry, the number of registers and the
+    /// registers, all as variable-length numbers. Like line tables it is
+    /// what is written to and read from compiled files and it is only
+    /// decoded when first looked up
+    class StackMap final {
+        public:
+            struct Entry {
+                std::size_t pc;
+                std::vector<Reg> registers;
+            };
+
+        public:
+            StackMap();
+            StackMap(const std::vector<std::uint8_t>& data);
+
+            /// Add a safepoint. Program counters must be added in
+            /// ascending order
+            void add(std::size_t pc, const std::vector<Reg>& registers);
+
+            /// Get the registers at the safepoint at pc or nullptr if the
+            /// instruction at pc is not a safepoint
+            const std::vector<Reg>* lookup(std::size_t pc) const;
+
+            const std::vector<Entry>& entries() const;
+            const std::vector<std::uint8_t>& data() const;
+            bool empty() const;
+
+        private:
+            std::vector<std::uint8_t> _data;
+
+            // The program counter of the last entry, which the next delta
+            // is relative to
+            mutable std::size_t _last_pc = 0;
+
+            mutable std::vector<Entry> _entries;
+            mutable bool _decoded = false;
+
+        private:
+            void decode() const;
+    };
+}
+
+#endif // KORE_STACK_MAP_HPP
@@ -0,0 +1,63 @@
+#include "targets/bytecode/vm/builtins/array.hpp"
+#include "targets/bytecode/vm/builtins/array_kernels.hpp"
+#include "utils/unused_parameter.hpp"
+
+#include <algorithm>
+
+namespace kore {
+    namespace vm {
+        f64 sum(Vm& vm, ArrayValue* array) {
+            UNUSED_PARAM(vm);
+
+            return array_kernels().sum(array->data<f64>(), array->size());
+        }
+
+        f64 min(Vm& vm, ArrayValue* array) {
+            UNUSED_PARAM(vm);
+
+            return array_kernels().min(array->data<f64>(), array->size());
+        }
+
+        f64 max(Vm& vm, ArrayValue* array) {
+            UNUSED_PARAM(vm);
+
+            return array_kernels().max(array->data<f64>(), array->size());
+        }
+
+        f64 dot(Vm& vm, ArrayValue* array1, ArrayValue* array2) {
+            UNUSED_PARAM(vm);
+
+            auto size = std::min(array1->size(), array2->size());
+
+            return array_kernels().dot(array1->data<f64>(), array2->data<f64>(), size);
+        }
+
+        void scale(Vm& vm, ArrayValue* array, f64 factor) {
+            UNUSED_PARAM(vm);
+
+            array_kernels().scale(array->data<f64>(), array->size(), factor);
+        }
+
+        void add(Vm& vm, ArrayValue* array1, ArrayValue* array2) {
+            UNUSED_PARAM(vm);
+
+            auto size = std::min(array1->size(), array2->size());
+
+            array_kernels().add(array1->data<f64>(), array2->data<f64>(), size);
+        }
+
+        void fill(Vm& vm, ArrayValue* array, f64 value) {
+            UNUSED_PARAM(vm);
+
+            array_kernels().fill(array->data<f64>(), array->size(), value);
+        }
+
+        i32 count_eq(Vm& vm, ArrayValue* array, f64 value) {
+            UNUSED_PARAM(vm);
+
+            auto count = array_kernels().count_eq(array->data<f64>(), array->size(), value);
+
+            return static_cast<i32>(count);
+        }
+    }
+}
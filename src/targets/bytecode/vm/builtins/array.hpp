@@ -0,0 +1,35 @@
+#ifndef KORE_BUILTINS_ARRAY_HPP
+#define KORE_BUILTINS_ARRAY_HPP
+
+#include "targets/bytecode/vm/vm.hpp"
+
+namespace kore {
+    namespace vm {
+        // Builtin functions over arrays of f64. Functions taking two arrays
+        // only use as many elements as the shorter array has
+
+        /// Return the sum of the elements of an array
+        f64 sum(Vm& vm, ArrayValue* array);
+
+        /// Return the smallest or largest element of an array
+        f64 min(Vm& vm, ArrayValue* array);
+        f64 max(Vm& vm, ArrayValue* array);
+
+        /// Return the dot product of two arrays
+        f64 dot(Vm& vm, ArrayValue* array1, ArrayValue* array2);
+
+        /// Multiply every element of an array by a factor in place
+        void scale(Vm& vm, ArrayValue* array, f64 factor);
+
+        /// Add the elements of the second array to the first in place
+        void add(Vm& vm, ArrayValue* array1, ArrayValue* array2);
+
+        /// Set every element of an array to a value
+        void fill(Vm& vm, ArrayValue* array, f64 value);
+
+        /// Return the number of elements of an array equal to a value
+        i32 count_eq(Vm& vm, ArrayValue* array, f64 value);
+    }
+}
+
+#endif // KORE_BUILTINS_ARRAY_HPP
@@ -0,0 +1,392 @@
+#include "targets/bytecode/vm/builtins/array_kernels.hpp"
+#include "targets/bytecode/vm/config.hpp"
+
+#include <limits>
+
+#if KORE_VM_SIMD_SUPPORTED
+#include <immintrin.h>
+#endif
+
+namespace kore {
+    namespace vm {
+        constexpr f64 infinity = std::numeric_limits<f64>::infinity();
+
+        namespace scalar {
+            f64 sum(const f64* values, std::size_t size) {
+                f64 result = 0.0;
+
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    result += values[idx];
+                }
+
+                return result;
+            }
+
+            // Keep the current minimum or maximum if the element is NaN
+            // just like the minpd and maxpd instructions do
+            f64 min(const f64* values, std::size_t size) {
+                f64 result = infinity;
+
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    result = values[idx] < result ? values[idx] : result;
+                }
+
+                return result;
+            }
+
+            f64 max(const f64* values, std::size_t size) {
+                f64 result = -infinity;
+
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    result = values[idx] > result ? values[idx] : result;
+                }
+
+                return result;
+            }
+
+            f64 dot(const f64* values1, const f64* values2, std::size_t size) {
+                f64 result = 0.0;
+
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    result += values1[idx] * values2[idx];
+                }
+
+                return result;
+            }
+
+            void scale(f64* values, std::size_t size, f64 factor) {
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    values[idx] *= factor;
+                }
+            }
+
+            void add(f64* dst, const f64* src, std::size_t size) {
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    dst[idx] += src[idx];
+                }
+            }
+
+            void fill(f64* values, std::size_t size, f64 value) {
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    values[idx] = value;
+                }
+            }
+
+            std::size_t count_eq(const f64* values, std::size_t size, f64 value) {
+                std::size_t count = 0;
+
+                for (std::size_t idx = 0; idx < size; ++idx) {
+                    count += values[idx] == value;
+                }
+
+                return count;
+            }
+        }
+
+        const ArrayKernels& scalar_array_kernels() {
+            static const ArrayKernels kernels = {
+                "scalar",
+                scalar::sum,
+                scalar::min,
+                scalar::max,
+                scalar::dot,
+                scalar::scale,
+                scalar::add,
+                scalar::fill,
+                scalar::count_eq,
+            };
+
+            return kernels;
+        }
+
+#if KORE_VM_SIMD_SUPPORTED
+        // SSE2 is part of x86-64 so these kernels need no target attribute.
+        // Each kernel handles two elements at a time and leaves the last
+        // element of an odd-sized array to the scalar kernel
+        namespace sse2 {
+            f64 horizontal_sum(__m128d sums) {
+                return _mm_cvtsd_f64(sums) + _mm_cvtsd_f64(_mm_unpackhi_pd(sums, sums));
+            }
+
+            f64 sum(const f64* values, std::size_t size) {
+                __m128d sums = _mm_setzero_pd();
+                std::size_t idx = 0;
+
+                for (; idx + 2 <= size; idx += 2) {
+                    sums = _mm_add_pd(sums, _mm_loadu_pd(values + idx));
+                }
+
+                return horizontal_sum(sums) + scalar::sum(values + idx, size - idx);
+            }
+
+            f64 min(const f64* values, std::size_t size) {
+                __m128d mins = _mm_set1_pd(infinity);
+                std::size_t idx = 0;
+
+                // minpd returns the second operand if the first is NaN
+                for (; idx + 2 <= size; idx += 2) {
+                    mins = _mm_min_pd(_mm_loadu_pd(values + idx), mins);
+                }
+
+                f64 lanes[2];
+                _mm_storeu_pd(lanes, mins);
+                f64 result = scalar::min(lanes, 2);
+                f64 rest = scalar::min(values + idx, size - idx);
+
+                return rest < result ? rest : result;
+            }
+
+            f64 max(const f64* values, std::size_t size) {
+                __m128d maxs = _mm_set1_pd(-infinity);
+                std::size_t idx = 0;
+
+                for (; idx + 2 <= size; idx += 2) {
+                    maxs = _mm_max_pd(_mm_loadu_pd(values + idx), maxs);
+                }
+
+                f64 lanes[2];
+                _mm_storeu_pd(lanes, maxs);
+                f64 result = scalar::max(lanes, 2);
+                f64 rest = scalar::max(values + idx, size - idx);
+
+                return rest > result ? rest : result;
+            }
+
+            f64 dot(const f64* values1, const f64* values2, std::size_t size) {
+                __m128d sums = _mm_setzero_pd();
+                std::size_t idx = 0;
+
+                for (; idx + 2 <= size; idx += 2) {
+                    auto products = _mm_mul_pd(_mm_loadu_pd(values1 + idx), _mm_loadu_pd(values2 + idx));
+                    sums = _mm_add_pd(sums, products);
+                }
+
+                return horizontal_sum(sums) + scalar::dot(values1 + idx, values2 + idx, size - idx);
+            }
+
+            void scale(f64* values, std::size_t size, f64 factor) {
+                __m128d factors = _mm_set1_pd(factor);
+                std::size_t idx = 0;
+
+                for (; idx + 2 <= size; idx += 2) {
+                    _mm_storeu_pd(values + idx, _mm_mul_pd(_mm_loadu_pd(values + idx), factors));
+                }
+
+                scalar::scale(values + idx, size - idx, factor);
+            }
+
+            void add(f64* dst, const f64* src, std::size_t size) {
+                std::size_t idx = 0;
+
+                for (; idx + 2 <= size; idx += 2) {
+                    _mm_storeu_pd(dst + idx, _mm_add_pd(_mm_loadu_pd(dst + idx), _mm_loadu_pd(src + idx)));
+                }
+
+                scalar::add(dst + idx, src + idx, size - idx);
+            }
+
+            void fill(f64* values, std::size_t size, f64 value) {
+                __m128d fill_values = _mm_set1_pd(value);
+                std::size_t idx = 0;
+
+                for (; idx + 2 <= size; idx += 2) {
+                    _mm_storeu_pd(values + idx, fill_values);
+                }
+
+                scalar::fill(values + idx, size - idx, value);
+            }
+
+            std::size_t count_eq(const f64* values, std::size_t size, f64 value) {
+                __m128d compare_values = _mm_set1_pd(value);
+                std::size_t count = 0;
+                std::size_t idx = 0;
+
+                // Each lane of the comparison that is equal sets a bit of
+                // the mask
+                for (; idx + 2 <= size; idx += 2) {
+                    auto equal = _mm_cmpeq_pd(_mm_loadu_pd(values + idx), compare_values);
+                    count += __builtin_popcount(_mm_movemask_pd(equal));
+                }
+
+                return count + scalar::count_eq(values + idx, size - idx, value);
+            }
+        }
+
+        // The AVX2 kernels are compiled for AVX2 regardless of the flags of
+        // the build and are only called if the cpu supports it. Each kernel
+        // handles four elements at a time
+        #define KORE_AVX2 __attribute__((target("avx2")))
+
+        namespace avx2 {
+            KORE_AVX2 f64 horizontal_sum(__m256d sums) {
+                auto low = _mm256_castpd256_pd128(sums);
+                auto high = _mm256_extractf128_pd(sums, 1);
+
+                return sse2::horizontal_sum(_mm_add_pd(low, high));
+            }
+
+            KORE_AVX2 f64 sum(const f64* values, std::size_t size) {
+                __m256d sums = _mm256_setzero_pd();
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    sums = _mm256_add_pd(sums, _mm256_loadu_pd(values + idx));
+                }
+
+                return horizontal_sum(sums) + scalar::sum(values + idx, size - idx);
+            }
+
+            KORE_AVX2 f64 min(const f64* values, std::size_t size) {
+                __m256d mins = _mm256_set1_pd(infinity);
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    mins = _mm256_min_pd(_mm256_loadu_pd(values + idx), mins);
+                }
+
+                f64 lanes[4];
+                _mm256_storeu_pd(lanes, mins);
+                f64 result = scalar::min(lanes, 4);
+                f64 rest = scalar::min(values + idx, size - idx);
+
+                return rest < result ? rest : result;
+            }
+
+            KORE_AVX2 f64 max(const f64* values, std::size_t size) {
+                __m256d maxs = _mm256_set1_pd(-infinity);
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    maxs = _mm256_max_pd(_mm256_loadu_pd(values + idx), maxs);
+                }
+
+                f64 lanes[4];
+                _mm256_storeu_pd(lanes, maxs);
+                f64 result = scalar::max(lanes, 4);
+                f64 rest = scalar::max(values + idx, size - idx);
+
+                return rest > result ? rest : result;
+            }
+
+            KORE_AVX2 f64 dot(const f64* values1, const f64* values2, std::size_t size) {
+                __m256d sums = _mm256_setzero_pd();
+                std::size_t idx = 0;
+
+                // Multiply and add separately instead of using fma so the
+                // products are rounded like in the other kernels
+                for (; idx + 4 <= size; idx += 4) {
+                    auto products = _mm256_mul_pd(_mm256_loadu_pd(values1 + idx), _mm256_loadu_pd(values2 + idx));
+                    sums = _mm256_add_pd(sums, products);
+                }
+
+                return horizontal_sum(sums) + scalar::dot(values1 + idx, values2 + idx, size - idx);
+            }
+
+            KORE_AVX2 void scale(f64* values, std::size_t size, f64 factor) {
+                __m256d factors = _mm256_set1_pd(factor);
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    _mm256_storeu_pd(values + idx, _mm256_mul_pd(_mm256_loadu_pd(values + idx), factors));
+                }
+
+                scalar::scale(values + idx, size - idx, factor);
+            }
+
+            KORE_AVX2 void add(f64* dst, const f64* src, std::size_t size) {
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    _mm256_storeu_pd(dst + idx, _mm256_add_pd(_mm256_loadu_pd(dst + idx), _mm256_loadu_pd(src + idx)));
+                }
+
+                scalar::add(dst + idx, src + idx, size - idx);
+            }
+
+            KORE_AVX2 void fill(f64* values, std::size_t size, f64 value) {
+                __m256d fill_values = _mm256_set1_pd(value);
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    _mm256_storeu_pd(values + idx, fill_values);
+                }
+
+                scalar::fill(values + idx, size - idx, value);
+            }
+
+            KORE_AVX2 std::size_t count_eq(const f64* values, std::size_t size, f64 value) {
+                __m256d compare_values = _mm256_set1_pd(value);
+                std::size_t count = 0;
+                std::size_t idx = 0;
+
+                for (; idx + 4 <= size; idx += 4) {
+                    auto equal = _mm256_cmp_pd(_mm256_loadu_pd(values + idx), compare_values, _CMP_EQ_OQ);
+                    count += __builtin_popcount(_mm256_movemask_pd(equal));
+                }
+
+                return count + scalar::count_eq(values + idx, size - idx, value);
+            }
+        }
+
+        #undef KORE_AVX2
+#endif
+
+        const ArrayKernels* sse2_array_kernels() {
+#if KORE_VM_SIMD_SUPPORTED
+            static const ArrayKernels kernels = {
+                "sse2",
+                sse2::sum,
+                sse2::min,
+                sse2::max,
+                sse2::dot,
+                sse2::scale,
+                sse2::add,
+                sse2::fill,
+                sse2::count_eq,
+            };
+
+            return &kernels;
+#else
+            return nullptr;
+#endif
+        }
+
+        const ArrayKernels* avx2_array_kernels() {
+#if KORE_VM_SIMD_SUPPORTED
+            static const ArrayKernels kernels = {
+                "avx2",
+                avx2::sum,
+                avx2::min,
+                avx2::max,
+                avx2::dot,
+                avx2::scale,
+                avx2::add,
+                avx2::fill,
+                avx2::count_eq,
+            };
+
+            // Checks the cpuid feature bits, and that the os saves the ymm
+            // registers
+            return __builtin_cpu_supports("avx2") ? &kernels : nullptr;
+#else
+            return nullptr;
+#endif
+        }
+
+        const ArrayKernels& select_array_kernels() {
+            auto kernels = avx2_array_kernels();
+
+            if (!kernels) {
+                kernels = sse2_array_kernels();
+            }
+
+            return kernels ? *kernels : scalar_array_kernels();
+        }
+
+        const ArrayKernels& array_kernels() {
+            static const ArrayKernels& kernels = select_array_kernels();
+
+            return kernels;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef KORE_BUILTINS_ARRAY_KERNELS_HPP
+#define KORE_BUILTINS_ARRAY_KERNELS_HPP
+
+#include "internal_value_types.hpp"
+
+#include <cstddef>
+#include <string_view>
+
+namespace kore {
+    namespace vm {
+        /// The loops of the array builtin functions over contiguous f64
+        /// elements. There is a set of kernels for each instruction set and
+        /// all of them compute the same results except that sums may be
+        /// rounded differently since vector kernels add elements in a
+        /// different order
+        struct ArrayKernels {
+            std::string_view name;
+
+            f64 (*sum)(const f64* values, std::size_t size);
+
+            /// Return +inf (min) or -inf (max) for an empty array. NaN
+            /// elements are ignored
+            f64 (*min)(const f64* values, std::size_t size);
+            f64 (*max)(const f64* values, std::size_t size);
+
+            f64 (*dot)(const f64* values1, const f64* values2, std::size_t size);
+            void (*scale)(f64* values, std::size_t size, f64 factor);
+
+            /// Add the elements of src to the elements of dst
+            void (*add)(f64* dst, const f64* src, std::size_t size);
+
+            void (*fill)(f64* values, std::size_t size, f64 value);
+            std::size_t (*count_eq)(const f64* values, std::size_t size, f64 value);
+        };
+
+        /// Portable kernels that handle one element at a time
+        const ArrayKernels& scalar_array_kernels();
+
+        /// Kernels using SSE2 or AVX2 instructions, or nullptr if the cpu
+        /// does not support them
+        const ArrayKernels* sse2_array_kernels();
+        const ArrayKernels* avx2_array_kernels();
+
+        /// The best kernels supported by the cpu, detected via cpuid the
+        /// first time this is called
+        const ArrayKernels& array_kernels();
+    }
+}
+
+#endif // KORE_BUILTINS_ARRAY_KERNELS_HPP
@@ -1,43 +1,65 @@
+#include "targets/bytecode/vm/builtins/array.hpp"
 #include "targets/bytecode/vm/builtins/builtins.hpp"
 #include "targets/bytecode/vm/builtins/io.hpp"
 #include "targets/bytecode/vm/builtins/math.hpp"
-#include "types/type_category.hpp"
-
-#include <array>
+#include "types/array_type.hpp"
+#include "types/function_type.hpp"
+#include "types/type.hpp"
 
 namespace kore {
     namespace vm {
-        const std::array<BuiltinFunction, 2> _builtins = {
+        constexpr std::array<BuiltinFunction, 10> _builtins = {
             {
-                {
-                    0,
-                    print,
-                    "print",
-                    Type::make_function_type(
-                        // TODO: Change to TypeCategory::Generic when it is implemented
-                        { Type::get_type_from_category(TypeCategory::Integer32) },
-                        { Type::get_type_from_category(TypeCategory::Void) }
-                    )
-                },
-                {
-                    1,
-                    abs,
-                    "abs",
-                    Type::make_function_type(
-                        { Type::get_type_from_category(TypeCategory::Integer32) },
-                        { Type::get_type_from_category(TypeCategory::Integer32) }
-                    )
-                }
+                // TODO: Change print's parameter to TypeCategory::Generic when it is implemented
+                make_builtin_function<print>(0, "print"),
+                make_builtin_function<abs>(1, "abs"),
+                make_builtin_function<sum>(2, "sum"),
+                make_builtin_function<min>(3, "min"),
+                make_builtin_function<max>(4, "max"),
+                make_builtin_function<dot>(5, "dot"),
+                make_builtin_function<scale>(6, "scale"),
+                make_builtin_function<add>(7, "add"),
+                make_builtin_function<fill>(8, "fill"),
+                make_builtin_function<count_eq>(9, "count_eq"),
             },
         };
 
-        // TODO: Can we construct this statically?
-        std::unordered_map<std::string, BuiltinFunctionIndex> _builtins_by_name {
-            { "print", 0 },
-            { "abs", 1 },
-        };
-        
-        /* static_assert(_builtins.size() == _builtins_by_name.size()); */
+        static_assert(
+            [] {
+                for (std::size_t idx = 0; idx < _builtins.size(); ++idx) {
+                    if (_builtins[idx].index != idx) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }(),
+            "Builtin functions must be listed in the order of their indices"
+        );
+
+        /// Get the kore type of a parameter of a builtin function
+        const Type* parameter_type(TypeCategory category) {
+            if (category == TypeCategory::Array) {
+                return Type::make_array_type(Type::get_type_from_category(TypeCategory::Float64));
+            }
+
+            return Type::get_type_from_category(category);
+        }
+
+        const FunctionType* BuiltinFunction::type() const {
+            std::vector<const Type*> parameter_types;
+
+            for (int idx = 0; idx < arity; ++idx) {
+                parameter_types.push_back(parameter_type(parameter_categories[idx]));
+            }
+
+            // Function types are cached so this returns the same type every
+            // time it is called
+            return Type::make_function_type(
+                parameter_types,
+                { Type::get_type_from_category(return_category) }
+            );
+        }
 
         int builtin_function_count() {
             return _builtins.size();
@@ -51,14 +73,16 @@ namespace kore {
             return &_builtins[idx];
         }
 
-        const BuiltinFunction* get_builtin_function_by_name(const std::string& name) {
-            auto it = _builtins_by_name.find(name);
-
-            if (it == _builtins_by_name.end()) {
-                return nullptr;
+        const BuiltinFunction* get_builtin_function_by_name(std::string_view name) {
+            // There are only a handful of builtin functions so a linear
+            // search is fine and keeps the table constant
+            for (auto& builtin : _builtins) {
+                if (builtin.name == name) {
+                    return &builtin;
+                }
             }
 
-            return get_builtin_function_by_index(it->second);
+            return nullptr;
         }
     }
 }
@@ -1,28 +1,156 @@
 #ifndef KORE_BUILTINS_HPP
 #define KORE_BUILTINS_HPP
 
+#include "internal_value_types.hpp"
+#include "targets/bytecode/vm/config.hpp"
 #include "targets/bytecode/vm/vm.hpp"
+#include "types/type_category.hpp"
 
-#include <functional>
+#include <array>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace kore {
+    class FunctionType;
+
     namespace vm {
         using BuiltinFunctionIndex = unsigned int;
 
-        // Pass a reference to the VM so builtin functions can access VM state
-        // and set return values in the register window
-        using BuiltinFunctionPointer = std::function<void(Vm& vm, const Value* args)>;
+        // Pass a reference to the VM so builtin functions can access VM
+        // state. The arguments are in consecutive registers in the caller's
+        // register window and the return value is written to the first of
+        // them
+        using BuiltinFunctionPointer = void (*)(Vm& vm, RegisterValue* registers);
+
+        /// Maps a C++ type used in the signature of a builtin function to
+        /// its kore type and to and from register values
+        template<typename T>
+        struct BuiltinValueType;
+
+        #define KORE_BUILTIN_VALUE_TYPE(type, type_category, accessor)\
+            template<>\
+            struct BuiltinValueType<type> {\
+                static constexpr TypeCategory category = TypeCategory::type_category;\
+                \
+                static inline type load(const RegisterValue& value) {\
+                    return value.as_##accessor();\
+                }\
+                \
+                static inline RegisterValue store(type value) {\
+                    return RegisterValue::from_##accessor(value);\
+                }\
+            };
+
+        KORE_BUILTIN_VALUE_TYPE(bool, Bool, bool)
+        KORE_BUILTIN_VALUE_TYPE(i32, Integer32, i32)
+        KORE_BUILTIN_VALUE_TYPE(i64, Integer64, i64)
+        KORE_BUILTIN_VALUE_TYPE(f32, Float32, f32)
+        KORE_BUILTIN_VALUE_TYPE(f64, Float64, f64)
+
+        #undef KORE_BUILTIN_VALUE_TYPE
+
+        /// Arrays are passed to builtin functions by pointer. Array
+        /// parameters of builtin functions are always arrays of f64 since
+        /// kore has no generic types yet
+        template<>
+        struct BuiltinValueType<ArrayValue*> {
+            static constexpr TypeCategory category = TypeCategory::Array;
+
+            static inline ArrayValue* load(const RegisterValue& value) {
+                return const_cast<ArrayValue*>(value.as_array());
+            }
+        };
+
+        /// Generates the code for calling a builtin function from its
+        /// signature. Builtin functions are ordinary functions taking a
+        /// reference to the vm followed by zero or more value type arguments
+        /// and returning a value type or nothing
+        template<typename Signature>
+        struct BuiltinSignature;
+
+        template<typename Ret, typename... Args>
+        struct BuiltinSignature<Ret (*)(Vm&, Args...)> {
+            static_assert(
+                sizeof...(Args) <= KORE_VM_MAX_BUILTIN_ARGUMENTS,
+                "Too many arguments for builtin function"
+            );
+
+            static constexpr int arity = sizeof...(Args);
+            static constexpr int return_arity = std::is_void_v<Ret> ? 0 : 1;
+
+            static constexpr std::array<TypeCategory, KORE_VM_MAX_BUILTIN_ARGUMENTS>
+            parameter_categories() {
+                return {{ BuiltinValueType<Args>::category... }};
+            }
+
+            static constexpr TypeCategory return_category() {
+                if constexpr (std::is_void_v<Ret>) {
+                    return TypeCategory::Void;
+                } else {
+                    return BuiltinValueType<Ret>::category;
+                }
+            }
+
+            /// Read the arguments straight from the registers, call the
+            /// builtin function and write its return value back. The builtin
+            /// function is known at compile time so this is a direct call
+            template<Ret (*Func)(Vm&, Args...), std::size_t... Indices>
+            static inline void invoke_with_indices(
+                Vm& vm,
+                RegisterValue* registers,
+                std::index_sequence<Indices...>
+            ) {
+                if constexpr (std::is_void_v<Ret>) {
+                    Func(vm, BuiltinValueType<Args>::load(registers[Indices])...);
+                } else {
+                    auto value = Func(vm, BuiltinValueType<Args>::load(registers[Indices])...);
+                    registers[0] = BuiltinValueType<Ret>::store(value);
+                }
+            }
+
+            template<Ret (*Func)(Vm&, Args...)>
+            static void invoke(Vm& vm, RegisterValue* registers) {
+                invoke_with_indices<Func>(vm, registers, std::index_sequence_for<Args...>{});
+            }
+        };
 
         struct BuiltinFunction {
             BuiltinFunctionIndex index;
             BuiltinFunctionPointer func;
-            std::string name;
-            const FunctionType* type;
+            std::string_view name;
+            int arity;
+            int return_arity;
+            std::array<TypeCategory, KORE_VM_MAX_BUILTIN_ARGUMENTS> parameter_categories;
+            TypeCategory return_category;
+
+            /// The kore type of the builtin function
+            const FunctionType* type() const;
         };
 
+        /// Make a builtin function whose calling code and type are derived
+        /// from the signature of a C++ function
+        template<auto Func>
+        constexpr BuiltinFunction make_builtin_function(
+            BuiltinFunctionIndex index,
+            std::string_view name
+        ) {
+            using Signature = BuiltinSignature<decltype(Func)>;
+
+            return BuiltinFunction{
+                index,
+                Signature::template invoke<Func>,
+                name,
+                Signature::arity,
+                Signature::return_arity,
+                Signature::parameter_categories(),
+                Signature::return_category(),
+            };
+        }
+
         int builtin_function_count();
         const BuiltinFunction* get_builtin_function_by_index(BuiltinFunctionIndex idx);
-        const BuiltinFunction* get_builtin_function_by_name(const std::string& name);
+        const BuiltinFunction* get_builtin_function_by_name(std::string_view name);
     }
 }
 
@@ -5,10 +5,10 @@
 
 namespace kore {
     namespace vm {
-        void print(Vm& vm, const Value* args) {
+        void print(Vm& vm, i32 value) {
             UNUSED_PARAM(vm);
 
-            args[0].display_value(std::cout);
+            Value::from_i32(value).display_value(std::cout);
             std::cout << std::endl;
         }
     }
@@ -5,7 +5,7 @@
 
 namespace kore {
     namespace vm {
-        void print(Vm& vm, const Value* args);
+        void print(Vm& vm, i32 value);
     }
 }
 
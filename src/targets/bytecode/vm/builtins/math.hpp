@@ -6,7 +6,7 @@
 namespace kore {
     namespace vm {
         /// Return the absolute value of a value
-        void abs(Vm& vm, const Value* args);
+        i32 abs(Vm& vm, i32 value);
     }
 }
 
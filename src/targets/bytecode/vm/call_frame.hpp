@@ -0,0 +1,39 @@
+#ifndef KORE_CALL_FRAME_HPP
+#define KORE_CALL_FRAME_HPP
+
+#include "targets/bytecode/vm/decoded_instruction.hpp"
+
+#include <cstddef>
+
+namespace kore {
+    class CompiledObject;
+
+    namespace x64 {
+        class NativeCode;
+    }
+
+    namespace vm {
+        /// A call frame only records what is needed to execute its function
+        /// and to return from it. The size of its register window is implied
+        /// by the frame pointer since the window starts there and return
+        /// values always end up at the start of the window
+        struct CallFrame {
+            // Pointer to instructions currently being executed
+            const DecodedInstruction* code;
+
+            // Native code compiled from the instructions by the jit or
+            // nullptr if they are only interpreted
+            const x64::NativeCode* native_code;
+
+            // The function being executed
+            const CompiledObject* func;
+
+            // The old frame pointer and program counter that we need to
+            // restore when we pop this call frame
+            std::size_t old_fp;
+            std::size_t old_pc;
+        };
+    }
+}
+
+#endif // KORE_CALL_FRAME_HPP
@@ -1,17 +1,70 @@
 #ifndef KORE_VM_CONFIG_HPP
 #define KORE_VM_CONFIG_HPP
 
+#include <cstddef>
+#include <cstdint>
+
 namespace kore {
     namespace vm {
+        // The maximum number of registers used by a single function
         #ifndef KORE_VM_MAX_REGISTERS
             constexpr int KORE_VM_MAX_REGISTERS = 256;
         #else
             constexpr int KORE_VM_MAX_REGISTERS = KORE_VM_MAX_REGISTERS;
         #endif
 
-        /* #ifndef KORE_VM_CALLSTACK_SIZE */
-        /*     constexpr int KORE_VM_CALLSTACK_SIZE = 256; */
-        /* #endif */
+        // The number of registers reserved for the register stack shared by
+        // all call frames. Memory is only committed as it is used
+        constexpr std::size_t KORE_VM_REGISTER_STACK_SIZE = 1 << 22;
+
+        // The maximum number of arguments that can be passed to a builtin
+        // function when registers are untagged
+        constexpr int KORE_VM_MAX_BUILTIN_ARGUMENTS = 8;
+
+        // Use threaded dispatch (labels as values) for the interpreter loop if
+        // enabled and supported by the compiler, otherwise fall back to a
+        // portable switch statement
+        #if defined(KORE_VM_THREADED_DISPATCH) && defined(__GNUC__)
+            #define KORE_VM_USE_COMPUTED_GOTO 1
+        #else
+            #define KORE_VM_USE_COMPUTED_GOTO 0
+        #endif
+
+        // The maximum number of call frames. Memory is only committed as it
+        // is used
+        constexpr std::size_t KORE_VM_CALLSTACK_SIZE = 1 << 20;
+
+        // The jit compiles hot functions to x86-64 machine code and relies
+        // on the System V calling convention and mmap
+        #if defined(__x86_64__) && defined(__linux__)
+            #define KORE_VM_JIT_SUPPORTED 1
+        #else
+            #define KORE_VM_JIT_SUPPORTED 0
+        #endif
+
+        // The array builtin functions have SSE2 and AVX2 kernels on x86-64
+        // which are chosen at runtime depending on what the cpu supports
+        #if defined(__x86_64__) && defined(__GNUC__)
+            #define KORE_VM_SIMD_SUPPORTED 1
+        #else
+            #define KORE_VM_SIMD_SUPPORTED 0
+        #endif
+
+        // The number of calls or backward jumps after which a function is
+        // re-optimised when tiering is enabled
+        constexpr std::uint32_t KORE_VM_TIER_THRESHOLD = 100;
+
+        // The number of bytes of heap objects that can be allocated before
+        // the first garbage collection. After each collection the heap may
+        // grow to twice the bytes that survived it before collecting again
+        constexpr std::size_t KORE_VM_GC_THRESHOLD = 1 << 22;
+
+        // The default maximum number of bytes of live heap objects
+        constexpr std::size_t KORE_VM_HEAP_LIMIT = std::size_t(1) << 32;
+
+        // The default number of call stack samples per second of cpu time
+        // taken by the sampling profiler
+        constexpr std::uint32_t KORE_VM_SAMPLING_FREQUENCY = 1000;
     }
 }
 
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "targets/bytecode/constant_table.hpp"
+#include "targets/bytecode/module_load_error.hpp"
+#include "targets/bytecode/vm/decoded_instruction.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+
+namespace kore {
+    namespace vm {
+        std::vector<DecodedInstruction> decode_instructions(
+            const bytecode_type* code,
+            std::size_t code_size,
+            const ConstantTable& constants
+        ) {
+            std::vector<DecodedInstruction> decoded;
+
+            // Jump offsets are byte offsets relative to the jump instruction
+            // in the compiled code where compare-and-branch instructions take
+            // up two words, so keep track of where each instruction started
+            // there to resolve the targets
+            std::vector<std::size_t> byte_positions;
+            std::size_t byte_pos = 0;
+
+            decoded.reserve(code_size);
+            byte_positions.reserve(code_size);
+
+            for (std::size_t pos = 0; pos < code_size; ++pos) {
+                auto instruction = code[pos];
+                auto opcode = GET_OPCODE(instruction);
+                DecodedInstruction decoded_instruction{};
+
+                decoded_instruction.opcode = opcode;
+                decoded_instruction.reg1 = GET_REG1(instruction);
+                decoded_instruction.reg2 = GET_REG2(instruction);
+                decoded_instruction.reg3 = GET_REG3(instruction);
+                byte_positions.push_back(byte_pos);
+                byte_pos += 4;
+
+                switch (opcode) {
+                    case Bytecode::Cload: {
+                        auto index = GET_VALUE(instruction);
+
+                        if (index >= constants.size()) {
+                            throw ModuleLoadError("Constant index out of range");
+                        }
+
+                        #ifdef KORE_VM_UNTAGGED_REGISTERS
+                            decoded_instruction.raw_constant = RawValue::from_value(
+                                *constants.get_pointer(index)
+                            );
+                        #else
+                            decoded_instruction.constant = constants.get_pointer(index);
+                        #endif
+                        break;
+                    }
+
+                    case Bytecode::Jump:
+                    case Bytecode::JumpIf:
+                    case Bytecode::JumpIfNot: {
+                        // Offsets are signed so we can jump backwards in loops.
+                        // Save the absolute byte position for now and resolve
+                        // it once all instructions have been decoded
+                        auto offset = static_cast<std::int16_t>(GET_OFFSET(instruction));
+                        decoded_instruction.target = byte_positions.back() + offset;
+                        break;
+                    }
+
+                    case Bytecode::AddI32K:
+                    case Bytecode::SubI32K: {
+                        decoded_instruction.value = static_cast<std::int8_t>(GET_REG3(instruction));
+                        break;
+                    }
+
+                    case Bytecode::JumpIfLtI32:
+                    case Bytecode::JumpIfGtI32:
+                    case Bytecode::JumpIfLeI32:
+                    case Bytecode::JumpIfGeI32:
+                    case Bytecode::JumpIfEqI32:
+                    case Bytecode::JumpIfNeqI32: {
+                        // The jump offset is in the following word
+                        if (++pos >= code_size) {
+                            throw ModuleLoadError("Truncated instruction operands");
+                        }
+
+                        auto offset = static_cast<std::int16_t>(GET_OFFSET(code[pos]));
+                        decoded_instruction.target = byte_positions.back() + offset;
+                        byte_pos += 4;
+                        break;
+                    }
+
+                    default:
+                        // Quickened instructions follow the last opcode
+                        // that can appear in compiled code
+                        if (opcode > Bytecode::ArraySetF64) {
+                            throw ModuleLoadError("Unknown opcode", -1, opcode);
+                        }
+
+                        decoded_instruction.value = GET_VALUE(instruction);
+                        break;
+                }
+
+                decoded.push_back(decoded_instruction);
+            }
+
+            // Resolve jump targets to indices of decoded instructions
+            for (auto& decoded_instruction : decoded) {
+                switch (decoded_instruction.opcode) {
+                    case Bytecode::Jump:
+                    case Bytecode::JumpIf:
+                    case Bytecode::JumpIfNot:
+                    case Bytecode::JumpIfLtI32:
+                    case Bytecode::JumpIfGtI32:
+                    case Bytecode::JumpIfLeI32:
+                    case Bytecode::JumpIfGeI32:
+                    case Bytecode::JumpIfEqI32:
+                    case Bytecode::JumpIfNeqI32: {
+                        auto target = decoded_instruction.target;
+                        auto it = std::lower_bound(byte_positions.cbegin(), byte_positions.cend(), target);
+
+                        if (it == byte_positions.cend() || *it != target) {
+                            throw ModuleLoadError("Jump target is not an instruction");
+                        }
+
+                        decoded_instruction.target = it - byte_positions.cbegin();
+                        break;
+                    }
+
+                    default:
+                        break;
+                }
+            }
+
+            return decoded;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef KORE_DECODED_INSTRUCTION_HPP
+#define KORE_DECODED_INSTRUCTION_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "targets/bytecode/codegen/bytecode.hpp"
+#include "targets/bytecode/vm/register_value.hpp"
+#include "targets/bytecode/register.hpp"
+
+namespace kore {
+    class ConstantTable;
+
+    namespace vm {
+        struct InlineCache;
+
+        /// An instruction whose operands have been decoded once when its
+        /// function was loaded so that the vm does not have to shift and mask
+        /// them out of the compact bytecode format on every execution
+        struct DecodedInstruction {
+            Bytecode opcode;
+
+            // For Call, reg2 is the first register of the callee's window
+            // and reg3 the argument count. For Ret, reg1 is the first return
+            // register and reg2 the return count
+            Reg reg1;
+            Reg reg2;
+            Reg reg3;
+
+            union {
+                // Immediate value such as a function index, an array size or
+                // the constant operand of AddI32K and SubI32K
+                int value;
+
+                // Index of the decoded instruction to jump to
+                std::size_t target;
+
+                // Constant loaded by Cload
+                const Value* constant;
+
+                // Constant loaded by Cload stripped of its tag when compiled
+                // with KORE_VM_UNTAGGED_REGISTERS
+                RawValue raw_constant;
+
+                // Inline cache of a Call instruction and the instructions it
+                // is quickened to, owned by the function of the instruction
+                InlineCache* cache;
+            };
+        };
+
+        /// Decode the instructions of a function. Constants are resolved
+        /// against the given constant table so it must not be modified
+        /// afterwards. Throws a ModuleLoadError on malformed code
+        std::vector<DecodedInstruction> decode_instructions(
+            const bytecode_type* code,
+            std::size_t code_size,
+            const ConstantTable& constants
+        );
+    }
+}
+
+#endif // KORE_DECODED_INSTRUCTION_HPP
@@ -0,0 +1,198 @@
+#include "targets/bytecode/vm/heap.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+namespace kore {
+    namespace vm {
+        HeapObject::HeapObject() {}
+
+        HeapObject::~HeapObject() {
+            if (_heap) {
+                _heap->remove(this);
+            }
+        }
+
+        Heap::Heap(std::size_t limit) : _limit(limit) {
+            update_threshold();
+        }
+
+        Heap::~Heap() {
+            while (_objects) {
+                delete _objects;
+            }
+        }
+
+        void Heap::set_root_marker(RootMarker root_marker) {
+            _root_marker = std::move(root_marker);
+        }
+
+        void Heap::set_limit(std::size_t limit) {
+            _limit = limit;
+            update_threshold();
+        }
+
+        std::size_t Heap::limit() const noexcept {
+            return _limit;
+        }
+
+        void Heap::set_stress(bool stress) {
+            _stress = stress;
+        }
+
+        bool Heap::stress() const noexcept {
+            return _stress;
+        }
+
+        bool Heap::add(HeapObject* object) {
+            auto bytes = object->heap_size();
+
+            if (_stress || _bytes + bytes > _threshold) {
+                collect();
+            }
+
+            if (_bytes + bytes > _limit) {
+                return false;
+            }
+
+            object->_heap = this;
+            object->_heap_bytes = bytes;
+            object->_prev = nullptr;
+            object->_next = _objects;
+
+            if (_objects) {
+                _objects->_prev = object;
+            }
+
+            _objects = object;
+            ++_object_count;
+            _bytes += bytes;
+            _stats.peak_bytes = std::max(_stats.peak_bytes, _bytes);
+
+            return true;
+        }
+
+        void Heap::collect() {
+            auto start = std::chrono::steady_clock::now();
+
+            _collecting = true;
+
+            if (_root_marker) {
+                _root_marker(*this);
+            }
+
+            trace();
+            sweep();
+
+            _collecting = false;
+            _addresses.clear();
+            update_threshold();
+
+            auto end = std::chrono::steady_clock::now();
+            auto pause = std::chrono::duration<double>(end - start).count();
+
+            ++_stats.collections;
+            _stats.pause_seconds += pause;
+            _stats.max_pause_seconds = std::max(_stats.max_pause_seconds, pause);
+        }
+
+        void Heap::mark(HeapObject* object) {
+            // Objects allocated outside of the heap are never collected
+            if (!object || object->_heap != this || object->_marked) {
+                return;
+            }
+
+            object->_marked = true;
+            _worklist.push_back(object);
+        }
+
+        void Heap::mark_candidate(HeapObject* object) {
+            if (!object || !_collecting) {
+                return;
+            }
+
+            if (_addresses.empty()) {
+                for (auto current = _objects; current; current = current->_next) {
+                    _addresses.insert(current);
+                }
+            }
+
+            if (_addresses.find(object) != _addresses.end()) {
+                mark(object);
+            }
+        }
+
+        std::size_t Heap::bytes() const noexcept {
+            return _bytes;
+        }
+
+        std::size_t Heap::object_count() const noexcept {
+            return _object_count;
+        }
+
+        const GcStats& Heap::stats() const noexcept {
+            return _stats;
+        }
+
+        void Heap::dump_stats(std::ostream& os) const {
+            os << "garbage collection statistics:" << std::endl
+               << "    collections:  " << _stats.collections << std::endl
+               << "    pause time:   " << std::fixed << std::setprecision(3)
+               << _stats.pause_seconds * 1000.0 << "ms (max "
+               << _stats.max_pause_seconds * 1000.0 << "ms)" << std::endl
+               << "    freed:        " << _stats.objects_freed << " objects, "
+               << _stats.bytes_freed << " bytes" << std::endl
+               << "    heap size:    " << _bytes << " bytes in " << _object_count
+               << " objects (peak " << _stats.peak_bytes << " bytes)" << std::endl
+               << "    heap limit:   " << _limit << " bytes" << std::endl
+               << "    stress mode:  " << (_stress ? "enabled" : "disabled") << std::endl;
+        }
+
+        void Heap::remove(HeapObject* object) {
+            if (object->_prev) {
+                object->_prev->_next = object->_next;
+            } else {
+                _objects = object->_next;
+            }
+
+            if (object->_next) {
+                object->_next->_prev = object->_prev;
+            }
+
+            object->_heap = nullptr;
+            --_object_count;
+            _bytes -= object->_heap_bytes;
+        }
+
+        void Heap::trace() {
+            // Trace iteratively so long chains of objects do not overflow
+            // the native stack
+            while (!_worklist.empty()) {
+                auto object = _worklist.back();
+                _worklist.pop_back();
+                object->trace(*this);
+            }
+        }
+
+        void Heap::sweep() {
+            for (auto object = _objects; object;) {
+                auto next = object->_next;
+
+                if (object->_marked) {
+                    object->_marked = false;
+                } else {
+                    ++_stats.objects_freed;
+                    _stats.bytes_freed += object->_heap_bytes;
+                    delete object;
+                }
+
+                object = next;
+            }
+        }
+
+        void Heap::update_threshold() {
+            _threshold = std::min(std::max(KORE_VM_GC_THRESHOLD, 2 * _bytes), _limit);
+        }
+    }
+}
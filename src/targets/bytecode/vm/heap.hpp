@@ -0,0 +1,156 @@
+#ifndef KORE_HEAP_HPP
+#define KORE_HEAP_HPP
+
+#include "targets/bytecode/vm/config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <unordered_set>
+#include <vector>
+
+namespace kore {
+    namespace vm {
+        class Heap;
+
+        /// Base class of values allocated on the vm's heap such as arrays.
+        /// Objects are linked into the heap they were added to and unlink
+        /// themselves when they are destroyed, e.g. by reference counting,
+        /// so the garbage collector only sees objects that are still alive
+        class HeapObject {
+            public:
+                HeapObject();
+                HeapObject(const HeapObject&) = delete;
+                HeapObject& operator=(const HeapObject&) = delete;
+                virtual ~HeapObject();
+
+                /// Number of bytes used by the object and its elements
+                virtual std::size_t heap_size() const = 0;
+
+                /// Mark the heap objects referenced by the object
+                virtual void trace(Heap& heap) = 0;
+
+            private:
+                friend class Heap;
+
+                Heap* _heap = nullptr;
+                HeapObject* _prev = nullptr;
+                HeapObject* _next = nullptr;
+
+                // The size of the object when it was added so the heap
+                // subtracts the same size when it is removed
+                std::size_t _heap_bytes = 0;
+                bool _marked = false;
+        };
+
+        struct GcStats {
+            std::uint64_t collections = 0;
+            std::uint64_t objects_freed = 0;
+            std::uint64_t bytes_freed = 0;
+            std::size_t peak_bytes = 0;
+            double pause_seconds = 0.0;
+            double max_pause_seconds = 0.0;
+        };
+
+        /// The vm's garbage collected heap
+        ///
+        /// Reference counting frees most objects as soon as they are no
+        /// longer used. A precise mark-sweep collector frees the rest, i.e.
+        /// objects that are only reachable from each other or from dead
+        /// registers. A collection runs when adding an object would grow
+        /// the heap past a threshold of twice the bytes that survived the
+        /// previous collection, and the heap never grows past its limit.
+        ///
+        /// The heap does not know where its roots are. The root marker
+        /// marks them, typically the live registers holding heap objects
+        /// of every call frame according to the stack maps of their
+        /// functions. Objects are then traced from the roots and the
+        /// unmarked objects are deleted without releasing the objects they
+        /// reference, which are either marked or deleted as well
+        class Heap final {
+            public:
+                /// Marks the roots of a collection
+                using RootMarker = std::function<void(Heap&)>;
+
+            public:
+                Heap(std::size_t limit = KORE_VM_HEAP_LIMIT);
+                Heap(const Heap&) = delete;
+                Heap& operator=(const Heap&) = delete;
+
+                /// Delete the objects that are left
+                ~Heap();
+
+                /// Set the function that marks the roots. A heap without a
+                /// root marker has no roots
+                void set_root_marker(RootMarker root_marker);
+
+                /// Set the maximum number of bytes of objects in the heap
+                void set_limit(std::size_t limit);
+                std::size_t limit() const noexcept;
+
+                /// Collect garbage before adding every object. Used for
+                /// testing that all roots are found
+                void set_stress(bool stress);
+                bool stress() const noexcept;
+
+                /// Add a newly allocated object, collecting garbage first if
+                /// the heap has grown past its threshold. Returns false
+                /// without adding the object if it does not fit within the
+                /// limit even after collecting
+                bool add(HeapObject* object);
+
+                /// Mark the roots, trace the objects reachable from them
+                /// and delete the rest
+                void collect();
+
+                /// Mark a root or an object referenced by another object
+                void mark(HeapObject* object);
+
+                /// Mark a value that may or may not be an object in the
+                /// heap, such as an untagged register or array element
+                /// that cannot be told apart from other values or a
+                /// register of a function without a stack map. Addresses
+                /// that are not objects in the heap are ignored
+                void mark_candidate(HeapObject* object);
+
+                /// The number of bytes and objects currently in the heap
+                std::size_t bytes() const noexcept;
+                std::size_t object_count() const noexcept;
+
+                const GcStats& stats() const noexcept;
+                void dump_stats(std::ostream& os) const;
+
+            private:
+                friend class HeapObject;
+
+                std::size_t _limit;
+                std::size_t _threshold;
+                bool _stress = false;
+                RootMarker _root_marker;
+
+                // Doubly linked list of all objects in the heap
+                HeapObject* _objects = nullptr;
+                std::size_t _object_count = 0;
+                std::size_t _bytes = 0;
+
+                // Objects marked but not traced yet during a collection
+                std::vector<HeapObject*> _worklist;
+
+                // The objects in the heap during a collection, only built
+                // once a candidate needs to be checked
+                std::unordered_set<const HeapObject*> _addresses;
+                bool _collecting = false;
+
+                GcStats _stats;
+
+            private:
+                void remove(HeapObject* object);
+                void trace();
+                void sweep();
+                void update_threshold();
+        };
+    }
+}
+
+#endif // KORE_HEAP_HPP
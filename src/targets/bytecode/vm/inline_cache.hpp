@@ -0,0 +1,38 @@
+#ifndef KORE_INLINE_CACHE_HPP
+#define KORE_INLINE_CACHE_HPP
+
+#include <cstdint>
+
+namespace kore {
+    class CompiledObject;
+
+    namespace vm {
+        struct BuiltinFunction;
+        struct DecodedInstruction;
+
+        /// Monomorphic inline cache of a call site. The first function
+        /// called from the call site is cached and the call instruction is
+        /// quickened to call it directly for as long as the call site keeps
+        /// calling it. Kept next to the compiled function like its tier state
+        struct InlineCache {
+            // Function cached by a CallDirect instruction and its decoded
+            // code which becomes the code of the new call frame
+            const CompiledObject* func = nullptr;
+            const DecodedInstruction* code = nullptr;
+
+            // Builtin function cached by a CallBuiltin instruction
+            const BuiltinFunction* builtin = nullptr;
+
+            // The cached function as referenced by an untagged register,
+            // see RawValue
+            int function_index = 0;
+
+            // Calls of the cached function and calls that took the generic
+            // path after the call site saw another function
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+        };
+    }
+}
+
+#endif // KORE_INLINE_CACHE_HPP
@@ -0,0 +1,253 @@
+#include "targets/bytecode/vm/profiler.hpp"
+#include "targets/bytecode/compiled_object.hpp"
+
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+
+#if defined(__x86_64__)
+    #include <x86intrin.h>
+#endif
+
+namespace kore {
+    namespace vm {
+        std::uint64_t read_nanoseconds() {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+
+            return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        /// Read the time stamp counter if available which is much cheaper
+        /// than asking the operating system for the time at every call
+        inline std::uint64_t read_ticks() {
+#if defined(__x86_64__)
+            return __rdtsc();
+#else
+            return read_nanoseconds();
+#endif
+        }
+
+        std::string function_name(const FunctionProfile& profile) {
+            return profile.func ? profile.func->name() : "<unknown>";
+        }
+
+        std::string escape_json(const std::string& value) {
+            std::string escaped;
+
+            for (auto c : value) {
+                if (c == '"' || c == '\\') {
+                    escaped += '\\';
+                }
+
+                escaped += c;
+            }
+
+            return escaped;
+        }
+
+        Profiler::Profiler()
+            : _last_ticks(read_ticks()),
+              _start_ticks(_last_ticks),
+              _start_ns(read_nanoseconds()) {
+        }
+
+        void Profiler::enter(const CompiledObject* func) {
+            auto ticks = charge_ticks();
+            auto& profile = _functions[func];
+
+            profile.func = func;
+            ++profile.calls;
+            ++profile.active;
+
+            _activations.push_back(Activation{ &profile, ticks, _instruction_count });
+            _current = &profile;
+        }
+
+        void Profiler::leave() {
+            if (_activations.empty()) {
+                return;
+            }
+
+            auto ticks = charge_ticks();
+            auto activation = _activations.back();
+            auto profile = activation.profile;
+            _activations.pop_back();
+
+            if (--profile->active == 0) {
+                profile->inclusive_instructions += _instruction_count - activation.start_instructions;
+                profile->inclusive_ticks += ticks - activation.start_ticks;
+            }
+
+            _current = _activations.empty() ? &_outside : _activations.back().profile;
+        }
+
+        void Profiler::finish() {
+            if (_finished) {
+                return;
+            }
+
+            // Functions still running when execution stopped, e.g. due to
+            // an error, return now
+            while (!_activations.empty()) {
+                leave();
+            }
+
+            _end_ticks = charge_ticks();
+            _end_ns = read_nanoseconds();
+            _finished = true;
+        }
+
+        void Profiler::dump(std::ostream& os) const {
+            auto functions = sorted_functions();
+            auto opcodes = sorted_opcodes();
+            auto total_seconds = ticks_to_seconds(_end_ticks - _start_ticks);
+
+            os << "profile:" << std::endl
+               << "    instructions: " << _instruction_count << std::endl
+               << "    functions:    " << functions.size() << std::endl
+               << "    time:         " << std::fixed << std::setprecision(3)
+               << total_seconds * 1000.0 << "ms" << std::endl;
+
+            if (!functions.empty()) {
+                os << std::endl << std::left
+                   << std::setw(24) << "function"
+                   << std::setw(12) << "calls"
+                   << std::setw(16) << "incl. instrs"
+                   << std::setw(16) << "excl. instrs"
+                   << std::setw(14) << "incl. ms"
+                   << std::setw(14) << "excl. ms"
+                   << "excl. %" << std::endl;
+
+                for (auto profile : functions) {
+                    auto exclusive_seconds = ticks_to_seconds(profile->exclusive_ticks);
+
+                    os << std::setw(24) << function_name(*profile)
+                       << std::setw(12) << profile->calls
+                       << std::setw(16) << profile->inclusive_instructions
+                       << std::setw(16) << profile->exclusive_instructions
+                       << std::setw(14) << ticks_to_seconds(profile->inclusive_ticks) * 1000.0
+                       << std::setw(14) << exclusive_seconds * 1000.0
+                       << std::setprecision(1)
+                       << (total_seconds > 0 ? 100.0 * exclusive_seconds / total_seconds : 0.0)
+                       << std::setprecision(3) << std::endl;
+                }
+            }
+
+            if (!opcodes.empty()) {
+                os << std::endl
+                   << std::setw(24) << "opcode"
+                   << std::setw(16) << "count"
+                   << "%" << std::endl
+                   << std::setprecision(1);
+
+                for (auto opcode : opcodes) {
+                    os << std::setw(24) << bytecode_to_string(opcode)
+                       << std::setw(16) << _opcode_counts[opcode]
+                       << 100.0 * _opcode_counts[opcode] / _instruction_count << std::endl;
+                }
+            }
+
+            os << std::right;
+        }
+
+        void Profiler::dump_json(std::ostream& os) const {
+            auto functions = sorted_functions();
+            auto opcodes = sorted_opcodes();
+
+            os << "{" << std::endl
+               << "  \"instructions\": " << _instruction_count << "," << std::endl
+               << "  \"seconds\": " << std::fixed << std::setprecision(9)
+               << ticks_to_seconds(_end_ticks - _start_ticks) << "," << std::endl
+               << "  \"functions\": [";
+
+            for (std::size_t idx = 0; idx < functions.size(); ++idx) {
+                auto profile = functions[idx];
+
+                os << (idx > 0 ? "," : "") << std::endl
+                   << "    {"
+                   << "\"name\": \"" << escape_json(function_name(*profile)) << "\", "
+                   << "\"calls\": " << profile->calls << ", "
+                   << "\"inclusive_instructions\": " << profile->inclusive_instructions << ", "
+                   << "\"exclusive_instructions\": " << profile->exclusive_instructions << ", "
+                   << "\"inclusive_seconds\": " << ticks_to_seconds(profile->inclusive_ticks) << ", "
+                   << "\"exclusive_seconds\": " << ticks_to_seconds(profile->exclusive_ticks)
+                   << "}";
+            }
+
+            os << std::endl << "  ]," << std::endl
+               << "  \"opcodes\": [";
+
+            for (std::size_t idx = 0; idx < opcodes.size(); ++idx) {
+                auto opcode = opcodes[idx];
+
+                os << (idx > 0 ? "," : "") << std::endl
+                   << "    {"
+                   << "\"opcode\": \"" << bytecode_to_string(opcode) << "\", "
+                   << "\"count\": " << _opcode_counts[opcode]
+                   << "}";
+            }
+
+            os << std::endl << "  ]" << std::endl
+               << "}" << std::endl;
+        }
+
+        std::uint64_t Profiler::charge_ticks() {
+            auto ticks = read_ticks();
+            _current->exclusive_ticks += ticks - _last_ticks;
+            _last_ticks = ticks;
+
+            return ticks;
+        }
+
+        double Profiler::ticks_to_seconds(std::uint64_t ticks) const {
+            auto elapsed_ticks = _end_ticks - _start_ticks;
+
+            if (elapsed_ticks == 0) {
+                return 0.0;
+            }
+
+            auto ns_per_tick = static_cast<double>(_end_ns - _start_ns) / elapsed_ticks;
+
+            return ticks * ns_per_tick / 1e9;
+        }
+
+        std::vector<const FunctionProfile*> Profiler::sorted_functions() const {
+            std::vector<const FunctionProfile*> functions;
+
+            for (auto& [func, profile] : _functions) {
+                functions.push_back(&profile);
+            }
+
+            std::sort(
+                functions.begin(),
+                functions.end(),
+                [](const FunctionProfile* profile1, const FunctionProfile* profile2) {
+                    return profile1->exclusive_ticks > profile2->exclusive_ticks;
+                }
+            );
+
+            return functions;
+        }
+
+        std::vector<Bytecode> Profiler::sorted_opcodes() const {
+            std::vector<Bytecode> opcodes;
+
+            for (std::size_t opcode = 0; opcode < opcode_count; ++opcode) {
+                if (_opcode_counts[opcode] > 0) {
+                    opcodes.push_back(static_cast<Bytecode>(opcode));
+                }
+            }
+
+            std::sort(
+                opcodes.begin(),
+                opcodes.end(),
+                [this](Bytecode opcode1, Bytecode opcode2) {
+                    return _opcode_counts[opcode1] > _opcode_counts[opcode2];
+                }
+            );
+
+            return opcodes;
+        }
+    }
+}
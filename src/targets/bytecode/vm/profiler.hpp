@@ -0,0 +1,107 @@
+#ifndef KORE_PROFILER_HPP
+#define KORE_PROFILER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "targets/bytecode/codegen/bytecode.hpp"
+
+namespace kore {
+    class CompiledObject;
+
+    namespace vm {
+        /// Instruction counts and time spent in a function. Inclusive counts
+        /// include the functions it calls while exclusive counts do not
+        struct FunctionProfile {
+            const CompiledObject* func = nullptr;
+            std::uint64_t calls = 0;
+            std::uint64_t inclusive_instructions = 0;
+            std::uint64_t exclusive_instructions = 0;
+            std::uint64_t inclusive_ticks = 0;
+            std::uint64_t exclusive_ticks = 0;
+
+            // Number of activations on the call stack. Inclusive counts are
+            // only added when the outermost activation of a recursive
+            // function returns so they are not counted more than once
+            int active = 0;
+        };
+
+        /// Execution profiler of the vm. Counts every interpreted
+        /// instruction by opcode and by function and times functions
+        /// between calls and returns. Only used by the vm when compiled
+        /// with KORE_VM_PROFILER
+        class Profiler final {
+            public:
+                Profiler();
+
+                /// Count an instruction executed by the running function
+                inline void count_instruction(Bytecode opcode) {
+                    ++_opcode_counts[opcode];
+                    ++_instruction_count;
+                    ++_current->exclusive_instructions;
+                }
+
+                /// Start a call to a function
+                void enter(const CompiledObject* func);
+
+                /// Return from the running function
+                void leave();
+
+                /// Return from all running functions and stop the clock
+                void finish();
+
+                /// Write the profile as sorted tables
+                void dump(std::ostream& os) const;
+
+                /// Write the profile as JSON
+                void dump_json(std::ostream& os) const;
+
+            private:
+                static constexpr std::size_t opcode_count = Bytecode::CallGeneric + 1;
+
+                struct Activation {
+                    FunctionProfile* profile;
+                    std::uint64_t start_ticks;
+                    std::uint64_t start_instructions;
+                };
+
+                std::array<std::uint64_t, opcode_count> _opcode_counts{};
+                std::uint64_t _instruction_count = 0;
+                std::unordered_map<const CompiledObject*, FunctionProfile> _functions;
+                std::vector<Activation> _activations;
+
+                // Charged with instructions executed outside of any function
+                FunctionProfile _outside;
+                FunctionProfile* _current = &_outside;
+
+                // Ticks are read at every call and return. They are
+                // converted to seconds using the wall time elapsed over the
+                // whole profile
+                std::uint64_t _last_ticks = 0;
+                std::uint64_t _start_ticks = 0;
+                std::uint64_t _end_ticks = 0;
+                std::uint64_t _start_ns = 0;
+                std::uint64_t _end_ns = 0;
+                bool _finished = false;
+
+            private:
+                /// Charge the ticks since the last call or return to the
+                /// running function and get the current ticks
+                std::uint64_t charge_ticks();
+
+                double ticks_to_seconds(std::uint64_t ticks) const;
+
+                /// Profiled functions sorted by exclusive time
+                std::vector<const FunctionProfile*> sorted_functions() const;
+
+                /// Executed opcodes sorted by count
+                std::vector<Bytecode> sorted_opcodes() const;
+        };
+    }
+}
+
+#endif // KORE_PROFILER_HPP
@@ -0,0 +1,154 @@
+#include "targets/bytecode/vm/register_stack.hpp"
+
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace kore {
+    namespace vm {
+        RegisterStack* RegisterStack::_stacks = nullptr;
+
+        struct sigaction _previous_fault_action;
+
+        std::size_t round_to_pages(std::size_t size, std::size_t page_size) {
+            return (size + page_size - 1) / page_size * page_size;
+        }
+
+        RegisterStack::RegisterStack(std::size_t size, std::size_t call_frame_count) {
+            auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            auto stack_size = round_to_pages(size * sizeof(RegisterValue), page_size);
+            auto call_frames_size = round_to_pages(
+                call_frame_count * sizeof(CallFrame),
+                page_size
+            );
+
+            // A callee's register window can start up to KORE_VM_MAX_REGISTERS
+            // beyond its caller's frame pointer and extend another
+            // KORE_VM_MAX_REGISTERS beyond that so the guard region must
+            // cover both
+            auto guard_size = round_to_pages(
+                2 * KORE_VM_MAX_REGISTERS * sizeof(RegisterValue),
+                page_size
+            );
+
+            // Layout: registers, guard, call frames, guard
+            _mapping_size = stack_size + guard_size + call_frames_size + page_size;
+            _mapping = mmap(
+                nullptr,
+                _mapping_size,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                -1,
+                0
+            );
+
+            if (_mapping == MAP_FAILED) {
+                throw std::runtime_error("Failed to reserve register stack");
+            }
+
+            _guard_start = static_cast<const char*>(_mapping) + stack_size;
+            _guard_end = _guard_start + guard_size;
+            _call_frame_guard_start = _guard_end + call_frames_size;
+            _call_frame_guard_end = _call_frame_guard_start + page_size;
+
+            if (mprotect(const_cast<char*>(_guard_start), guard_size, PROT_NONE) != 0
+                || mprotect(const_cast<char*>(_call_frame_guard_start), page_size, PROT_NONE) != 0) {
+                munmap(_mapping, _mapping_size);
+                throw std::runtime_error("Failed to protect register stack guard region");
+            }
+
+            // Anonymous mappings are zero-filled which is a valid (false)
+            // boolean value for both tagged and untagged registers
+            _registers = static_cast<RegisterValue*>(_mapping);
+            _size = stack_size / sizeof(RegisterValue);
+
+            _call_frames = reinterpret_cast<CallFrame*>(const_cast<char*>(_guard_end));
+            _call_frame_capacity = call_frames_size / sizeof(CallFrame);
+
+            install_fault_handler();
+            link();
+        }
+
+        RegisterStack::~RegisterStack() {
+            unlink();
+            munmap(_mapping, _mapping_size);
+        }
+
+        std::size_t RegisterStack::size() const noexcept {
+            return _size;
+        }
+
+        CallFrame* RegisterStack::call_frames() const noexcept {
+            return _call_frames;
+        }
+
+        std::size_t RegisterStack::call_frame_capacity() const noexcept {
+            return _call_frame_capacity;
+        }
+
+        void RegisterStack::set_overflow_handler(sigjmp_buf* buffer) noexcept {
+            _overflow_handler = buffer;
+        }
+
+        void RegisterStack::install_fault_handler() {
+            static std::once_flag installed;
+
+            std::call_once(installed, []() {
+                struct sigaction action = {};
+
+                action.sa_sigaction = handle_fault;
+                action.sa_flags = SA_SIGINFO;
+                sigemptyset(&action.sa_mask);
+
+                sigaction(SIGSEGV, &action, &_previous_fault_action);
+            });
+        }
+
+        void RegisterStack::handle_fault(int signal, siginfo_t* info, void* context) {
+            auto address = static_cast<const char*>(info->si_addr);
+
+            for (auto stack = _stacks; stack; stack = stack->_next) {
+                if (stack->in_guard_region(address)) {
+                    auto handler = stack->_overflow_handler;
+
+                    if (handler) {
+                        siglongjmp(*handler, 1);
+                    }
+
+                    break;
+                }
+            }
+
+            // Not a register stack overflow (or nobody is handling it) so
+            // defer to the previous handler or crash as usual
+            if (_previous_fault_action.sa_flags & SA_SIGINFO) {
+                _previous_fault_action.sa_sigaction(signal, info, context);
+            } else if (_previous_fault_action.sa_handler != SIG_IGN
+                && _previous_fault_action.sa_handler != SIG_DFL) {
+                _previous_fault_action.sa_handler(signal);
+            } else {
+                ::signal(SIGSEGV, SIG_DFL);
+            }
+        }
+
+        bool RegisterStack::in_guard_region(const char* address) const noexcept {
+            return (address >= _guard_start && address < _guard_end)
+                || (address >= _call_frame_guard_start && address < _call_frame_guard_end);
+        }
+
+        void RegisterStack::link() {
+            _next = _stacks;
+            _stacks = this;
+        }
+
+        void RegisterStack::unlink() {
+            for (auto stack = &_stacks; *stack; stack = &(*stack)->_next) {
+                if (*stack == this) {
+                    *stack = _next;
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef KORE_REGISTER_STACK_HPP
+#define KORE_REGISTER_STACK_HPP
+
+#include "targets/bytecode/vm/call_frame.hpp"
+#include "targets/bytecode/vm/config.hpp"
+#include "targets/bytecode/vm/register_value.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+
+#include <csetjmp>
+#include <csignal>
+#include <cstddef>
+
+namespace kore {
+    namespace vm {
+        /// The vm's register stack and the call frame stack stored next to
+        /// it. A large region is reserved up front for each but only
+        /// committed by the operating system as it is touched so deep
+        /// recursion does not require large static arrays.
+        ///
+        /// Each region is followed by an inaccessible guard region larger
+        /// than the register window of any function or a call frame so
+        /// overflowing either stack faults instead of requiring a bounds
+        /// check on every call
+        class RegisterStack final {
+            public:
+                RegisterStack(
+                    std::size_t size = KORE_VM_REGISTER_STACK_SIZE,
+                    std::size_t call_frame_count = KORE_VM_CALLSTACK_SIZE
+                );
+                RegisterStack(const RegisterStack&) = delete;
+                RegisterStack& operator=(const RegisterStack&) = delete;
+                ~RegisterStack();
+
+                inline RegisterValue& operator[](std::size_t idx) {
+                    return _registers[idx];
+                }
+
+                inline const RegisterValue& operator[](std::size_t idx) const {
+                    return _registers[idx];
+                }
+
+                /// The number of registers that can be used before overflowing
+                std::size_t size() const noexcept;
+
+                /// The bottom of the call frame stack
+                CallFrame* call_frames() const noexcept;
+
+                /// The number of call frames that can be pushed before overflowing
+                std::size_t call_frame_capacity() const noexcept;
+
+                /// Jump to a buffer set by sigsetjmp when the guard region is
+                /// touched. Pass a nullptr to remove it again. Without an
+                /// overflow handler, touching the guard region crashes
+                void set_overflow_handler(sigjmp_buf* buffer) noexcept;
+
+            private:
+                // Start and size of the whole mapping including the guard region
+                void* _mapping;
+                std::size_t _mapping_size;
+
+                RegisterValue* _registers;
+                std::size_t _size;
+
+                CallFrame* _call_frames;
+                std::size_t _call_frame_capacity;
+
+                const char* _guard_start;
+                const char* _guard_end;
+                const char* _call_frame_guard_start;
+                const char* _call_frame_guard_end;
+
+                sigjmp_buf* volatile _overflow_handler = nullptr;
+
+                // Register stacks are kept in a list so the fault handler can
+                // find the stack whose guard region was touched
+                RegisterStack* _next = nullptr;
+                static RegisterStack* _stacks;
+
+            private:
+                static void install_fault_handler();
+                static void handle_fault(int signal, siginfo_t* info, void* context);
+
+                bool in_guard_region(const char* address) const noexcept;
+
+                void link();
+                void unlink();
+        };
+    }
+}
+
+#endif // KORE_REGISTER_STACK_HPP
@@ -0,0 +1,153 @@
+#include "targets/bytecode/compiled_object.hpp"
+#include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "targets/bytecode/vm/register_value.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+#include "types/type.hpp"
+
+#include <iomanip>
+
+namespace kore {
+    namespace vm {
+        RawValue RawValue::allocate_array(std::size_t size) {
+            RawValue raw;
+
+            // TODO: Handle allocation failure
+            raw._array = ArrayValue::allocate(size);
+
+            return raw;
+        }
+
+        RawValue RawValue::allocate_array(std::size_t size, ArrayElementType element_type) {
+            RawValue raw;
+
+            // TODO: Handle allocation failure
+            raw._array = ArrayValue::allocate(size, element_type);
+
+            return raw;
+        }
+
+        RawValue RawValue::from_array(ArrayValue* array) {
+            RawValue raw;
+            raw._array = array;
+            return raw;
+        }
+
+        RawValue RawValue::from_function_index(int func_index) {
+            RawValue raw;
+            raw._function = func_index;
+            return raw;
+        }
+
+        RawValue RawValue::from_builtin_index(int builtin_index) {
+            RawValue raw;
+            raw._function = ~static_cast<i64>(builtin_index);
+            return raw;
+        }
+
+        RawValue RawValue::from_value(const Value& value) {
+            switch (value.tag) {
+                case ValueTag::Bool:
+                    return from_bool(value.value._bool);
+
+                case ValueTag::I32:
+                    return from_i32(value.value._i32);
+
+                case ValueTag::I64:
+                    return from_i64(value.value._i64);
+
+                case ValueTag::F32:
+                    return from_f32(value.value._f32);
+
+                case ValueTag::F64:
+                    return from_f64(value.value._f64);
+
+                case ValueTag::Array: {
+                    RawValue raw;
+                    raw._array = value.value._array;
+                    return raw;
+                }
+
+                case ValueTag::FunctionValue: {
+                    auto function_value = value.value._function_value;
+
+                    if (function_value.type == FunctionValueType::Builtin) {
+                        return from_builtin_index(function_value.builtin->index);
+                    }
+
+                    return from_function_index(function_value.func->func_index());
+                }
+            }
+
+            return from_i64(0);
+        }
+
+        Value RawValue::to_value(ValueTag tag) const {
+            switch (tag) {
+                case ValueTag::Bool:
+                    return Value::from_bool(_bool);
+
+                case ValueTag::I32:
+                    return Value::from_i32(_i32);
+
+                case ValueTag::I64:
+                    return Value::from_i64(_i64);
+
+                case ValueTag::F32:
+                    return Value::from_f32(_f32);
+
+                case ValueTag::F64:
+                    return Value::from_f64(_f64);
+
+                case ValueTag::Array:
+                case ValueTag::FunctionValue:
+                    break;
+            }
+
+            throw std::runtime_error("Only value types can be tagged");
+        }
+
+        bool get_value_tag(const Type* type, ValueTag& tag) {
+            switch (type->category()) {
+                case TypeCategory::Bool:
+                    tag = ValueTag::Bool;
+                    return true;
+
+                case TypeCategory::Integer32:
+                    tag = ValueTag::I32;
+                    return true;
+
+                case TypeCategory::Integer64:
+                    tag = ValueTag::I64;
+                    return true;
+
+                case TypeCategory::Float32:
+                    tag = ValueTag::F32;
+                    return true;
+
+                case TypeCategory::Float64:
+                    tag = ValueTag::F64;
+                    return true;
+
+                default:
+                    return false;
+            }
+        }
+
+        bool operator==(const RawValue& value1, const RawValue& value2) {
+            return value1._i64 == value2._i64;
+        }
+
+        std::ostream& operator<<(std::ostream& out, const RawValue& value) {
+            // Without a tag we can only show the raw bits
+            auto flags = out.flags();
+
+            out << "<raw 0x" << std::hex << std::right << std::setw(16) << std::setfill('0')
+                << static_cast<std::uint64_t>(value._i64) << ">";
+
+            out.flags(flags);
+            out << std::setfill(' ');
+
+            return out;
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef KORE_REGISTER_VALUE_HPP
+#define KORE_REGISTER_VALUE_HPP
+
+#include "internal_value_types.hpp"
+
+#include <ostream>
+
+namespace kore {
+    class Type;
+
+    namespace vm {
+        class ArrayValue;
+        struct Value;
+        enum class ValueTag : std::uint8_t;
+        enum class ArrayElementType : std::uint8_t;
+
+        /// An untagged 8-byte register value. Kore is statically typed so
+        /// the compiler emits typed instructions (e.g. AddI32) and the type
+        /// of a register is implied by the instruction that reads it
+        union RawValue {
+            i64 _i64;
+            bool _bool;
+            i32 _i32;
+            f32 _f32;
+            f64 _f64;
+            ArrayValue* _array;
+
+            // Index of an ordinary function or the bitwise complement of
+            // the index of a builtin function
+            i64 _function;
+
+            inline bool as_bool() const { return _bool; }
+            inline i32 as_i32() const { return _i32; }
+            inline i64 as_i64() const { return _i64; }
+            inline f32 as_f32() const { return _f32; }
+            inline f64 as_f64() const { return _f64; }
+            inline ArrayValue* as_array() const { return _array; }
+
+            inline bool is_builtin_function() const { return _function < 0; }
+            inline int as_function_index() const { return _function; }
+            inline int as_builtin_index() const { return ~_function; }
+
+            static inline RawValue from_bool(bool value) {
+                RawValue raw{};
+                raw._bool = value;
+                return raw;
+            }
+
+            static inline RawValue from_i32(i32 value) {
+                RawValue raw{};
+                raw._i32 = value;
+                return raw;
+            }
+
+            static inline RawValue from_i64(i64 value) {
+                RawValue raw;
+                raw._i64 = value;
+                return raw;
+            }
+
+            static inline RawValue from_f32(f32 value) {
+                RawValue raw{};
+                raw._f32 = value;
+                return raw;
+            }
+
+            static inline RawValue from_f64(f64 value) {
+                RawValue raw;
+                raw._f64 = value;
+                return raw;
+            }
+
+            static RawValue allocate_array(std::size_t size);
+            static RawValue allocate_array(std::size_t size, ArrayElementType element_type);
+            static RawValue from_array(ArrayValue* array);
+            static RawValue from_function_index(int func_index);
+            static RawValue from_builtin_index(int builtin_index);
+
+            /// Strip the tag from a tagged value
+            static RawValue from_value(const Value& value);
+
+            /// Reattach a tag to the value, e.g. before passing it to a
+            /// builtin function. Only value types can be tagged
+            Value to_value(ValueTag tag) const;
+        };
+
+        static_assert(sizeof(RawValue) == 8, "Raw values must be 8 bytes");
+
+        /// Get the tag for values of a type or return false if the type
+        /// is not a value type
+        bool get_value_tag(const Type* type, ValueTag& tag);
+
+        bool operator==(const RawValue& value1, const RawValue& value2);
+
+        std::ostream& operator<<(std::ostream& out, const RawValue& value);
+
+        // The type of the vm's registers, globals and array elements. When
+        // compiled with KORE_VM_UNTAGGED_REGISTERS, tags are only kept where
+        // the runtime needs them, i.e. when calling builtin functions
+        #ifdef KORE_VM_UNTAGGED_REGISTERS
+            using RegisterValue = RawValue;
+        #else
+            using RegisterValue = Value;
+        #endif
+    }
+}
+
+#endif // KORE_REGISTER_VALUE_HPP
@@ -0,0 +1,126 @@
+#include "targets/bytecode/vm/sampling_profiler.hpp"
+#include "targets/bytecode/compiled_object.hpp"
+#include "utils/unused_parameter.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/time.h>
+
+namespace kore {
+    namespace vm {
+        volatile std::sig_atomic_t SamplingProfiler::_sample_requested = 0;
+
+        SamplingProfiler::SamplingProfiler(std::uint32_t frequency, bool include_pcs)
+            : _frequency(frequency),
+              _include_pcs(include_pcs) {
+        }
+
+        SamplingProfiler::~SamplingProfiler() {
+            stop();
+        }
+
+        void SamplingProfiler::start() {
+            if (_running) {
+                return;
+            }
+
+            struct sigaction action;
+            std::memset(&action, 0, sizeof(action));
+            action.sa_handler = handle_signal;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+
+            if (sigaction(SIGPROF, &action, &_old_action) != 0) {
+                throw std::runtime_error(
+                    std::string("Failed to install profiling signal handler: ") + std::strerror(errno)
+                );
+            }
+
+            auto interval = 1000000 / _frequency;
+            itimerval timer;
+            timer.it_interval.tv_sec = interval / 1000000;
+            timer.it_interval.tv_usec = interval % 1000000;
+            timer.it_value = timer.it_interval;
+
+            if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+                sigaction(SIGPROF, &_old_action, nullptr);
+
+                throw std::runtime_error(
+                    std::string("Failed to start profiling timer: ") + std::strerror(errno)
+                );
+            }
+
+            _running = true;
+        }
+
+        void SamplingProfiler::stop() {
+            if (!_running) {
+                return;
+            }
+
+            itimerval timer;
+            std::memset(&timer, 0, sizeof(timer));
+            setitimer(ITIMER_PROF, &timer, nullptr);
+            sigaction(SIGPROF, &_old_action, nullptr);
+
+            _sample_requested = 0;
+            _running = false;
+        }
+
+        void SamplingProfiler::sample(
+            const CallFrame* bottom,
+            const CallFrame* top,
+            std::size_t pc
+        ) {
+            _sample_requested = 0;
+
+            if (bottom == top) {
+                return;
+            }
+
+            std::string stack;
+
+            for (auto frame = bottom; frame != top; ++frame) {
+                if (frame != bottom) {
+                    stack += ';';
+                }
+
+                stack += frame->func ? frame->func->name() : "<unknown>";
+
+                if (_include_pcs) {
+                    // A call frame saves the program counter of its caller
+                    // which is one past the calling instruction
+                    auto frame_pc = frame + 1 != top ? (frame + 1)->old_pc - 1 : pc;
+                    stack += ':' + std::to_string(frame_pc);
+
+                    if (frame->func) {
+                        auto location = frame->func->source_location(frame_pc);
+
+                        if (!location.is_unknown()) {
+                            stack += '(' + location.colon_format() + ')';
+                        }
+                    }
+                }
+            }
+
+            ++_folded_stacks[stack];
+            ++_sample_count;
+        }
+
+        std::uint64_t SamplingProfiler::sample_count() const {
+            return _sample_count;
+        }
+
+        void SamplingProfiler::dump_folded(std::ostream& os) const {
+            for (auto& [stack, count] : _folded_stacks) {
+                os << stack << " " << count << std::endl;
+            }
+        }
+
+        void SamplingProfiler::handle_signal(int signal) {
+            UNUSED_PARAM(signal);
+            _sample_requested = 1;
+        }
+    }
+}
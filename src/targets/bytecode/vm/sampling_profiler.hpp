@@ -0,0 +1,74 @@
+#ifndef KORE_SAMPLING_PROFILER_HPP
+#define KORE_SAMPLING_PROFILER_HPP
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "targets/bytecode/vm/call_frame.hpp"
+
+namespace kore {
+    namespace vm {
+        /// Sampling profiler of the vm. A SIGPROF timer requests a sample at
+        /// a fixed frequency of cpu time and the vm takes it the next time it
+        /// calls a function or jumps backwards by recording the functions on
+        /// its call stack. Samples are aggregated into folded stacks as read
+        /// by flame graph tools
+        class SamplingProfiler final {
+            public:
+                /// Include the program counter of each call frame and its
+                /// source location if known in the folded stacks if
+                /// include_pcs is true
+                SamplingProfiler(std::uint32_t frequency, bool include_pcs);
+                ~SamplingProfiler();
+
+                SamplingProfiler(const SamplingProfiler&) = delete;
+                SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+                /// Check if the timer requested a sample. Cheap enough to be
+                /// checked in the dispatch loop
+                static inline bool sample_requested() {
+                    return _sample_requested != 0;
+                }
+
+                /// Start the timer. Only one profiler can run at a time.
+                /// Throws a std::runtime_error if the timer could not be set
+                void start();
+
+                /// Stop the timer and restore the previous SIGPROF handler
+                void stop();
+
+                /// Record the functions of a call stack where pc is the
+                /// program counter of the top call frame, i.e. the next
+                /// instruction it executes
+                void sample(const CallFrame* bottom, const CallFrame* top, std::size_t pc);
+
+                /// Number of samples taken
+                std::uint64_t sample_count() const;
+
+                /// Write one line per distinct call stack with its functions
+                /// from the bottom up separated by semicolons followed by
+                /// the number of samples
+                void dump_folded(std::ostream& os) const;
+
+            private:
+                static volatile std::sig_atomic_t _sample_requested;
+
+                std::uint32_t _frequency;
+                bool _include_pcs;
+                bool _running = false;
+                struct sigaction _old_action;
+
+                std::uint64_t _sample_count = 0;
+                std::map<std::string, std::uint64_t> _folded_stacks;
+
+            private:
+                static void handle_signal(int signal);
+        };
+    }
+}
+
+#endif // KORE_SAMPLING_PROFILER_HPP
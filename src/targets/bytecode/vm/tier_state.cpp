@@ -0,0 +1,32 @@
+#include "targets/bytecode/vm/tier_state.hpp"
+
+namespace kore {
+    namespace vm {
+        std::string tier_to_string(Tier tier) {
+            switch (tier) {
+                case Tier::Baseline:
+                    return "baseline";
+
+                case Tier::Optimised:
+                    return "optimised";
+            }
+
+            return "unknown";
+        }
+
+        std::string tier_up_reason_to_string(TierUpReason reason) {
+            switch (reason) {
+                case TierUpReason::None:
+                    return "-";
+
+                case TierUpReason::Calls:
+                    return "calls";
+
+                case TierUpReason::BackwardJumps:
+                    return "backward jumps";
+            }
+
+            return "unknown";
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef KORE_TIER_STATE_HPP
+#define KORE_TIER_STATE_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace kore {
+    namespace x64 {
+        class NativeCode;
+    }
+
+    namespace vm {
+        /// Functions start out in the baseline tier where they are
+        /// interpreted as loaded and are re-optimised once they become hot
+        enum class Tier : std::uint8_t {
+            Baseline,
+            Optimised,
+        };
+
+        /// The counter that made a function cross the tier-up threshold
+        enum class TierUpReason : std::uint8_t {
+            None,
+            Calls,
+            BackwardJumps,
+        };
+
+        /// Hotness counters and the current code of a function. Kept next
+        /// to the compiled function and maintained by the vm while tiering
+        /// is enabled
+        struct TierState {
+            std::uint32_t calls = 0;
+            std::uint32_t backward_jumps = 0;
+            Tier tier = Tier::Baseline;
+            TierUpReason reason = TierUpReason::None;
+
+            // Native code compiled when tiering up, if any. It is swapped in
+            // with a single pointer store so each call either sees the old
+            // or the new code
+            const x64::NativeCode* native_code = nullptr;
+        };
+
+        std::string tier_to_string(Tier tier);
+        std::string tier_up_reason_to_string(TierUpReason reason);
+    }
+}
+
+#endif // KORE_TIER_STATE_HPP
@@ -4,32 +4,6 @@ namespace kore {
     namespace vm {
         Value::Value() : tag(ValueTag::Bool) {}
 
-        Value::~Value() {
-            switch (tag) {
-                case ValueTag::Bool:
-                case ValueTag::I32:
-                case ValueTag::I64:
-                case ValueTag::F32:
-                case ValueTag::F64:
-                case ValueTag::FunctionValue: {
-                    // TODO: Deallocate environment when we have closures
-                    // We don't allocate any memory for these values
-                    break;
-                }
-
-                case ValueTag::Array: {
-                    #if KORE_VM_DEBUG
-                        if (value._array == nullptr) {
-                            throw std::runtime_error("Array is not allocated");
-                        }
-                    #endif
-
-                    delete value._array;
-                    break;
-                }
-            }
-        }
-
         Value Value::from_bool(bool value) {
             auto _value = Value();
 
@@ -94,6 +68,25 @@ namespace kore {
             return _value;
         }
 
+        Value Value::allocate_array(std::size_t size, ArrayElementType element_type) {
+            auto _value = Value();
+
+            // TODO: Handle allocation failure
+            _value.tag = ValueTag::Array;
+            _value.value._array = ArrayValue::allocate(size, element_type);
+
+            return _value;
+        }
+
+        Value Value::from_array(ArrayValue* array) {
+            auto _value = Value();
+
+            _value.tag = ValueTag::Array;
+            _value.value._array = array;
+
+            return _value;
+        }
+
         Value Value::from_builtin_function(const BuiltinFunction* builtin) {
             auto _value = Value();
 
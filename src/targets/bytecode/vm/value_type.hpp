@@ -24,6 +24,9 @@ namespace kore {
 
         /// The types for the vm's runtime values implemented
         /// as a tagged union
+        ///
+        /// Values are copied freely between registers, globals and array
+        /// elements so a value does not own the array it points to
         struct Value {
             ValueTag tag;
 
@@ -40,8 +43,6 @@ namespace kore {
 
             Value();
 
-            ~Value();
-
             inline bool as_bool() const {
                 #if KORE_VM_DEBUG
                 if (tag != ValueTag::Bool) {
@@ -142,6 +143,8 @@ namespace kore {
             static Value from_f64(f64 value);
             /* static Value from_string(const std::string& str); */
             static Value allocate_array(std::size_t size);
+            static Value allocate_array(std::size_t size, ArrayElementType element_type);
+            static Value from_array(ArrayValue* array);
             static Value from_builtin_function(const BuiltinFunction* builtin);
             static Value from_function(const CompiledObject* const function);
         };
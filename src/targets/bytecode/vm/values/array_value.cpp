@@ -3,29 +3,109 @@
 
 namespace kore {
     namespace vm {
-        ArrayValue::ArrayValue() {}
+        std::string array_element_type_to_string(ArrayElementType element_type) {
+            switch (element_type) {
+                case ArrayElementType::Value: return "value";
+                case ArrayElementType::Bool:  return "bool";
+                case ArrayElementType::I32:   return "i32";
+                case ArrayElementType::I64:   return "i64";
+                case ArrayElementType::F32:   return "f32";
+                case ArrayElementType::F64:   return "f64";
+            }
+
+            return "unknown";
+        }
+
+        /// Get the number of 8-byte words needed for the elements of a
+        /// typed array
+        std::size_t word_count(ArrayElementType element_type, std::size_t size) {
+            switch (element_type) {
+                case ArrayElementType::Bool:
+                    return (size + 63) / 64;
 
-        ArrayValue::ArrayValue(std::size_t size) {
-            _values.resize(size);
+                case ArrayElementType::I32:
+                case ArrayElementType::F32:
+                    return (size + 1) / 2;
+
+                case ArrayElementType::I64:
+                case ArrayElementType::F64:
+                    return size;
+
+                case ArrayElementType::Value:
+                    break;
+            }
+
+            return 0;
+        }
+
+        ArrayValue::ArrayValue() : ArrayValue(0) {}
+
+        ArrayValue::ArrayValue(std::size_t size)
+            : ArrayValue(size, ArrayElementType::Value) {}
+
+        ArrayValue::ArrayValue(std::size_t size, ArrayElementType element_type)
+            : _element_type(element_type),
+              _size(size) {
+            if (element_type == ArrayElementType::Value) {
+                _values.resize(size);
+            } else {
+                _words.resize(word_count(element_type, size));
+            }
         }
 
         ArrayValue::~ArrayValue() {}
 
-        Value& ArrayValue::operator[](int index) {
+        ArrayElementType ArrayValue::element_type() const {
+            return _element_type;
+        }
+
+        bool ArrayValue::is_typed() const {
+            return _element_type != ArrayElementType::Value;
+        }
+
+        RegisterValue& ArrayValue::operator[](int index) {
             return _values[index];
         }
 
-        const Value& ArrayValue::operator[](int index) const {
+        const RegisterValue& ArrayValue::operator[](int index) const {
             return _values[index];
         }
 
         bool ArrayValue::operator==(const ArrayValue& other) {
-            if (size() == other.size()) {
+            if (_element_type != other._element_type || size() != other.size()) {
                 return false;
             }
 
             for (std::size_t idx = 0; idx < size(); ++idx) {
-                if (!((*this)[idx] == other[idx])) {
+                bool equal = true;
+
+                switch (_element_type) {
+                    case ArrayElementType::Value:
+                        equal = (*this)[idx] == other[idx];
+                        break;
+
+                    case ArrayElementType::Bool:
+                        equal = get_bool(idx) == other.get_bool(idx);
+                        break;
+
+                    case ArrayElementType::I32:
+                        equal = data<i32>()[idx] == other.data<i32>()[idx];
+                        break;
+
+                    case ArrayElementType::I64:
+                        equal = data<i64>()[idx] == other.data<i64>()[idx];
+                        break;
+
+                    case ArrayElementType::F32:
+                        equal = data<f32>()[idx] == other.data<f32>()[idx];
+                        break;
+
+                    case ArrayElementType::F64:
+                        equal = data<f64>()[idx] == other.data<f64>()[idx];
+                        break;
+                }
+
+                if (!equal) {
                     return false;
                 }
             }
@@ -33,34 +113,108 @@ namespace kore {
             return true;
         }
 
-        std::vector<Value>::size_type ArrayValue::size() const {
-            return _values.size();
+        std::size_t ArrayValue::size() const {
+            return _size;
+        }
+
+        std::size_t ArrayValue::element_bytes() const {
+            return _values.size() * sizeof(RegisterValue)
+                + _words.size() * sizeof(std::uint64_t);
         }
 
         void ArrayValue::clear() {
             _values.clear();
+            _words.clear();
+            _size = 0;
+        }
+
+        std::size_t ArrayValue::heap_size() const {
+            return sizeof(ArrayValue) + element_bytes();
+        }
+
+        void ArrayValue::trace(Heap& heap) {
+            for (auto& value : _values) {
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                // Untagged elements may be arrays or other values
+                heap.mark_candidate(value.as_array());
+#else
+                if (value.tag == ValueTag::Array) {
+                    heap.mark(value.value._array);
+                }
+#endif
+            }
+        }
+
+        std::uint32_t ArrayValue::ref_count() const {
+            return _ref_count;
+        }
+
+        void ArrayValue::release(ArrayValue* array) {
+            if (--array->_ref_count == 0) {
+                destroy(array);
+            }
+        }
+
+        void ArrayValue::destroy(ArrayValue* array) {
+#ifndef KORE_VM_UNTAGGED_REGISTERS
+            // Arrays of register values may hold references to other arrays.
+            // Untagged elements cannot tell arrays from other values so
+            // nested arrays are only released when values are tagged
+            for (auto& value : array->_values) {
+                if (value.tag == ValueTag::Array && value.value._array) {
+                    release(value.value._array);
+                }
+            }
+#endif
+
+            delete array;
         }
 
-        ArrayValue* ArrayValue::allocate(std::size_t size) {
-            ArrayValue* array = new ArrayValue();
+        ArrayValue* ArrayValue::allocate(std::size_t size, ArrayElementType element_type) {
+            ArrayValue* array = new ArrayValue(size, element_type);
 
             if (!array) {
                 throw std::runtime_error("Out of memory");
             }
 
-            array->_values.resize(size);
-
             return array;
         }
 
+        void ArrayValue::print_element(std::ostream& out, std::size_t index) const {
+            switch (_element_type) {
+                case ArrayElementType::Value:
+                    out << _values[index];
+                    break;
+
+                case ArrayElementType::Bool:
+                    out << Value::from_bool(get_bool(index));
+                    break;
+
+                case ArrayElementType::I32:
+                    out << Value::from_i32(data<i32>()[index]);
+                    break;
+
+                case ArrayElementType::I64:
+                    out << Value::from_i64(data<i64>()[index]);
+                    break;
+
+                case ArrayElementType::F32:
+                    out << Value::from_f32(data<f32>()[index]);
+                    break;
+
+                case ArrayElementType::F64:
+                    out << Value::from_f64(data<f64>()[index]);
+                    break;
+            }
+        }
+
         std::ostream& operator<<(std::ostream& out, const ArrayValue& value) {
             out << "[";
-            auto values = value._values;
 
-            for (std::size_t idx = 0; idx < values.size(); ++idx) {
-                out << values[idx];
+            for (std::size_t idx = 0; idx < value.size(); ++idx) {
+                value.print_element(out, idx);
 
-                if (idx < values.size() - 1) {
+                if (idx < value.size() - 1) {
                     out << ", ";
                 }
             }
@@ -1,14 +1,41 @@
 #ifndef KORE_ARRAY_VALUE_HPP
 #define KORE_ARRAY_VALUE_HPP
 
+#include "targets/bytecode/vm/heap.hpp"
+#include "targets/bytecode/vm/register_value.hpp"
+
+#include <atomic>
+#include <cstdint>
 #include <ostream>
+#include <string>
 #include <vector>
 
 namespace kore {
     namespace vm {
-        struct Value;
+        /// How the elements of an array are stored. Arrays of a primitive
+        /// element type store their elements unboxed and packed, except bool
+        /// arrays which store one bit per element. Other arrays store a full
+        /// register value per element
+        enum class ArrayElementType : std::uint8_t {
+            Value = 0,
+            Bool,
+            I32,
+            I64,
+            F32,
+            F64,
+        };
+
+        std::string array_element_type_to_string(ArrayElementType element_type);
 
-        class ArrayValue final {
+        // The vm runs on a single thread so reference counts are not atomic
+        // unless heap values are shared between threads
+        #ifdef KORE_VM_ATOMIC_REF_COUNTS
+            using RefCount = std::atomic<std::uint32_t>;
+        #else
+            using RefCount = std::uint32_t;
+        #endif
+
+        class ArrayValue final : public HeapObject {
             public:
                 friend std::ostream& operator<<(
                     std::ostream& out,
@@ -18,18 +45,84 @@ namespace kore {
             public:
                 ArrayValue();
                 ArrayValue(std::size_t size);
-                ~ArrayValue();
+                ArrayValue(std::size_t size, ArrayElementType element_type);
+                ~ArrayValue() override;
+
+                ArrayElementType element_type() const;
+                bool is_typed() const;
+
+                /// Access an element of an array of register values
+                RegisterValue& operator[](int index);
+                const RegisterValue& operator[](int index) const;
+
+                /// Get the elements of an i32, i64, f32 or f64 array
+                template<typename T>
+                inline T* data() {
+                    return reinterpret_cast<T*>(_words.data());
+                }
+
+                template<typename T>
+                inline const T* data() const {
+                    return reinterpret_cast<const T*>(_words.data());
+                }
+
+                /// Access an element of a bool array
+                inline bool get_bool(std::size_t index) const {
+                    return (_words[index / 64] >> (index % 64)) & 1;
+                }
+
+                inline void set_bool(std::size_t index, bool value) {
+                    auto mask = std::uint64_t(1) << (index % 64);
+                    auto& word = _words[index / 64];
+
+                    word = value ? word | mask : word & ~mask;
+                }
 
-                Value& operator[](int index);
-                const Value& operator[](int index) const;
                 bool operator==(const ArrayValue& other);
-                std::vector<Value>::size_type size() const;
+                std::size_t size() const;
+
+                /// Number of bytes used to store the elements
+                std::size_t element_bytes() const;
+
                 void clear();
 
-                static ArrayValue* allocate(std::size_t size);
+                std::size_t heap_size() const override;
+
+                /// Mark the arrays held by an array of register values
+                void trace(Heap& heap) override;
+
+                /// Arrays are reference counted and start out with a single
+                /// reference owned by the register they are allocated into
+                std::uint32_t ref_count() const;
+
+                inline void retain() {
+                    ++_ref_count;
+                }
+
+                /// Drop a reference and destroy the array if it was the last
+                static void release(ArrayValue* array);
+
+                /// Destroy an array regardless of its reference count. Only
+                /// used for arrays known to have a single reference
+                static void destroy(ArrayValue* array);
+
+                static ArrayValue* allocate(
+                    std::size_t size,
+                    ArrayElementType element_type = ArrayElementType::Value
+                );
+
+            private:
+                ArrayElementType _element_type;
+                RefCount _ref_count = 1;
+                std::size_t _size;
+                std::vector<RegisterValue> _values;
+
+                // Elements of typed arrays in 8-byte words so they are
+                // aligned for every element type
+                std::vector<std::uint64_t> _words;
 
             private:
-                std::vector<Value> _values;
+                void print_element(std::ostream& out, std::size_t index) const;
         };
 
         std::ostream& operator<<(std::ostream& out, const ArrayValue& value);
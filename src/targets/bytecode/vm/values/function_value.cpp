@@ -8,7 +8,7 @@ namespace kore {
             switch (value.type) {
                 case FunctionValueType::Builtin: {
                     return os << "<builtin "
-                        << std::quoted(value.builtin->name.c_str(), '\'')
+                        << std::quoted(value.builtin->name, '\'')
                         << ">";
                 }
 
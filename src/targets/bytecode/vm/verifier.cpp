@@ -0,0 +1,575 @@
+#include <limits>
+
+#include "targets/bytecode/compiled_object.hpp"
+#include "targets/bytecode/module.hpp"
+#include "targets/bytecode/module_load_error.hpp"
+#include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "targets/bytecode/vm/verifier.hpp"
+
+namespace kore {
+    namespace vm {
+        static constexpr std::uint16_t TYPE_BOOL = 1 << 0;
+        static constexpr std::uint16_t TYPE_I32 = 1 << 1;
+        static constexpr std::uint16_t TYPE_I64 = 1 << 2;
+        static constexpr std::uint16_t TYPE_F32 = 1 << 3;
+        static constexpr std::uint16_t TYPE_F64 = 1 << 4;
+        static constexpr std::uint16_t TYPE_ARRAY = 1 << 5;
+        static constexpr std::uint16_t TYPE_FUNCTION = 1 << 6;
+
+        // Arrays that store their elements unboxed
+        static constexpr std::uint16_t TYPE_BOOL_ARRAY = 1 << 7;
+        static constexpr std::uint16_t TYPE_I32_ARRAY = 1 << 8;
+        static constexpr std::uint16_t TYPE_I64_ARRAY = 1 << 9;
+        static constexpr std::uint16_t TYPE_F32_ARRAY = 1 << 10;
+        static constexpr std::uint16_t TYPE_F64_ARRAY = 1 << 11;
+
+        static constexpr std::uint16_t TYPE_ANY_ARRAY = TYPE_ARRAY
+            | TYPE_BOOL_ARRAY
+            | TYPE_I32_ARRAY
+            | TYPE_I64_ARRAY
+            | TYPE_F32_ARRAY
+            | TYPE_F64_ARRAY;
+
+        // Anything, e.g. a parameter, a global or the result of a call to an
+        // ordinary function
+        static constexpr std::uint16_t TYPE_UNKNOWN = 1 << 12;
+
+        static constexpr int NO_CALLEE = std::numeric_limits<int>::min();
+
+        std::string type_set_to_string(std::uint16_t types) {
+            static const std::pair<std::uint16_t, const char*> names[] = {
+                { TYPE_BOOL,     "bool" },
+                { TYPE_I32,      "i32" },
+                { TYPE_I64,      "i64" },
+                { TYPE_F32,      "f32" },
+                { TYPE_F64,      "f64" },
+                { TYPE_ARRAY,    "array" },
+                { TYPE_FUNCTION, "function" },
+                { TYPE_BOOL_ARRAY, "bool array" },
+                { TYPE_I32_ARRAY,  "i32 array" },
+                { TYPE_I64_ARRAY,  "i64 array" },
+                { TYPE_F32_ARRAY,  "f32 array" },
+                { TYPE_F64_ARRAY,  "f64 array" },
+                { TYPE_UNKNOWN,  "unknown" },
+            };
+
+            std::string result;
+
+            for (auto& [type, name] : names) {
+                if (types & type) {
+                    result += (result.empty() ? "" : " or ") + std::string(name);
+                }
+            }
+
+            return result;
+        }
+
+        std::uint16_t value_tag_to_type(ValueTag tag) {
+            switch (tag) {
+                case ValueTag::Bool:          return TYPE_BOOL;
+                case ValueTag::I32:           return TYPE_I32;
+                case ValueTag::I64:           return TYPE_I64;
+                case ValueTag::F32:           return TYPE_F32;
+                case ValueTag::F64:           return TYPE_F64;
+                case ValueTag::Array:         return TYPE_ARRAY;
+                case ValueTag::FunctionValue: return TYPE_FUNCTION;
+            }
+
+            return TYPE_UNKNOWN;
+        }
+
+        std::uint16_t type_category_to_type(TypeCategory category) {
+            switch (category) {
+                case TypeCategory::Bool:      return TYPE_BOOL;
+                case TypeCategory::Integer32: return TYPE_I32;
+                case TypeCategory::Integer64: return TYPE_I64;
+                case TypeCategory::Float32:   return TYPE_F32;
+                case TypeCategory::Float64:   return TYPE_F64;
+
+                // Array parameters of builtin functions are arrays of f64
+                case TypeCategory::Array:     return TYPE_F64_ARRAY;
+                default:                      return TYPE_UNKNOWN;
+            }
+        }
+
+        /// Get the operand type of a typed arithmetic or comparison opcode.
+        /// They come in groups of i32, i64, f32 and f64
+        std::uint16_t operand_type(Bytecode opcode) {
+            static const std::uint16_t types[] = { TYPE_I32, TYPE_I64, TYPE_F32, TYPE_F64 };
+
+            return types[(opcode - Bytecode::AddI32) % 4];
+        }
+
+        /// Get the element type of a typed array opcode. They come in
+        /// groups of bool, i32, i64, f32 and f64
+        std::uint16_t array_element_type(Bytecode opcode, Bytecode first_opcode) {
+            static const std::uint16_t types[] = { TYPE_BOOL, TYPE_I32, TYPE_I64, TYPE_F32, TYPE_F64 };
+
+            return types[opcode - first_opcode];
+        }
+
+        /// Get the array type of a typed array opcode
+        std::uint16_t typed_array_type(Bytecode opcode, Bytecode first_opcode) {
+            static const std::uint16_t types[] = {
+                TYPE_BOOL_ARRAY,
+                TYPE_I32_ARRAY,
+                TYPE_I64_ARRAY,
+                TYPE_F32_ARRAY,
+                TYPE_F64_ARRAY,
+            };
+
+            return types[opcode - first_opcode];
+        }
+
+        bool is_jump_opcode(Bytecode opcode) {
+            return opcode == Bytecode::Jump
+                || opcode == Bytecode::JumpIf
+                || opcode == Bytecode::JumpIfNot
+                || is_compare_and_branch_opcode(opcode);
+        }
+
+        Verifier::Verifier(const Module& module) : _module(module) {}
+
+        void Verifier::verify(const CompiledObject& func) {
+            _func = &func;
+            _pc = 0;
+
+            auto code = func.decoded_instructions();
+            std::size_t size = func.decoded_size();
+
+            if (size == 0) {
+                // The vm does not run a main function without instructions
+                if (func.is_main_object()) {
+                    return;
+                }
+
+                fail("function has no instructions");
+            }
+
+            // Blocks start at the first instruction, at jump targets and
+            // after jumps and returns
+            std::vector<bool> leaders(size, false);
+            leaders[0] = true;
+
+            // The compiled instruction of each decoded instruction for
+            // reading operands that were resolved when decoding
+            std::vector<const bytecode_type*> words(size);
+            auto word = func.instructions();
+
+            for (std::size_t pc = 0; pc < size; ++pc) {
+                auto opcode = code[pc].opcode;
+                words[pc] = word;
+                word += is_compare_and_branch_opcode(opcode) ? 2 : 1;
+
+                if (is_jump_opcode(opcode)) {
+                    leaders[code[pc].target] = true;
+                }
+
+                bool ends_block = is_jump_opcode(opcode)
+                    || opcode == Bytecode::Ret
+                    || opcode == Bytecode::TailCall;
+
+                if (ends_block && pc + 1 < size) {
+                    leaders[pc + 1] = true;
+                }
+            }
+
+            // The register types at the start of each block
+            std::vector<std::optional<State>> block_states(size);
+            std::vector<std::size_t> worklist{ 0 };
+
+            block_states[0] = State(func.reg_count(), RegisterState{ TYPE_UNKNOWN, NO_CALLEE });
+
+            auto add_successor = [&](std::size_t target, const State& state) {
+                if (join(block_states[target], state)) {
+                    worklist.push_back(target);
+                }
+            };
+
+            while (!worklist.empty()) {
+                auto pc = worklist.back();
+                auto state = *block_states[pc];
+                worklist.pop_back();
+
+                for (;; ++pc) {
+                    auto& instruction = code[pc];
+                    _pc = pc;
+
+                    transfer(state, instruction, words[pc]);
+
+                    if (instruction.opcode == Bytecode::Ret || instruction.opcode == Bytecode::TailCall) {
+                        break;
+                    }
+
+                    if (is_jump_opcode(instruction.opcode)) {
+                        add_successor(instruction.target, state);
+
+                        if (instruction.opcode == Bytecode::Jump) {
+                            break;
+                        }
+                    }
+
+                    if (pc + 1 >= size) {
+                        fail("control reaches the end of the function without returning");
+                    }
+
+                    if (leaders[pc + 1]) {
+                        add_successor(pc + 1, state);
+                        break;
+                    }
+                }
+            }
+
+            // The garbage collector reads the registers of the stack map
+            // without checking them
+            for (auto& entry : func.stack_map().entries()) {
+                _pc = entry.pc;
+
+                if (entry.pc >= size) {
+                    fail("stack map entry at " + std::to_string(entry.pc) + " is out of range");
+                }
+
+                for (auto reg : entry.registers) {
+                    check_register(reg);
+                }
+            }
+        }
+
+        void Verifier::fail(const std::string& message) const {
+            std::string location = "'" + _func->name() + "'";
+
+            if (_pc < static_cast<std::size_t>(_func->decoded_size())) {
+                auto opcode = _func->decoded_instructions()[_pc].opcode;
+
+                location += " at " + std::to_string(_pc) + " (" + bytecode_to_string(opcode) + ")";
+            }
+
+            throw ModuleLoadError("Verification of " + location + " failed: " + message);
+        }
+
+        void Verifier::check_register(int reg) const {
+            if (reg >= _func->reg_count()) {
+                fail(
+                    "register @" + std::to_string(reg) + " is out of range ("
+                    + std::to_string(_func->reg_count()) + " registers)"
+                );
+            }
+        }
+
+        void Verifier::check_register_range(int first_reg, int count) const {
+            if (first_reg + count > _func->reg_count()) {
+                fail(
+                    "registers @" + std::to_string(first_reg) + " to @"
+                    + std::to_string(first_reg + count - 1) + " are out of range ("
+                    + std::to_string(_func->reg_count()) + " registers)"
+                );
+            }
+        }
+
+        void Verifier::check_type(const State& state, int reg, TypeSet expected) const {
+            check_register(reg);
+
+            auto types = state[reg].types & ~TYPE_UNKNOWN;
+
+            if ((types & ~expected) == 0) {
+                return;
+            }
+
+            auto message = "register @" + std::to_string(reg) + " holds "
+                + type_set_to_string(types) + " but "
+                + type_set_to_string(expected) + " is expected";
+
+            if (types & expected) {
+                message += " along every path";
+            }
+
+            fail(message);
+        }
+
+        void Verifier::check_callee(const State& state, const DecodedInstruction& instruction) {
+            Reg base = instruction.reg2;
+            int arg_count = instruction.reg3;
+
+            check_type(state, instruction.reg1, TYPE_FUNCTION);
+            check_register_range(base, arg_count);
+
+            auto& callable = state[instruction.reg1];
+
+            if (callable.types != TYPE_FUNCTION || callable.callee == NO_CALLEE) {
+                return;
+            }
+
+            if (callable.callee < 0) {
+                auto builtin = get_builtin_function_by_index(~callable.callee);
+
+                if (arg_count != builtin->arity) {
+                    fail(
+                        std::string(builtin->name) + " takes "
+                        + std::to_string(builtin->arity) + " arguments but "
+                        + std::to_string(arg_count) + " are passed"
+                    );
+                }
+
+                for (int idx = 0; idx < arg_count; ++idx) {
+                    auto type = type_category_to_type(builtin->parameter_categories[idx]);
+
+                    if (type != TYPE_UNKNOWN) {
+                        check_type(state, base + idx, type);
+                    }
+                }
+
+                if (builtin->return_arity > 0) {
+                    check_register(base);
+                }
+            } else {
+                auto callee = _module.find_function(callable.callee);
+
+                // Parameters are the first registers of the callee
+                if (arg_count > callee->reg_count()) {
+                    fail(
+                        callee->name() + " has " + std::to_string(callee->reg_count())
+                        + " registers but " + std::to_string(arg_count)
+                        + " arguments are passed"
+                    );
+                }
+            }
+        }
+
+        void Verifier::set(State& state, int reg, TypeSet types, int callee) {
+            check_register(reg);
+            state[reg] = RegisterState{ types, callee };
+        }
+
+        void Verifier::transfer(
+            State& state,
+            const DecodedInstruction& instruction,
+            const bytecode_type* word
+        ) {
+            auto opcode = instruction.opcode;
+
+            switch (opcode) {
+                case Bytecode::Noop:
+                case Bytecode::Jump:
+                    break;
+
+                case Bytecode::Move:
+                    check_register(instruction.reg2);
+                    check_register(instruction.reg1);
+                    state[instruction.reg1] = state[instruction.reg2];
+                    break;
+
+                case Bytecode::Gload:
+                    if (instruction.reg2 >= _module.global_indices_count()) {
+                        fail("global " + std::to_string(instruction.reg2) + " is out of range");
+                    }
+
+                    set(state, instruction.reg1, TYPE_UNKNOWN, NO_CALLEE);
+                    break;
+
+                case Bytecode::Gstore:
+                    if (instruction.reg1 >= _module.global_indices_count()) {
+                        fail("global " + std::to_string(instruction.reg1) + " is out of range");
+                    }
+
+                    check_register(instruction.reg2);
+                    break;
+
+                case Bytecode::LoadBool:
+                    set(state, instruction.reg1, TYPE_BOOL, NO_CALLEE);
+                    break;
+
+                case Bytecode::Cload: {
+                    auto constant = _module.constant_table().get(GET_VALUE(*word));
+                    set(state, instruction.reg1, value_tag_to_type(constant.tag), NO_CALLEE);
+                    break;
+                }
+
+                case Bytecode::LoadBuiltin:
+                    if (instruction.value >= builtin_function_count()) {
+                        fail("builtin function " + std::to_string(instruction.value) + " does not exist");
+                    }
+
+                    set(state, instruction.reg1, TYPE_FUNCTION, ~instruction.value);
+                    break;
+
+                case Bytecode::LoadFunction:
+                    if (!_module.find_function(instruction.value)) {
+                        fail("function " + std::to_string(instruction.value) + " does not exist");
+                    }
+
+                    set(state, instruction.reg1, TYPE_FUNCTION, instruction.value);
+                    break;
+
+                case Bytecode::AddI32: case Bytecode::AddI64: case Bytecode::AddF32: case Bytecode::AddF64:
+                case Bytecode::SubI32: case Bytecode::SubI64: case Bytecode::SubF32: case Bytecode::SubF64:
+                case Bytecode::MultI32: case Bytecode::MultI64: case Bytecode::MultF32: case Bytecode::MultF64:
+                case Bytecode::DivI32: case Bytecode::DivI64: case Bytecode::DivF32: case Bytecode::DivF64: {
+                    auto type = operand_type(opcode);
+
+                    check_type(state, instruction.reg2, type);
+                    check_type(state, instruction.reg3, type);
+                    set(state, instruction.reg1, type, NO_CALLEE);
+                    break;
+                }
+
+                case Bytecode::LtI32: case Bytecode::LtI64: case Bytecode::LtF32: case Bytecode::LtF64:
+                case Bytecode::GtI32: case Bytecode::GtI64: case Bytecode::GtF32: case Bytecode::GtF64:
+                case Bytecode::LeI32: case Bytecode::LeI64: case Bytecode::LeF32: case Bytecode::LeF64:
+                case Bytecode::GeI32: case Bytecode::GeI64: case Bytecode::GeF32: case Bytecode::GeF64:
+                case Bytecode::EqI32: case Bytecode::EqI64: case Bytecode::EqF32: case Bytecode::EqF64:
+                case Bytecode::NeqI32: case Bytecode::NeqI64: case Bytecode::NeqF32: case Bytecode::NeqF64: {
+                    auto type = operand_type(opcode);
+
+                    check_type(state, instruction.reg2, type);
+                    check_type(state, instruction.reg3, type);
+                    set(state, instruction.reg1, TYPE_BOOL, NO_CALLEE);
+                    break;
+                }
+
+                case Bytecode::ArrayAlloc:
+                    set(state, instruction.reg1, TYPE_ARRAY, NO_CALLEE);
+                    break;
+
+                case Bytecode::ArrayGet:
+                    check_type(state, instruction.reg1, TYPE_ARRAY);
+                    check_type(state, instruction.reg2, TYPE_I32);
+                    set(state, instruction.reg3, TYPE_UNKNOWN, NO_CALLEE);
+                    break;
+
+                case Bytecode::ArraySet:
+                    check_type(state, instruction.reg1, TYPE_ARRAY);
+                    check_type(state, instruction.reg2, TYPE_I32);
+                    check_register(instruction.reg3);
+                    break;
+
+                case Bytecode::ArrayAllocBool:
+                case Bytecode::ArrayAllocI32:
+                case Bytecode::ArrayAllocI64:
+                case Bytecode::ArrayAllocF32:
+                case Bytecode::ArrayAllocF64: {
+                    auto type = typed_array_type(opcode, Bytecode::ArrayAllocBool);
+                    set(state, instruction.reg1, type, NO_CALLEE);
+                    break;
+                }
+
+                case Bytecode::ArrayGetBool:
+                case Bytecode::ArrayGetI32:
+                case Bytecode::ArrayGetI64:
+                case Bytecode::ArrayGetF32:
+                case Bytecode::ArrayGetF64:
+                    check_type(state, instruction.reg1, typed_array_type(opcode, Bytecode::ArrayGetBool));
+                    check_type(state, instruction.reg2, TYPE_I32);
+                    set(state, instruction.reg3, array_element_type(opcode, Bytecode::ArrayGetBool), NO_CALLEE);
+                    break;
+
+                case Bytecode::ArraySetBool:
+                case Bytecode::ArraySetI32:
+                case Bytecode::ArraySetI64:
+                case Bytecode::ArraySetF32:
+                case Bytecode::ArraySetF64:
+                    check_type(state, instruction.reg1, typed_array_type(opcode, Bytecode::ArraySetBool));
+                    check_type(state, instruction.reg2, TYPE_I32);
+                    check_type(state, instruction.reg3, array_element_type(opcode, Bytecode::ArraySetBool));
+                    break;
+
+                // Registers whose array is only allocated on some paths are
+                // cleared with a false bool which these instructions ignore
+                case Bytecode::RefInc:
+                case Bytecode::RefDec:
+                    check_type(state, instruction.reg1, TYPE_ANY_ARRAY | TYPE_BOOL);
+                    break;
+
+                // Destroy also clears the register
+                case Bytecode::Destroy:
+                    check_type(state, instruction.reg1, TYPE_ANY_ARRAY | TYPE_BOOL);
+                    set(state, instruction.reg1, TYPE_BOOL, NO_CALLEE);
+                    break;
+
+                case Bytecode::Free:
+                    check_register(instruction.reg1);
+                    break;
+
+                case Bytecode::JumpIf:
+                case Bytecode::JumpIfNot:
+                    check_type(state, instruction.reg1, TYPE_BOOL);
+                    break;
+
+                case Bytecode::Call: {
+                    check_callee(state, instruction);
+
+                    auto& callable = state[instruction.reg1];
+                    bool is_builtin = callable.types == TYPE_FUNCTION
+                        && callable.callee != NO_CALLEE
+                        && callable.callee < 0;
+
+                    if (is_builtin) {
+                        // Builtin functions only write their return value
+                        auto builtin = get_builtin_function_by_index(~callable.callee);
+
+                        if (builtin->return_arity > 0) {
+                            auto type = type_category_to_type(builtin->return_category);
+                            set(state, instruction.reg2, type, NO_CALLEE);
+                        }
+                    } else {
+                        // The callee's register window starts at the first
+                        // argument so it may change any register from there
+                        for (std::size_t reg = instruction.reg2; reg < state.size(); ++reg) {
+                            state[reg] = RegisterState{ TYPE_UNKNOWN, NO_CALLEE };
+                        }
+                    }
+                    break;
+                }
+
+                case Bytecode::TailCall:
+                    check_callee(state, instruction);
+                    break;
+
+                case Bytecode::Ret:
+                    check_register_range(instruction.reg1, instruction.reg2);
+                    break;
+
+                case Bytecode::AddI32K:
+                case Bytecode::SubI32K:
+                    check_type(state, instruction.reg2, TYPE_I32);
+                    set(state, instruction.reg1, TYPE_I32, NO_CALLEE);
+                    break;
+
+                case Bytecode::JumpIfLtI32:
+                case Bytecode::JumpIfGtI32:
+                case Bytecode::JumpIfLeI32:
+                case Bytecode::JumpIfGeI32:
+                case Bytecode::JumpIfEqI32:
+                case Bytecode::JumpIfNeqI32:
+                    check_type(state, instruction.reg1, TYPE_I32);
+                    check_type(state, instruction.reg2, TYPE_I32);
+                    break;
+
+                default:
+                    fail("opcode is not supported by the vm");
+            }
+        }
+
+        bool Verifier::join(std::optional<State>& target, const State& state) {
+            if (!target) {
+                target = state;
+
+                return true;
+            }
+
+            bool changed = false;
+
+            for (std::size_t reg = 0; reg < target->size(); ++reg) {
+                auto& current = (*target)[reg];
+                TypeSet types = current.types | state[reg].types;
+                auto callee = current.callee == state[reg].callee ? current.callee : NO_CALLEE;
+
+                if (types != current.types || callee != current.callee) {
+                    current = RegisterState{ types, callee };
+                    changed = true;
+                }
+            }
+
+            return changed;
+        }
+    }
+}
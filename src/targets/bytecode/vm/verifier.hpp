@@ -0,0 +1,89 @@
+#ifndef KORE_VERIFIER_HPP
+#define KORE_VERIFIER_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "targets/bytecode/codegen/bytecode.hpp"
+#include "targets/bytecode/vm/decoded_instruction.hpp"
+
+namespace kore {
+    class CompiledObject;
+    class Module;
+
+    namespace vm {
+        /// Proves that the decoded code of a function is safe to run by the
+        /// vm's dispatch loop which does not check anything itself:
+        ///
+        ///   * Every opcode is supported by the vm
+        ///   * Register operands are below the function's register count
+        ///   * Global, function and builtin function indices are in range
+        ///   * Control cannot run off the end of the function
+        ///   * Calls pass as many arguments as a builtin function takes, or
+        ///     at most as many as an ordinary function has registers since
+        ///     compiled code does not record parameter counts
+        ///   * Registers hold the types that typed instructions expect along
+        ///     every path to them
+        ///   * Stack map entries are within the function and only name
+        ///     registers below its register count
+        ///
+        /// Constant indices and jump targets are already checked when the
+        /// instructions are decoded. Registers start out with unknown types
+        /// since parameter types are not recorded either, so only types
+        /// that are known to differ are rejected
+        class Verifier final {
+            public:
+                Verifier(const Module& module);
+
+                /// Verify a decoded function. Throws a ModuleLoadError
+                /// describing the first instruction that could not be
+                /// verified
+                void verify(const CompiledObject& func);
+
+            private:
+                /// The types a register may hold as a set of bits
+                using TypeSet = std::uint16_t;
+
+                struct RegisterState {
+                    TypeSet types;
+
+                    // Index of the function held by the register if it is
+                    // always the same function. Builtin functions are stored
+                    // as the complement of their index
+                    int callee;
+                };
+
+                using State = std::vector<RegisterState>;
+
+                const Module& _module;
+                const CompiledObject* _func = nullptr;
+                std::size_t _pc = 0;
+
+            private:
+                [[noreturn]] void fail(const std::string& message) const;
+
+                void check_register(int reg) const;
+                void check_register_range(int first_reg, int count) const;
+                void check_type(const State& state, int reg, TypeSet expected) const;
+                void check_callee(const State& state, const DecodedInstruction& instruction);
+
+                void set(State& state, int reg, TypeSet types, int callee);
+
+                /// Apply an instruction to the register types before it
+                void transfer(
+                    State& state,
+                    const DecodedInstruction& instruction,
+                    const bytecode_type* word
+                );
+
+                /// Merge a state into the state at the start of a block which
+                /// is empty if the block has not been reached yet. Returns
+                /// true if it changed
+                static bool join(std::optional<State>& target, const State& state);
+        };
+    }
+}
+
+#endif // KORE_VERIFIER_HPP
@@ -1,72 +1,309 @@
 #include "targets/bytecode/codegen/bytecode.hpp"
 #include "targets/bytecode/compiled_object.hpp"
+#include "targets/bytecode/disassemble/instruction.hpp"
 #include "targets/bytecode/module_loader.hpp"
+#include "targets/bytecode/module_load_error.hpp"
 #include "targets/bytecode/vm/builtins/builtins.hpp"
 #include "targets/bytecode/vm/config.hpp"
 #include "targets/bytecode/vm/vm.hpp"
+#include "targets/bytecode/vm/profiler.hpp"
+#include "targets/bytecode/vm/sampling_profiler.hpp"
+#include "targets/x64/jit.hpp"
+#include "logging/logging.hpp"
 #include "types/function_type.hpp"
 
-#define GET_REG_SHIFT(instruction, shift) (instruction >> shift) & 0xff;
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+#if KORE_VM_USE_COMPUTED_GOTO
+    // Each opcode has a label and every handler ends by fetching the next
+    // instruction and jumping directly to its handler through the dispatch
+    // table instead of going back to the top of a switch
+    #define VM_CASE(opcode) _op_##opcode
+    #define VM_NEXT VM_DISPATCH()
+    #define VM_DISPATCH() {\
+        KORE_VM_COUNT_DISPATCH();\
+        instruction = &instructions[_context.pc++];\
+        opcode = instruction->opcode;\
+        KORE_VM_PROFILE(count_instruction(opcode));\
+        KORE_DEBUG_VM_LOG("dispatch", bytecode_to_string(opcode));\
+        goto *dispatch_table[opcode];\
+    }
+#else
+    #define VM_CASE(opcode) case Bytecode::opcode
+    #define VM_NEXT break
+#endif
+
+#if KORE_VM_JIT_SUPPORTED
+    // Run the current function's native code, if any, from the current
+    // instruction until it exits back to the interpreter
+    #define VM_ENTER_NATIVE_CODE() {\
+        if (frame->native_code) {\
+            _context.pc = frame->native_code->run(&_registers[fp], _context.pc);\
+        }\
+    }
+#else
+    #define VM_ENTER_NATIVE_CODE()
+#endif
+
+// Reload the cached call frame, code and frame pointer after a call or
+// return, or leave the dispatch loop if that ended execution. Execution
+// switches to native code here since the frame has changed
+#define VM_RELOAD_FRAME() {\
+    if (!_running || !has_call_frames()) {\
+        goto done;\
+    }\
+    \
+    frame = current_frame();\
+    instructions = frame->code;\
+    fp = _context.fp;\
+    VM_ENTER_NATIVE_CODE();\
+}
+
+#ifdef KORE_VM_DISPATCH_STATS
+    #define KORE_VM_COUNT_DISPATCH() ++_dispatch_count
+#else
+    #define KORE_VM_COUNT_DISPATCH()
+#endif
+
+#ifdef KORE_VM_PROFILER
+    // Run a profiler action if profiling was enabled at run time
+    #define KORE_VM_PROFILE(action) {\
+        if (_profiler) {\
+            _profiler->action;\
+        }\
+    }
+#else
+    #define KORE_VM_PROFILE(action)
+#endif
 
 #define BINARY_OP(arg_type, ret_type, op) {\
-    Reg dest_reg = GET_REG1(instruction);\
-    Reg op1_reg = GET_REG2(instruction), op2_reg = GET_REG3(instruction);\
+    Reg dest_reg = instruction->reg1;\
+    Reg op1_reg = instruction->reg2, op2_reg = instruction->reg3;\
     \
     auto value1 = _registers[fp + op1_reg].as_##arg_type();\
     auto value2 = _registers[fp + op2_reg].as_##arg_type();\
     \
-    _registers[fp + dest_reg] = Value::from_##ret_type(value1 op value2);\
+    _registers[fp + dest_reg] = RegisterValue::from_##ret_type(value1 op value2);\
+}
+
+#define CONSTANT_OP(op) {\
+    Reg dest_reg = instruction->reg1;\
+    auto value = _registers[fp + instruction->reg2].as_i32();\
+    \
+    _registers[fp + dest_reg] = RegisterValue::from_i32(value op instruction->value);\
 }
 
-#define BINARY_OP_CASES(type, opcode_suffix) {\
-    case Bytecode::Add##opcode_suffix:\
+// Take a sample of the call stack if the sampling profiler's timer requested
+// one. Checked on calls and backward jumps so every loop iteration and every
+// function reaches a check
+#define VM_CHECK_SAMPLE() {\
+    if (SamplingProfiler::sample_requested()) {\
+        take_sample();\
+    }\
+}
+
+// Jump to an instruction. Backward jumps are counted so functions with hot
+// loops are tiered up and continue in native code, if any, right away
+#define VM_JUMP(target_pc) {\
+    std::size_t target = target_pc;\
+    bool backward = target < _context.pc;\
+    _context.pc = target;\
+    \
+    if (backward) {\
+        VM_CHECK_SAMPLE();\
+        \
+        if (_tiering && count_backward_jump(frame)) {\
+            VM_ENTER_NATIVE_CODE();\
+        }\
+    }\
+}
+
+#define COMPARE_AND_BRANCH_CASE(opcode, op) \
+    VM_CASE(opcode): {\
+        auto value1 = _registers[fp + instruction->reg1].as_i32();\
+        auto value2 = _registers[fp + instruction->reg2].as_i32();\
+        \
+        if (value1 op value2) {\
+            VM_JUMP(instruction->target);\
+        }\
+        VM_NEXT;\
+    }
+
+// Call an ordinary or builtin function in a register. The on_call hook is
+// passed the function right before it is called
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+    // Functions are referenced by index in untagged registers
+    #define CALL_CASE(opcode, function_call, builtin_call, on_call) \
+        VM_CASE(opcode): {\
+            auto callable = _registers[fp + instruction->reg1];\
+            \
+            if (callable.is_builtin_function()) {\
+                auto builtin = get_builtin_function_by_index(callable.as_builtin_index());\
+                \
+                on_call(builtin);\
+                \
+                builtin_call(*instruction, builtin);\
+            } else {\
+                auto func = get_function(callable.as_function_index());\
+                \
+                if (!func) {\
+                    goto done;\
+                }\
+                \
+                on_call(func);\
+                \
+                function_call(*instruction, func);\
+            }\
+            \
+            VM_RELOAD_FRAME();\
+            VM_NEXT;\
+        }
+#else
+    #define CALL_CASE(opcode, function_call, builtin_call, on_call) \
+        VM_CASE(opcode): {\
+            auto callable = _registers[fp + instruction->reg1].as_function_value();\
+            \
+            if (callable.type == FunctionValueType::Ordinary) {\
+                on_call(callable.func);\
+                \
+                function_call(*instruction, callable.func);\
+            } else if (callable.type == FunctionValueType::Builtin) {\
+                on_call(callable.builtin);\
+                \
+                builtin_call(*instruction, callable.builtin);\
+            } else if (callable.type == FunctionValueType::Closure) {\
+                vm_error("Closures are not yet supported");\
+            }\
+            \
+            VM_RELOAD_FRAME();\
+            VM_NEXT;\
+        }
+#endif
+
+// Hooks for CALL_CASE. A Call instruction is quickened to call the same
+// function directly from now on and a CallGeneric instruction counts a miss
+// of its inline cache
+#define QUICKEN_CALL(callee) quicken_call(*instruction, callee)
+#define COUNT_CACHE_MISS(callee) ++instruction->cache->misses
+#define NO_CALL_HOOK(callee)
+
+// Check that a register still holds the function cached by a quickened call
+// site's inline cache
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+    // Builtin functions are cached by their negated index so a single
+    // comparison checks either kind of function
+    #define IS_CACHED_FUNCTION(reg, cache) \
+        (_registers[fp + reg].as_function_index() == (cache)->function_index)
+
+    #define IS_CACHED_BUILTIN(reg, cache) IS_CACHED_FUNCTION(reg, cache)
+#else
+    #define IS_CACHED_FUNCTION(reg, cache) (\
+        _registers[fp + reg].as_function_value().type == FunctionValueType::Ordinary &&\
+        _registers[fp + reg].as_function_value().func == (cache)->func\
+    )
+
+    #define IS_CACHED_BUILTIN(reg, cache) (\
+        _registers[fp + reg].as_function_value().type == FunctionValueType::Builtin &&\
+        _registers[fp + reg].as_function_value().builtin == (cache)->builtin\
+    )
+#endif
+
+// Call the function in the inline cache of a quickened call site if the
+// guard holds. Otherwise the call site has seen another function so it is
+// rewritten to a generic call which is executed instead
+#define QUICKENED_CALL_CASE(opcode, guard, call) \
+    VM_CASE(opcode): {\
+        auto cache = instruction->cache;\
+        \
+        if (guard(instruction->reg1, cache)) {\
+            ++cache->hits;\
+            call;\
+            VM_RELOAD_FRAME();\
+        } else {\
+            rewrite_opcode(*instruction, Bytecode::CallGeneric);\
+            --_context.pc;\
+        }\
+        VM_NEXT;\
+    }
+
+#define BINARY_OP_CASES(type, opcode_suffix) \
+    VM_CASE(Add##opcode_suffix):\
         BINARY_OP(type, type, +)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Sub##opcode_suffix:\
+    VM_CASE(Sub##opcode_suffix):\
         BINARY_OP(type, type, -)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Mult##opcode_suffix:\
+    VM_CASE(Mult##opcode_suffix):\
         BINARY_OP(type, type, *)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Div##opcode_suffix:\
+    VM_CASE(Div##opcode_suffix):\
         BINARY_OP(type, type, /)\
-        break;\
-}
+        VM_NEXT;
 
-#define RELOP_CASES(type, opcode_suffix) {\
-    case Bytecode::Lt##opcode_suffix:\
-        BINARY_OP(type, bool, +)\
-        break;\
+#define RELOP_CASES(type, opcode_suffix) \
+    VM_CASE(Lt##opcode_suffix):\
+        BINARY_OP(type, bool, <)\
+        VM_NEXT;\
     \
-    case Bytecode::Gt##opcode_suffix:\
+    VM_CASE(Gt##opcode_suffix):\
         BINARY_OP(type, bool, >)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Le##opcode_suffix:\
+    VM_CASE(Le##opcode_suffix):\
         BINARY_OP(type, bool, <=)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Ge##opcode_suffix:\
+    VM_CASE(Ge##opcode_suffix):\
         BINARY_OP(type, bool, >=)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Eq##opcode_suffix:\
+    VM_CASE(Eq##opcode_suffix):\
         BINARY_OP(type, bool, ==)\
-        break;\
+        VM_NEXT;\
     \
-    case Bytecode::Neq##opcode_suffix:\
+    VM_CASE(Neq##opcode_suffix):\
         BINARY_OP(type, bool, !=)\
-        break;\
-}
+        VM_NEXT;
+
+// Allocate, read and write arrays that store their elements unboxed
+#define TYPED_ARRAY_CASES(type, opcode_suffix) \
+    VM_CASE(ArrayAlloc##opcode_suffix): {\
+        if (!allocate_array(\
+            fp + instruction->reg1,\
+            instruction->value,\
+            ArrayElementType::opcode_suffix\
+        )) {\
+            goto done;\
+        }\
+        VM_NEXT;\
+    }\
+    \
+    VM_CASE(ArrayGet##opcode_suffix): {\
+        auto array = _registers[fp + instruction->reg1].as_array();\
+        auto idx = _registers[fp + instruction->reg2].as_i32();\
+        \
+        _registers[fp + instruction->reg3] = RegisterValue::from_##type(array->data<type>()[idx]);\
+        VM_NEXT;\
+    }\
+    \
+    VM_CASE(ArraySet##opcode_suffix): {\
+        auto array = _registers[fp + instruction->reg1].as_array();\
+        auto idx = _registers[fp + instruction->reg2].as_i32();\
+        \
+        array->data<type>()[idx] = _registers[fp + instruction->reg3].as_##type();\
+        VM_NEXT;\
+    }
 
-#define _KORE_DEBUG_VM defined(KORE_DEBUG_VM) || defined(KORE_DEBUG)
+#if defined(KORE_DEBUG_VM) || defined(KORE_DEBUG)
+    #define _KORE_DEBUG_VM 1
+#endif
 
 #ifdef _KORE_DEBUG_VM
-    #include "logging/logging.hpp"
-
     // TODO: Change to use debug_group
     #define KORE_DEBUG_VM_LOG(action, value) {\
         if (!value.empty()) {\
@@ -81,6 +318,18 @@
 
 namespace kore {
     namespace vm {
+        /// Get the array in a register for reference counting or nullptr if
+        /// there is none. Registers whose array is only allocated on some
+        /// paths through a function are cleared with a false bool, i.e. a
+        /// null pointer when registers are untagged
+        static inline ArrayValue* get_counted_array(const RegisterValue& value) {
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+            return value.as_array();
+#else
+            return value.tag == ValueTag::Array ? value.value._array : nullptr;
+#endif
+        }
+
         void Context::reset() {
             pc = 0, sp = 0, fp = 0;
         }
@@ -90,93 +339,207 @@ namespace kore {
             this->pc = call_frame.old_pc;
         }
 
-        CallFrame::CallFrame(CompiledObject* obj)
-            : CallFrame(0, 0, 0, 0, obj) {}
-
-        CallFrame::CallFrame(
-            int ret_count,
-            int reg_count,
-            const bytecode_type* code,
-            std::size_t size
-        )
-            : ret_count(ret_count),
-              reg_count(reg_count),
-              code(code),
-              size(size) {}
-
-        CallFrame::CallFrame(
-            int ret_count,
-            int shift,
-            std::size_t old_fp,
-            std::size_t old_pc,
-            const CompiledObject* obj
-        )
-            : ret_count(ret_count),
-              reg_count(obj->reg_count()),
-              shift(shift),
-              old_fp(old_fp),
-              old_pc(old_pc),
-              code(obj->instructions()),
-              size(obj->code_size()) {}
-
         const std::string Vm::log_group = "vm";
 
-        Vm::Vm() {}
+        Vm::Vm() : _frame_top(_registers.call_frames()) {
+            _heap.set_root_marker([this](Heap& heap) { mark_roots(heap); });
+        }
 
         Vm::~Vm() {}
 
-        void Vm::run(const bytecode_type* code, std::size_t size) {
+#if KORE_VM_USE_COMPUTED_GOTO
+    // Taking the address of a label is a GNU extension
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+        void Vm::run(const DecodedInstruction* code, std::size_t size) {
             if (!code || size < 1) {
                 return;
             }
 
+            if (_sampler) {
+                _sampler->start();
+            }
+
+            // Touching the register stack's guard region jumps back here
+            sigjmp_buf overflow_handler;
+
+            if (sigsetjmp(overflow_handler, 1) != 0) {
+                _registers.set_overflow_handler(nullptr);
+                vm_error("Stack-overflow, ran out of register stack");
+
+                if (_sampler) {
+                    _sampler->stop();
+                }
+
+                return;
+            }
+
+            _registers.set_overflow_handler(&overflow_handler);
+
             _context.reset();
-            main_call_frame_reg_count = current_frame()->reg_count;
-            _context.sp += main_call_frame_reg_count;
 
             _running = true;
             _errored = false;
 
+            // Cache the current call frame, its code and the frame pointer.
+            // They only change when calling or returning from a function
+            CallFrame* frame = current_frame();
+            const DecodedInstruction* instructions = frame->code;
+            std::size_t fp = _context.fp;
+            const DecodedInstruction* instruction;
+            Bytecode opcode;
+
+#if KORE_VM_USE_COMPUTED_GOTO
+            // Must list a label for every opcode in the order of the Bytecode enum
+            static void* dispatch_table[] = {
+                &&_op_Noop,
+                &&_op_Move,
+                &&_op_Gload,
+                &&_op_Gstore,
+                &&_op_LoadBool,
+                &&_op_Cload,
+                &&_op_LoadBuiltin,
+                &&_op_LoadFunction,
+                &&_op_AddI32,
+                &&_op_AddI64,
+                &&_op_AddF32,
+                &&_op_AddF64,
+                &&_op_SubI32,
+                &&_op_SubI64,
+                &&_op_SubF32,
+                &&_op_SubF64,
+                &&_op_MultI32,
+                &&_op_MultI64,
+                &&_op_MultF32,
+                &&_op_MultF64,
+                &&_op_unknown, // PowI32
+                &&_op_unknown, // PowI64
+                &&_op_unknown, // PowF32
+                &&_op_unknown, // PowF64
+                &&_op_DivI32,
+                &&_op_DivI64,
+                &&_op_DivF32,
+                &&_op_DivF64,
+                &&_op_LtI32,
+                &&_op_LtI64,
+                &&_op_LtF32,
+                &&_op_LtF64,
+                &&_op_GtI32,
+                &&_op_GtI64,
+                &&_op_GtF32,
+                &&_op_GtF64,
+                &&_op_LeI32,
+                &&_op_LeI64,
+                &&_op_LeF32,
+                &&_op_LeF64,
+                &&_op_GeI32,
+                &&_op_GeI64,
+                &&_op_GeF32,
+                &&_op_GeF64,
+                &&_op_EqI32,
+                &&_op_EqI64,
+                &&_op_EqF32,
+                &&_op_EqF64,
+                &&_op_NeqI32,
+                &&_op_NeqI64,
+                &&_op_NeqF32,
+                &&_op_NeqF64,
+                &&_op_ArrayAlloc,
+                &&_op_ArrayGet,
+                &&_op_ArraySet,
+                &&_op_RefInc,
+                &&_op_RefDec,
+                &&_op_Destroy,
+                &&_op_Free,
+                &&_op_Jump,
+                &&_op_JumpIf,
+                &&_op_JumpIfNot,
+                &&_op_Call,
+                &&_op_Ret,
+                &&_op_TailCall,
+                &&_op_AddI32K,
+                &&_op_SubI32K,
+                &&_op_JumpIfLtI32,
+                &&_op_JumpIfGtI32,
+                &&_op_JumpIfLeI32,
+                &&_op_JumpIfGeI32,
+                &&_op_JumpIfEqI32,
+                &&_op_JumpIfNeqI32,
+                &&_op_ArrayAllocBool,
+                &&_op_ArrayAllocI32,
+                &&_op_ArrayAllocI64,
+                &&_op_ArrayAllocF32,
+                &&_op_ArrayAllocF64,
+                &&_op_ArrayGetBool,
+                &&_op_ArrayGetI32,
+                &&_op_ArrayGetI64,
+                &&_op_ArrayGetF32,
+                &&_op_ArrayGetF64,
+                &&_op_ArraySetBool,
+                &&_op_ArraySetI32,
+                &&_op_ArraySetI64,
+                &&_op_ArraySetF32,
+                &&_op_ArraySetF64,
+                &&_op_CallDirect,
+                &&_op_CallBuiltin,
+                &&_op_CallGeneric,
+            };
+
+            static_assert(
+                sizeof(dispatch_table) / sizeof(dispatch_table[0]) == Bytecode::CallGeneric + 1,
+                "Dispatch table does not cover all opcodes"
+            );
+
             // Main interpreter dispatch loop
-            while (_call_frames.size() > 0 && _running) {
-                auto instruction = current_frame()->code[_context.pc++];
-                auto opcode = GET_OPCODE(instruction);
-                auto fp = _context.fp;
+            VM_DISPATCH();
+#else
+            // Main interpreter dispatch loop
+            while (_running) {
+                KORE_VM_COUNT_DISPATCH();
+                instruction = &instructions[_context.pc++];
+                opcode = instruction->opcode;
+                KORE_VM_PROFILE(count_instruction(opcode));
 
                 KORE_DEBUG_VM_LOG("dispatch", bytecode_to_string(opcode));
 
                 switch (opcode) {
-                    case Bytecode::Noop:
-                        break;
+#endif
+                    VM_CASE(Noop):
+                        VM_NEXT;
 
-                    case Bytecode::Move: {
-                        move(fp + GET_REG1(instruction), fp + GET_REG2(instruction));
-                        break;
+                    VM_CASE(Move): {
+                        move(fp + instruction->reg1, fp + instruction->reg2);
+                        VM_NEXT;
                     }
 
-                    case Bytecode::LoadBool: {
-                        Reg dest_reg = GET_REG1(instruction);
-                        _registers[fp + dest_reg] = Value::from_bool(GET_VALUE(instruction));
-                        break;
+                    VM_CASE(LoadBool): {
+                        Reg dest_reg = instruction->reg1;
+                        _registers[fp + dest_reg] = RegisterValue::from_bool(instruction->value);
+                        VM_NEXT;
                     }
 
-                    case Bytecode::Cload: {
-                        Reg reg = GET_REG1(instruction);
-                        int index = GET_VALUE(instruction);
-                        _registers[fp + reg] = _context._current_module->constant_table().get(index);
-                        break;
+                    VM_CASE(Cload): {
+                        Reg reg = instruction->reg1;
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                        _registers[fp + reg] = instruction->raw_constant;
+#else
+                        _registers[fp + reg] = *instruction->constant;
+#endif
+                        VM_NEXT;
                     }
 
-                    case Bytecode::Gload: {
-                        Reg reg = GET_REG1(instruction);
-                        _registers[fp + reg] = _globals[GET_REG2(instruction)];
-                        break;
+                    VM_CASE(Gload): {
+                        Reg reg = instruction->reg1;
+                        _registers[fp + reg] = _globals[instruction->reg2];
+                        VM_NEXT;
                     }
 
-                    case Bytecode::Gstore: {
-                        Reg dest_reg = GET_REG1(instruction);
-                        _globals[dest_reg] = _registers[fp + GET_REG2(instruction)];
-                        break;
+                    VM_CASE(Gstore): {
+                        Reg dest_reg = instruction->reg1;
+                        _globals[dest_reg] = _registers[fp + instruction->reg2];
+                        VM_NEXT;
                     }
 
                     BINARY_OP_CASES(i32, I32)
@@ -189,112 +552,496 @@ namespace kore {
                     RELOP_CASES(f32, F32)
                     RELOP_CASES(f64, F64)
 
-                    case Bytecode::Jump: {
-                        _context.pc += GET_OFFSET(instruction);
-                        break;
+                    VM_CASE(Jump): {
+                        VM_JUMP(instruction->target);
+                        VM_NEXT;
                     }
 
-                    case Bytecode::JumpIf: {
-                        if (_registers[fp + GET_REG1(instruction)].as_bool()) {
-                            // Adjust by -1 since we already incremented the pc
-                            _context.pc += GET_OFFSET(instruction) - 1;
+                    VM_CASE(JumpIf): {
+                        if (_registers[fp + instruction->reg1].as_bool()) {
+                            VM_JUMP(instruction->target);
                         }
-                        break;
+                        VM_NEXT;
                     }
 
-                    case Bytecode::JumpIfNot: {
-                        if (!_registers[fp + GET_REG1(instruction)].as_bool()) {
-                            // Adjust by -1 since we already incremented the pc
-                            _context.pc += GET_OFFSET(instruction) - 1;
+                    VM_CASE(JumpIfNot): {
+                        if (!_registers[fp + instruction->reg1].as_bool()) {
+                            VM_JUMP(instruction->target);
                         }
-                        break;
+                        VM_NEXT;
                     }
 
-                    case Bytecode::ArrayAlloc: {
-                        Reg reg = GET_REG1(instruction);
-                        int size = GET_VALUE(instruction);
+                    VM_CASE(AddI32K):
+                        CONSTANT_OP(+)
+                        VM_NEXT;
 
-                        _registers[fp + reg] = Value::allocate_array(size);
-                        break;
+                    VM_CASE(SubI32K):
+                        CONSTANT_OP(-)
+                        VM_NEXT;
+
+                    COMPARE_AND_BRANCH_CASE(JumpIfLtI32, <)
+                    COMPARE_AND_BRANCH_CASE(JumpIfGtI32, >)
+                    COMPARE_AND_BRANCH_CASE(JumpIfLeI32, <=)
+                    COMPARE_AND_BRANCH_CASE(JumpIfGeI32, >=)
+                    COMPARE_AND_BRANCH_CASE(JumpIfEqI32, ==)
+                    COMPARE_AND_BRANCH_CASE(JumpIfNeqI32, !=)
+
+                    VM_CASE(ArrayAlloc): {
+                        Reg reg = instruction->reg1;
+                        int size = instruction->value;
+
+                        if (!allocate_array(fp + reg, size, ArrayElementType::Value)) {
+                            goto done;
+                        }
+                        VM_NEXT;
                     }
 
-                    case Bytecode::ArrayGet: {
-                        auto array = _registers[fp + GET_REG1(instruction)].as_array();
-                        i32 idx = _registers[fp + GET_REG2(instruction)].as_i32();
-                        Reg dst_reg = GET_REG3(instruction);
+                    VM_CASE(ArrayGet): {
+                        auto array = _registers[fp + instruction->reg1].as_array();
+                        i32 idx = _registers[fp + instruction->reg2].as_i32();
+                        Reg dst_reg = instruction->reg3;
 
                         _registers[fp + dst_reg] = (*array)[idx];
-                        break;
+                        VM_NEXT;
                     }
 
-                    case Bytecode::ArraySet: {
-                        auto array = _registers[fp + GET_REG1(instruction)].as_array();
-                        int idx = _registers[fp + GET_REG2(instruction)].as_i32();
-                        Value value = _registers[fp + GET_REG3(instruction)];
+                    VM_CASE(ArraySet): {
+                        auto array = _registers[fp + instruction->reg1].as_array();
+                        int idx = _registers[fp + instruction->reg2].as_i32();
+                        auto value = _registers[fp + instruction->reg3];
 
                         (*array)[idx] = value;
-                        break;
+                        VM_NEXT;
+                    }
+
+                    VM_CASE(ArrayAllocBool): {
+                        if (!allocate_array(
+                            fp + instruction->reg1,
+                            instruction->value,
+                            ArrayElementType::Bool
+                        )) {
+                            goto done;
+                        }
+                        VM_NEXT;
+                    }
+
+                    VM_CASE(ArrayGetBool): {
+                        auto array = _registers[fp + instruction->reg1].as_array();
+                        auto idx = _registers[fp + instruction->reg2].as_i32();
+
+                        _registers[fp + instruction->reg3] = RegisterValue::from_bool(array->get_bool(idx));
+                        VM_NEXT;
+                    }
+
+                    VM_CASE(ArraySetBool): {
+                        auto array = _registers[fp + instruction->reg1].as_array();
+                        auto idx = _registers[fp + instruction->reg2].as_i32();
+
+                        array->set_bool(idx, _registers[fp + instruction->reg3].as_bool());
+                        VM_NEXT;
+                    }
+
+                    TYPED_ARRAY_CASES(i32, I32)
+                    TYPED_ARRAY_CASES(i64, I64)
+                    TYPED_ARRAY_CASES(f32, F32)
+                    TYPED_ARRAY_CASES(f64, F64)
+
+                    VM_CASE(RefInc): {
+                        if (auto array = get_counted_array(_registers[fp + instruction->reg1])) {
+                            array->retain();
+                        }
+                        VM_NEXT;
+                    }
+
+                    VM_CASE(RefDec): {
+                        if (auto array = get_counted_array(_registers[fp + instruction->reg1])) {
+                            ArrayValue::release(array);
+                        }
+                        VM_NEXT;
+                    }
+
+                    // Clear the register so that destroying it again on
+                    // another path into a join does nothing
+                    VM_CASE(Destroy): {
+                        auto& value = _registers[fp + instruction->reg1];
+
+                        if (auto array = get_counted_array(value)) {
+                            ArrayValue::destroy(array);
+                            value = RegisterValue::from_bool(false);
+                        }
+                        VM_NEXT;
                     }
 
-                    case Bytecode::Free: {
-                        /* Value value = _registers[fp + GET_REG1(instruction)]; */
+                    VM_CASE(Free): {
+                        /* Value value = _registers[fp + instruction->reg1]; */
                         /* value.free(); */
-                        break;
+                        VM_NEXT;
                     }
 
-                    case Bytecode::LoadBuiltin: {
-                        Reg reg = GET_REG1(instruction);
-                        int func_index = GET_VALUE(instruction);
+                    VM_CASE(LoadBuiltin): {
+                        Reg reg = instruction->reg1;
+                        int func_index = instruction->value;
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                        _registers[fp + reg] = RawValue::from_builtin_index(func_index);
+#else
                         auto builtin = get_builtin_function_by_index(func_index);
                         _registers[fp + reg] = Value::from_builtin_function(builtin);
-                        break;
-                    }
-
-                    case Bytecode::LoadFunction: {
-                        Reg reg = GET_REG1(instruction);
-                        int func_index = GET_VALUE(instruction);
-                        _registers[fp + reg] = Value::from_function(get_function(func_index));;
-                        break;
+#endif
+                        VM_NEXT;
                     }
 
-                    case Bytecode::Call: {
-                        Reg func_reg = GET_REG1(instruction);
-                        auto callable = _registers[fp + func_reg].as_function_value();
+                    VM_CASE(LoadFunction): {
+                        Reg reg = instruction->reg1;
+                        int func_index = instruction->value;
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                        _registers[fp + reg] = RawValue::from_function_index(func_index);
+#else
+                        auto func = get_function(func_index);
 
-                        if (callable.type == FunctionValueType::Ordinary) {
-                            do_function_call(instruction, callable);
-                        } else if (callable.type == FunctionValueType::Builtin) {
-                            do_builtin_function_call(instruction, callable);
-                        } else if (callable.type == FunctionValueType::Closure) {
-                            vm_error("Closures are not yet supported");
+                        if (!func) {
+                            goto done;
                         }
-                        break;
+
+                        _registers[fp + reg] = Value::from_function(func);
+#endif
+                        VM_NEXT;
                     }
 
-                    case Bytecode::Ret: {
-                        do_function_return(instruction);
-                        break;
+                    CALL_CASE(Call, do_function_call, do_builtin_function_call, QUICKEN_CALL)
+
+                    VM_CASE(Ret): {
+                        do_function_return(*instruction);
+                        VM_RELOAD_FRAME();
+                        VM_NEXT;
                     }
 
+                    CALL_CASE(TailCall, do_tail_call, do_builtin_tail_call, NO_CALL_HOOK)
+
+                    QUICKENED_CALL_CASE(
+                        CallDirect,
+                        IS_CACHED_FUNCTION,
+                        do_function_call(*instruction, cache->func, cache->code)
+                    )
+
+                    QUICKENED_CALL_CASE(
+                        CallBuiltin,
+                        IS_CACHED_BUILTIN,
+                        do_builtin_function_call(*instruction, cache->builtin)
+                    )
+
+                    CALL_CASE(CallGeneric, do_function_call, do_builtin_function_call, COUNT_CACHE_MISS)
+
+#if KORE_VM_USE_COMPUTED_GOTO
+                    _op_unknown: {
+                        vm_error_unknown_opcode(opcode);
+                        goto done;
+                    }
+#else
                     default: {
                         vm_error_unknown_opcode(opcode);
                         break;
                     }
                 }
             }
+#endif
 
+        done:
             /* if (_errored) { */
             /*     dump_call_stack(std::cerr); */
             /* } */
 
+            _registers.set_overflow_handler(nullptr);
             _running = false;
+            KORE_VM_PROFILE(finish());
+
+            if (_sampler) {
+                _sampler->stop();
+            }
             // TODO: Dump registers then register free memory here
         }
 
-        void Vm::run(const std::vector<bytecode_type>& code) {
+#if KORE_VM_USE_COMPUTED_GOTO
+    #pragma GCC diagnostic pop
+#endif
+
+        void Vm::run(const std::vector<DecodedInstruction>& code) {
             run(code.data(), code.size());
         }
 
+        std::uint64_t Vm::dispatch_count() const {
+            return _dispatch_count;
+        }
+
+        void Vm::enable_tiering(std::uint32_t threshold) {
+            _tiering = true;
+            _tier_threshold = threshold;
+        }
+
+        bool Vm::enable_jit() {
+#if KORE_VM_JIT_SUPPORTED
+            _jit = std::make_unique<x64::Jit>(_loaded_functions);
+
+            if (!_tiering) {
+                enable_tiering();
+            }
+
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        bool Vm::enable_profiler() {
+#ifdef KORE_VM_PROFILER
+            _profiler = std::make_unique<Profiler>();
+
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        void Vm::enable_sampling(std::uint32_t frequency, bool include_pcs) {
+            _sampler = std::make_unique<SamplingProfiler>(frequency, include_pcs);
+        }
+
+        std::uint64_t Vm::sample_count() const {
+            return _sampler ? _sampler->sample_count() : 0;
+        }
+
+        void Vm::dump_samples(std::ostream& os) const {
+            if (_sampler) {
+                _sampler->dump_folded(os);
+            }
+        }
+
+        void Vm::dump_profile(std::ostream& os) const {
+            if (_profiler) {
+                _profiler->dump(os);
+            }
+        }
+
+        void Vm::dump_profile_json(std::ostream& os) const {
+            if (_profiler) {
+                _profiler->dump_json(os);
+            }
+        }
+
+        void Vm::dump_tier_stats(std::ostream& os) const {
+            std::vector<const CompiledObject*> hot_functions;
+
+            for (auto func : _loaded_functions) {
+                if (func && func->tier_state().tier != Tier::Baseline) {
+                    hot_functions.push_back(func);
+                }
+            }
+
+            std::sort(
+                hot_functions.begin(),
+                hot_functions.end(),
+                [](const CompiledObject* func1, const CompiledObject* func2) {
+                    return func1->tier_state().calls > func2->tier_state().calls;
+                }
+            );
+
+            os << "tier-up statistics:" << std::endl
+               << "    tiering:      " << (_tiering ? "enabled" : "disabled") << std::endl
+               << "    threshold:    " << _tier_threshold << std::endl
+               << "    functions:    " << _loaded_functions.size() << std::endl
+               << "    tiered up:    " << _tier_up_count << std::endl
+               << "    tier-up time: " << std::fixed << std::setprecision(3)
+               << _tier_up_seconds * 1000.0 << "ms" << std::endl;
+
+#if KORE_VM_JIT_SUPPORTED
+            if (_jit) {
+                os << "    native code:  " << _jit->compiled_count() << " functions, "
+                   << _jit->code_size() << " bytes" << std::endl;
+            }
+#endif
+
+            if (hot_functions.empty()) {
+                return;
+            }
+
+            os << std::endl << std::left
+               << std::setw(24) << "function"
+               << std::setw(12) << "calls"
+               << std::setw(16) << "backward jumps"
+               << std::setw(12) << "tier"
+               << std::setw(16) << "reason"
+               << "native" << std::endl;
+
+            for (auto func : hot_functions) {
+                auto& state = func->tier_state();
+
+                os << std::setw(24) << func->name()
+                   << std::setw(12) << state.calls
+                   << std::setw(16) << state.backward_jumps
+                   << std::setw(12) << tier_to_string(state.tier)
+                   << std::setw(16) << tier_up_reason_to_string(state.reason)
+                   << (state.native_code ? "yes" : "no") << std::endl;
+            }
+
+            os << std::right;
+        }
+
+        void Vm::dump_inline_cache_stats(std::ostream& os) const {
+            struct CallSite {
+                const CompiledObject* func;
+                int pos;
+                const DecodedInstruction* instruction;
+            };
+
+            std::vector<CallSite> call_sites;
+            std::uint64_t hits = 0;
+            std::uint64_t misses = 0;
+            std::size_t monomorphic_count = 0;
+
+            for (auto func : _loaded_functions) {
+                if (!func) {
+                    continue;
+                }
+
+                for (int pos = 0; pos < func->decoded_size(); ++pos) {
+                    auto instruction = &func->decoded_instructions()[pos];
+
+                    switch (instruction->opcode) {
+                        case Bytecode::CallDirect:
+                        case Bytecode::CallBuiltin:
+                            ++monomorphic_count;
+                            [[fallthrough]];
+
+                        case Bytecode::CallGeneric:
+                            call_sites.push_back(CallSite{ func, pos, instruction });
+                            hits += instruction->cache->hits;
+                            misses += instruction->cache->misses;
+                            break;
+
+                        default:
+                            break;
+                    }
+                }
+            }
+
+            std::sort(
+                call_sites.begin(),
+                call_sites.end(),
+                [](const CallSite& site1, const CallSite& site2) {
+                    auto cache1 = site1.instruction->cache;
+                    auto cache2 = site2.instruction->cache;
+
+                    return cache1->hits + cache1->misses > cache2->hits + cache2->misses;
+                }
+            );
+
+            auto total = hits + misses;
+
+            os << "inline cache statistics:" << std::endl
+               << "    call sites:   " << call_sites.size() << std::endl
+               << "    monomorphic:  " << monomorphic_count << std::endl
+               << "    megamorphic:  " << call_sites.size() - monomorphic_count << std::endl
+               << "    hits:         " << hits << std::endl
+               << "    misses:       " << misses << std::endl
+               << "    hit rate:     " << std::fixed << std::setprecision(1)
+               << (total > 0 ? 100.0 * hits / total : 0.0) << "%" << std::endl;
+
+            if (call_sites.empty()) {
+                return;
+            }
+
+            os << std::endl << std::left
+               << std::setw(24) << "function"
+               << std::setw(8) << "pc"
+               << std::setw(16) << "state"
+               << std::setw(24) << "cached"
+               << std::setw(12) << "hits"
+               << "misses" << std::endl;
+
+            for (auto& site : call_sites) {
+                auto cache = site.instruction->cache;
+                std::string cached;
+
+                if (cache->func) {
+                    cached = cache->func->name();
+                } else if (cache->builtin) {
+                    cached = std::string(cache->builtin->name) + " (builtin)";
+                }
+
+                os << std::setw(24) << site.func->name()
+                   << std::setw(8) << site.pos
+                   << std::setw(16) << bytecode_to_string(site.instruction->opcode)
+                   << std::setw(24) << cached
+                   << std::setw(12) << cache->hits
+                   << cache->misses << std::endl;
+            }
+
+            os << std::right;
+        }
+
+        int Vm::materialized_count() const {
+            int count = 0;
+
+            for (auto& [name, module] : _modules) {
+                count += module.materialized_count();
+            }
+
+            return count;
+        }
+
+        void Vm::dump_load_stats(std::ostream& os) const {
+            auto loaded_count = std::count_if(
+                _loaded_functions.cbegin(),
+                _loaded_functions.cend(),
+                [](const CompiledObject* func) { return func != nullptr; }
+            );
+
+            os << "load statistics:" << std::endl
+               << "    functions:    " << loaded_count << std::endl
+               << "    materialized: " << materialized_count() << std::endl;
+
+            if (materialized_count() < loaded_count) {
+                os << std::endl << "not materialized:" << std::endl;
+
+                for (auto func : _loaded_functions) {
+                    if (func && !func->is_materialized()) {
+                        os << "    " << func->name() << std::endl;
+                    }
+                }
+            }
+        }
+
+        void Vm::set_heap_limit(std::size_t limit) {
+            _heap.set_limit(limit);
+        }
+
+        void Vm::enable_gc_stress() {
+            _heap.set_stress(true);
+        }
+
+        void Vm::collect_garbage() {
+            _heap.collect();
+        }
+
+        void Vm::dump_gc_stats(std::ostream& os) const {
+            _heap.dump_stats(os);
+        }
+
+        void Vm::dump_code(std::ostream& os) const {
+            for (auto func : _loaded_functions) {
+                if (!func) {
+                    continue;
+                }
+
+                os << func->name() << ":" << std::endl;
+
+                for (int pos = 0; pos < func->decoded_size(); ++pos) {
+                    os << "    ";
+                    koredis::format_decoded_instruction(os, pos, func->decoded_instructions()[pos]);
+                    os << std::endl;
+                }
+            }
+        }
+
         void Vm::dump_registers(std::ostream& os) {
             // TODO: Track the highest register used by each call frame so we
             // can dump all call frames instead
@@ -318,13 +1065,22 @@ namespace kore {
 
             // Push a call frame to the main object
             auto main_object = _context._current_module->main_object();
-            _call_frames.push_back(CallFrame{ main_object });
+            _context._current_module->materialize(main_object);
+
+            push_call_frame(CallFrame{
+                main_object->decoded_instructions(),
+                count_call(main_object),
+                main_object,
+                0,
+                0,
+            });
 
             run_compiled_object(main_object);
         }
 
         void Vm::run_compiled_object(CompiledObject* obj) {
-            run(obj->instructions(), obj->code_size());
+            main_call_frame_reg_count = obj->reg_count();
+            run(obj->decoded_instructions(), obj->decoded_size());
         }
 
         void Vm::load_functions_from_module(const Module& module) {
@@ -341,23 +1097,87 @@ namespace kore {
             _globals.resize(_globals.size() + module.global_indices_count());
         }
 
-        bool Vm::allocate_local_stack(const CompiledObject* const obj) {
-            auto reg_count = obj->reg_count();
+        void Vm::vm_error(const std::string& message) {
+            auto full_message = message + format_error_location();
+            error_group(log_group, "%s", full_message.c_str());
+            /* critical_group(log_group, message); */
+            _running = false;
+            _errored = true;
+        }
+
+        bool Vm::allocate_array(
+            std::size_t reg_index,
+            std::size_t size,
+            ArrayElementType element_type
+        ) {
+            auto array = ArrayValue::allocate(size, element_type);
+
+            if (!_heap.add(array)) {
+                delete array;
+                vm_error(
+                    "Out of memory, exceeded the heap limit of "
+                    + std::to_string(_heap.limit())
+                    + " bytes"
+                );
 
-            if (_context.sp + reg_count >= KORE_VM_MAX_REGISTERS) {
-                vm_error("Stack-overflow, ran out of local stack");
                 return false;
             }
 
-            _context.sp += reg_count;
+            _registers[reg_index] = RegisterValue::from_array(array);
+
             return true;
         }
 
-        void Vm::vm_error(const std::string& message) {
-            error_group(log_group, "%s", message.c_str());
-            /* critical_group(log_group, message); */
-            _running = false;
-            _errored = true;
+        void Vm::mark_roots(Heap& heap) {
+            // Globals are only ever loaded into registers and stored back
+            // so they are not tracked by the stack maps and may hold
+            // anything
+            for (auto& value : _globals) {
+                heap.mark_candidate(get_counted_array(value));
+            }
+
+            if (!_running) {
+                return;
+            }
+
+            // The instruction being executed in the current call frame is
+            // the one before the program counter and callers are at the call
+            // instruction before their return address
+            auto pc = _context.pc - 1;
+            auto fp = _context.fp;
+
+            for (auto frame = _frame_top; frame != _registers.call_frames();) {
+                --frame;
+                mark_call_frame(heap, frame->func, pc, fp);
+
+                pc = frame->old_pc - 1;
+                fp = frame->old_fp;
+            }
+        }
+
+        void Vm::mark_call_frame(
+            Heap& heap,
+            const CompiledObject* func,
+            std::size_t pc,
+            std::size_t fp
+        ) {
+            if (auto registers = func->stack_map().lookup(pc)) {
+                for (auto reg : *registers) {
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                    // Registers that only hold an array on some paths
+                    // through the function may hold other values
+                    heap.mark_candidate(_registers[fp + reg].as_array());
+#else
+                    heap.mark(get_counted_array(_registers[fp + reg]));
+#endif
+                }
+
+                return;
+            }
+
+            for (int reg = 0; reg < func->reg_count(); ++reg) {
+                heap.mark_candidate(get_counted_array(_registers[fp + reg]));
+            }
         }
 
         void Vm::vm_error_unknown_opcode(Bytecode opcode) {
@@ -370,6 +1190,33 @@ namespace kore {
             vm_error(message);
         }
 
+        std::string Vm::format_error_location() {
+            if (!has_call_frames()) {
+                return "";
+            }
+
+            // The top of the call frame stack may point into its guard
+            // region if pushing a call frame overflowed it
+            auto frame_end = _registers.call_frames() + _registers.call_frame_capacity();
+            auto func = (std::min(_frame_top, frame_end) - 1)->func;
+
+            if (!func) {
+                return "";
+            }
+
+            // The program counter has already moved past the instruction
+            // that failed unless a function was just entered
+            auto pc = _context.pc > 0 ? _context.pc - 1 : 0;
+            auto location = func->source_location(pc);
+            std::string result = " in " + func->name();
+
+            if (!location.is_unknown()) {
+                result += " at " + location.colon_format();
+            }
+
+            return result;
+        }
+
         void Vm::vm_fatal_error(const std::string& message) {
             error_group(log_group, "%s", message.c_str());
             /* critical_group(log_group, "%s", message.c_str()); */
@@ -379,25 +1226,42 @@ namespace kore {
         }
 
         CompiledObject* Vm::get_function(int func_index) {
-            return _loaded_functions[func_index];
+            auto func = _loaded_functions[func_index];
+
+            // Functions are decoded the first time they are loaded into a
+            // register or called so unused functions are never decoded
+            if (!func->is_materialized()) {
+                try {
+                    _context._current_module->materialize(func);
+                } catch (ModuleLoadError& ex) {
+                    vm_error(ex.what());
+                    return nullptr;
+                }
+            }
+
+            return func;
         }
 
         CallFrame* Vm::current_frame() {
             #if KORE_DEBUG_VM
-            if (_call_frames.size() == 0) {
+            if (!has_call_frames()) {
                 vm_fatal_error("No call frames when trying to get current call frame");
                 return nullptr;
             }
             #endif
 
-            return &_call_frames.back();
+            return _frame_top - 1;
+        }
+
+        bool Vm::has_call_frames() const {
+            return _frame_top != _registers.call_frames();
         }
 
         void Vm::push_i32(i32 value) {
-            _registers[_context.sp++] = Value::from_i32(value);
+            _registers[_context.sp++] = RegisterValue::from_i32(value);
         }
 
-        void Vm::push(Value& value) {
+        void Vm::push(RegisterValue& value) {
             _registers[_context.sp++] = value;
         }
 
@@ -405,119 +1269,113 @@ namespace kore {
             push(_registers[reg]);
         }
 
-        const CallFrame* Vm::get_caller() {
-            #ifdef _KORE_DEBUG_VM
-                if (_call_frames.size() < 2) {
-                    vm_error("No previous caller");
-                    return nullptr;
-                }
-            #endif
+        void Vm::push_call_frame(const CallFrame& call_frame) {
+            // Overflowing the call frame stack hits its guard region
+            *_frame_top++ = call_frame;
+            KORE_VM_PROFILE(enter(call_frame.func));
 
-            return &_call_frames[_call_frames.size() - 2];
-        }
-
-        int Vm::push_function_arguments(bytecode_type instruction, std::size_t old_fp) {
-            int arg_count = GET_REG2(instruction);
-            int shift = 24;
-
-            if (arg_count > 0) {
-                CallFrame* frame = current_frame();
+            // Set the program counter to zero to start executing the start of
+            // the called function's instructions
+            _context.pc = 0;
 
-                if (!frame) {
-                    return 0;
-                }
+            VM_CHECK_SAMPLE();
+        }
 
-                // Get the instruction containing the beginning of the argument
-                // registers
-                instruction = frame->code[_context.pc];
+        void Vm::pop_call_frame(const CallFrame& call_frame) {
+            // Restore the old frame pointer and program counter. The callee's
+            // register window overlapped the top of the caller's so there is
+            // nothing to deallocate
+            _context.restore(call_frame);
 
-                // Move argument registers into the callee's register window
-                for (int idx = 0; idx < arg_count; ++idx, shift -= 8) {
-                    Reg dst_reg = _context.fp + idx;
-                    Reg src_reg = old_fp + GET_REG_SHIFT(instruction, shift);
-                    move(dst_reg, src_reg);
+            --_frame_top;
+            KORE_VM_PROFILE(leave());
+        }
 
-                    if (shift == 0) {
-                        shift = 24;
-                        instruction = frame->code[_context.pc++];
-                    }
-                }
+        void Vm::take_sample() {
+            if (_sampler) {
+                _sampler->sample(_registers.call_frames(), _frame_top, _context.pc);
             }
-
-            return shift;
         }
 
-        void Vm::push_call_frame(CallFrame call_frame) {
-            _call_frames.push_back(call_frame);
+        void Vm::quicken_call(
+            const DecodedInstruction& instruction,
+            const CompiledObject* func
+        ) {
+            auto cache = instruction.cache;
+            cache->func = func;
+            cache->code = func->decoded_instructions();
+            cache->function_index = func->func_index();
 
-            // Set the program counter to zero to start executing the start of
-            // the called function's instructions
-            _context.pc = 0;
+            rewrite_opcode(instruction, Bytecode::CallDirect);
         }
 
-        void Vm::pop_call_frame(const CallFrame& call_frame) {
-            // Deallocate the current call frame by resetting the stack pointer
-            // to the base of it just beyond the register window of the caller.
-            _context.sp -= call_frame.reg_count;
+        void Vm::quicken_call(
+            const DecodedInstruction& instruction,
+            const BuiltinFunction* builtin
+        ) {
+            auto cache = instruction.cache;
+            cache->builtin = builtin;
+            cache->function_index = ~static_cast<int>(builtin->index);
 
-            // Restore the old frame pointer and program counter
-            _context.restore(call_frame);
+            rewrite_opcode(instruction, Bytecode::CallBuiltin);
+        }
 
-            _call_frames.pop_back();
+        void Vm::rewrite_opcode(const DecodedInstruction& instruction, Bytecode opcode) {
+            // Decoded instructions are private to the function that owns
+            // them and only read by the vm so they are safe to modify here
+            const_cast<DecodedInstruction&>(instruction).opcode = opcode;
         }
 
-        void Vm::do_function_call(bytecode_type instruction, const FunctionValue& callable) {
+        void Vm::do_function_call(
+            const DecodedInstruction& instruction,
+            const CompiledObject* func
+        ) {
+            do_function_call(instruction, func, func->decoded_instructions());
+        }
+
+        void Vm::do_function_call(
+            const DecodedInstruction& instruction,
+            const CompiledObject* func,
+            const DecodedInstruction* code
+        ) {
             // Save the old frame pointer
             auto old_fp = _context.fp;
 
-            // Save the current stack pointer position as the new frame pointer
-            _context.fp = _context.sp;
-
-            KORE_DEBUG_VM_LOG("push call frame", callable.func->name());
+            // The arguments were placed in consecutive registers at the top
+            // of the caller's register window so the callee's window starts
+            // at the first of them and no arguments need to be moved
+            _context.fp = old_fp + instruction.reg2;
 
-            // Reserve local stack space for the called function
-            if (!allocate_local_stack(callable.func)) {
-                return;
-            }
-
-            int shift = push_function_arguments(instruction, old_fp);
-            int ret_count = GET_REG3(instruction);
+            KORE_DEBUG_VM_LOG("push call frame", func->name());
 
             push_call_frame(CallFrame{
-                ret_count,
-                shift,
+                code,
+                count_call(func),
+                func,
                 old_fp,
                 _context.pc,
-                callable.func,
             });
         }
 
         void Vm::do_builtin_function_call(
-            bytecode_type instruction,
-            const FunctionValue& callable
+            const DecodedInstruction& instruction,
+            const BuiltinFunction* builtin
         ) {
-            KORE_DEBUG_VM_LOG("call builtin", callable.builtin->name);
+            KORE_DEBUG_VM_LOG("call builtin", std::string(builtin->name));
 
-            _context.shift = push_function_arguments(instruction, _context.fp);
-            callable.builtin->func(*this, &_registers[_context.fp]);
-
-            // Move the instruction pointer if there were arguments and/or
-            // return values since the instruction pointer was left on next
-            // instruction by the caller which is either the next instruction
-            // to execute or the one containing argument/return registers if
-            // there were any
-            if (callable.builtin->type->arity() + callable.builtin->type->return_arity() > 0) {
-                ++_context.pc;
-            }
+            // Arguments and return values share the same registers just like
+            // for ordinary functions so the builtin function reads and writes
+            // them directly without any copying
+            builtin->func(*this, &_registers[_context.fp + instruction.reg2]);
         }
 
-        Value Vm::pop() {
+        RegisterValue Vm::pop() {
             return _registers[--_context.sp];
         }
 
         // TODO: Clean up register window by setting registers to a
         // sentinel/gravestore value
-        void Vm::do_function_return(bytecode_type instruction) {
+        void Vm::do_function_return(const DecodedInstruction& instruction) {
             KORE_DEBUG_VM_LOG("pop call frame", std::string());
 
             CallFrame* frame = current_frame();
@@ -526,80 +1384,103 @@ namespace kore {
                 return;
             }
 
-            int ret_count = GET_REG1(instruction);
+            // Move the return values down to the start of the register
+            // window where the caller expects them
+            move_to_window_start(instruction.reg1, instruction.reg2);
 
-            // NOTE: Might want to specialse for returning one argument
-            if (ret_count > 0) {
-                auto caller_shift = frame->shift;
-                auto callee_shift = 8; // Ret opcode + return count
+            pop_call_frame(*frame);
+        }
 
-                // Get the instruction at the return address
-                auto caller = get_caller();
+        void Vm::do_tail_call(
+            const DecodedInstruction& instruction,
+            const CompiledObject* func
+        ) {
+            KORE_DEBUG_VM_LOG("tail call", func->name());
 
-                if (!caller) {
-                    return;
-                }
+            // Nothing in the current register window is needed after a tail
+            // call so the arguments become the start of the window of the
+            // called function and the current call frame is reused. Its old
+            // frame pointer and program counter still point to the caller
+            move_to_window_start(instruction.reg2, instruction.reg3);
 
-                auto caller_ins = caller->code[frame->old_pc++];
+            KORE_VM_PROFILE(leave());
+            KORE_VM_PROFILE(enter(func));
 
-                // Copy return registers into destination registers in the
-                // previous call frame
-                for (int idx = 0; idx < ret_count; caller_shift -= 8, callee_shift -= 8) {
-                    // Get a source register from the caller instruction
-                    Reg src_reg = _context.fp + GET_REG_SHIFT(instruction, callee_shift);
+            auto frame = current_frame();
+            frame->code = func->decoded_instructions();
+            frame->native_code = count_call(func);
+            frame->func = func;
+            _context.pc = 0;
+        }
 
-                    // Get a destination register from the return address instruction
-                    // which is a register encoded in the original call instruction
-                    Reg dst_reg = frame->old_fp + GET_REG_SHIFT(caller_ins, caller_shift);
+        void Vm::do_builtin_tail_call(
+            const DecodedInstruction& instruction,
+            const BuiltinFunction* builtin
+        ) {
+            // Builtin functions do not have a call frame to reuse so call it
+            // as usual and return its values
+            do_builtin_function_call(instruction, builtin);
+            move_to_window_start(instruction.reg2, builtin->return_arity);
 
-                    move(dst_reg, src_reg);
+            pop_call_frame(*current_frame());
+        }
 
-                    // Exit loop if we are done and don't increment any program counters
-                    // which might otherwise skip an instruction if the last register is
-                    // aligned to a 4-byte boundary
-                    if (++idx >= ret_count) {
-                        break;
-                    }
+        const x64::NativeCode* Vm::count_call(const CompiledObject* func) {
+            if (!_tiering) {
+                return nullptr;
+            }
 
-                    if (caller_shift == 0) {
-                        caller_shift = 24;
-                        instruction = caller->code[frame->old_pc++];
-                    }
+            auto& state = func->tier_state();
 
-                    if (callee_shift == 0) {
-                        callee_shift = 24;
-                        caller_ins = frame->code[_context.pc++];
-                    }
-                }
+            if (++state.calls >= _tier_threshold && state.tier == Tier::Baseline) {
+                tier_up(func, TierUpReason::Calls);
             }
 
-            pop_call_frame(*frame);
+            return state.native_code;
         }
 
-        void Vm::set_return_value(const Value& value) {
-            // Getting the current call frame here is the caller since calling a
-            // builtin function does not push a call frame onto the stack
-            CallFrame* frame = current_frame();
+        bool Vm::count_backward_jump(CallFrame* frame) {
+            auto func = frame->func;
+            auto& state = func->tier_state();
 
-            if (!frame) {
-                return;
+            if (++state.backward_jumps >= _tier_threshold && state.tier == Tier::Baseline) {
+                tier_up(func, TierUpReason::BackwardJumps);
+
+                // Native code can be entered at any instruction so the
+                // running frame switches over without waiting for a new call
+                frame->native_code = state.native_code;
             }
 
-            auto instruction = frame->code[_context.pc];
+            return frame->native_code != nullptr;
+        }
+
+        void Vm::tier_up(const CompiledObject* func, TierUpReason reason) {
+            KORE_DEBUG_VM_LOG("tier up", func->name());
 
-            // Copy the value into a destination register in the caller's
-            // register window. Get the destination register encoded in the
-            // caller's call instruction
-            Reg dst_reg = GET_REG_SHIFT(instruction, _context.shift);
+            auto start = std::chrono::steady_clock::now();
+            auto& state = func->tier_state();
 
-            _registers[_context.fp + dst_reg] = value;
+            state.tier = Tier::Optimised;
+            state.reason = reason;
 
-            // Move shift to the next return register
-            _context.shift -= 8;
+#if KORE_VM_JIT_SUPPORTED
+            if (_jit) {
+                state.native_code = _jit->compile(*func);
+            }
+#endif
 
-            if (_context.shift <= 0) {
-                _context.shift = 24;
-                ++_context.pc;
+            auto end = std::chrono::steady_clock::now();
+            _tier_up_seconds += std::chrono::duration<double>(end - start).count();
+            ++_tier_up_count;
+        }
+
+        void Vm::move_to_window_start(Reg first_reg, int count) {
+            // The destination is always below the source so moving in
+            // ascending order is safe
+            if (first_reg != 0) {
+                for (int idx = 0; idx < count; ++idx) {
+                    move(_context.fp + idx, _context.fp + first_reg + idx);
+                }
             }
         }
 
@@ -630,6 +1511,16 @@ namespace kore {
     }
 }
 
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_DISPATCH
+#undef VM_RELOAD_FRAME
+#undef VM_ENTER_NATIVE_CODE
+#undef KORE_VM_COUNT_DISPATCH
+#undef CONSTANT_OP
+#undef VM_JUMP
+#undef COMPARE_AND_BRANCH_CASE
 #undef BINARY_OP_CASES
 #undef RELOP_CASES
+#undef TYPED_ARRAY_CASES
 #undef KORE_DEBUG_VM_LOG
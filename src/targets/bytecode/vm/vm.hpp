@@ -2,62 +2,40 @@
 #define KORE_VM_HPP
 
 #include "targets/bytecode/codegen/bytecode.hpp"
+#include "targets/bytecode/vm/call_frame.hpp"
+#include "targets/bytecode/vm/register_stack.hpp"
+#include "targets/bytecode/vm/register_value.hpp"
 #include "targets/bytecode/vm/value_type.hpp"
 #include "targets/bytecode/vm/config.hpp"
+#include "targets/bytecode/vm/decoded_instruction.hpp"
+#include "targets/bytecode/vm/heap.hpp"
+#include "targets/bytecode/vm/inline_cache.hpp"
+#include "targets/bytecode/vm/tier_state.hpp"
 #include "targets/bytecode/register.hpp"
 #include "targets/bytecode/module.hpp"
 
 #include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
 #include <vector>
 
 namespace fs = std::filesystem;
 
 namespace kore {
+    namespace x64 {
+        class Jit;
+        class NativeCode;
+    }
+
     namespace vm {
-        struct CallFrame {
-            CallFrame(CompiledObject* obj);
-
-            CallFrame(
-                int ret_count,
-                int reg_count,
-                const bytecode_type* code,
-                std::size_t size
-            );
-
-            CallFrame(
-                int ret_count,
-                int shift,
-                std::size_t old_fp,
-                std::size_t old_pc,
-                const CompiledObject* obj
-            );
-
-            // The number of values returned by the function of the call frame
-            int ret_count;
-
-            // The number of registers needed for running the function's code
-            int reg_count;
-
-            // The bitshift for the start of the return registers in the
-            // previous call frame
-            int shift;
-
-            // The old frame pointer and program counter that we need to
-            // restore when we pop this call frame
-            std::size_t old_fp;
-            std::size_t old_pc;
-
-            // Pointer to instructions currently being executed
-            const bytecode_type* code;
-            std::size_t size;
-        };
+        class Profiler;
+        class SamplingProfiler;
 
         struct Context {
             std::size_t pc = 0; // Program counter
             std::size_t sp = 0; // Stack pointer
             std::size_t fp = 0; // Frame pointer for current call frame
-            int shift = 0;
 
             Module* _current_module;
 
@@ -76,11 +54,12 @@ namespace kore {
                 Vm();
                 ~Vm();
 
-                /// Run the code in a sized array
-                void run(const bytecode_type* code, std::size_t size);
+                /// Run the decoded code in a sized array. Call instructions
+                /// are quickened in place after their first execution
+                void run(const DecodedInstruction* code, std::size_t size);
 
-                /// Run the code in a vector
-                void run(const std::vector<bytecode_type>& code);
+                /// Run the decoded code in a vector
+                void run(const std::vector<DecodedInstruction>& code);
 
                 /// Run a compiled object
                 /* void run(const CompiledObject* obj) */
@@ -91,8 +70,76 @@ namespace kore {
 
                 void dump_registers(std::ostream& os);
 
-                /// Set a return value a from builtin function
-                void set_return_value(const Value& value);
+                /// The number of instructions dispatched so far. Only counted
+                /// when compiled with KORE_VM_DISPATCH_STATS
+                std::uint64_t dispatch_count() const;
+
+                /// Count calls and backward jumps of each function and
+                /// re-optimise it once either count reaches a threshold
+                void enable_tiering(std::uint32_t threshold = KORE_VM_TIER_THRESHOLD);
+
+                /// Compile functions to native code when they are tiered up.
+                /// Enables tiering if it is not already enabled. Returns
+                /// false if the jit is not supported on this platform
+                bool enable_jit();
+
+                /// Profile instruction counts and time per opcode and
+                /// function. Returns false if the vm was not compiled with
+                /// KORE_VM_PROFILER
+                bool enable_profiler();
+
+                /// Sample the call stack at a frequency in Hz of cpu time
+                /// while running. Function names are followed by the
+                /// program counter of each call frame if include_pcs is true
+                void enable_sampling(
+                    std::uint32_t frequency = KORE_VM_SAMPLING_FREQUENCY,
+                    bool include_pcs = false
+                );
+
+                /// The number of call stack samples taken so far
+                std::uint64_t sample_count() const;
+
+                /// Dump the sampled call stacks as folded stacks for flame
+                /// graph tools
+                void dump_samples(std::ostream& os) const;
+
+                /// Dump the profile as sorted tables or as JSON once the vm
+                /// is done executing
+                void dump_profile(std::ostream& os) const;
+                void dump_profile_json(std::ostream& os) const;
+
+                /// Dump statistics about the functions that were tiered up
+                void dump_tier_stats(std::ostream& os) const;
+
+                /// Dump the hits and misses of the inline caches of all call
+                /// sites that have been executed
+                void dump_inline_cache_stats(std::ostream& os) const;
+
+                /// Number of loaded functions that have been materialized,
+                /// i.e. decoded because they were used
+                int materialized_count() const;
+
+                /// Dump how many of the loaded functions were materialized
+                void dump_load_stats(std::ostream& os) const;
+
+                /// Set the maximum number of bytes of arrays and other heap
+                /// objects. Allocating past it is a vm error
+                void set_heap_limit(std::size_t limit);
+
+                /// Collect garbage on every allocation to check that the
+                /// stack maps of all functions are correct
+                void enable_gc_stress();
+
+                /// Collect garbage now
+                void collect_garbage();
+
+                /// Dump the number of garbage collections, their pause times
+                /// and the number of objects and bytes they freed
+                void dump_gc_stats(std::ostream& os) const;
+
+                /// Dump the decoded code of all loaded functions including
+                /// any call instructions quickened so far
+                void dump_code(std::ostream& os) const;
 
                 void vm_fatal_error(const std::string& message);
 
@@ -100,13 +147,16 @@ namespace kore {
                 bool _running = false;
                 bool _errored = false;
                 Context _context;
-                Value _registers[KORE_VM_MAX_REGISTERS];
-                std::vector<CallFrame> _call_frames;
+                RegisterStack _registers;
+
+                // One past the current call frame in the call frame stack
+                CallFrame* _frame_top;
+                std::uint64_t _dispatch_count = 0;
 
                 static const std::string log_group;
 
                 // Saved for dumping the main function's registers
-                int main_call_frame_reg_count;
+                int main_call_frame_reg_count = 0;
 
                 // Map of loaded modules
                 std::unordered_map<std::string, Module> _modules;
@@ -115,7 +165,26 @@ namespace kore {
                 std::vector<CompiledObject*> _loaded_functions;
 
                 // Table of global values
-                std::vector<Value> _globals;
+                std::vector<RegisterValue> _globals;
+
+                // Arrays allocated by the running code
+                Heap _heap;
+
+                // Tiering state and statistics
+                bool _tiering = false;
+                std::uint32_t _tier_threshold = KORE_VM_TIER_THRESHOLD;
+                std::size_t _tier_up_count = 0;
+                double _tier_up_seconds = 0.0;
+
+                // Compiles hot functions to native code if enabled
+                std::unique_ptr<x64::Jit> _jit;
+
+                // Profiles execution if enabled and compiled with
+                // KORE_VM_PROFILER
+                std::unique_ptr<Profiler> _profiler;
+
+                // Samples the call stack if enabled
+                std::unique_ptr<SamplingProfiler> _sampler;
 
             private:
                 /// Load all functions from a module
@@ -124,52 +193,131 @@ namespace kore {
                 /// Allocate space for globals
                 void allocate_globals(const Module& module);
 
-                /// Reserve local stack space for a called function
-                bool allocate_local_stack(const CompiledObject* const obj);
-
                 void vm_error(const std::string& message);
+
+                /// Allocate an array into a register. Reports a vm error and
+                /// returns false if the heap limit is exceeded
+                inline bool allocate_array(
+                    std::size_t reg_index,
+                    std::size_t size,
+                    ArrayElementType element_type
+                );
+
+                /// Mark the arrays in the globals and in the live registers
+                /// of every call frame
+                void mark_roots(Heap& heap);
+
+                /// Mark the arrays in the registers of a call frame that are
+                /// live at the instruction at pc according to the stack map
+                /// of its function. All registers are scanned for arrays if
+                /// the function has no stack map
+                void mark_call_frame(
+                    Heap& heap,
+                    const CompiledObject* func,
+                    std::size_t pc,
+                    std::size_t fp
+                );
                 void vm_error_unknown_opcode(Bytecode opcode);
 
-                /// Get a function by its index
+                /// Format the function and source location of the running
+                /// instruction for error messages
+                std::string format_error_location();
+
+                /// Get a function by its index and materialize it if it is
+                /// used for the first time. Reports a vm error and returns
+                /// nullptr if the function fails to decode or verify
                 CompiledObject* get_function(int func_index);
 
                 /// Get the current call frame
-                CallFrame* current_frame();
+                inline CallFrame* current_frame();
+
+                /// Check if there are any call frames left to execute
+                inline bool has_call_frames() const;
 
                 /// Push an i32 value onto a call frame's stack
                 inline void push_i32(i32 value);
 
                 /// Push a Value onto a call frame's stack
-                inline void push(Value& value);
+                inline void push(RegisterValue& value);
 
                 /// Push the value of a register onto the current call frame
                 inline void push_register(Reg reg);
 
-                /// When in a function call, get the caller of that function
-                inline const CallFrame* get_caller();
+                inline void push_call_frame(const CallFrame& call_frame);
 
-                void push_call_frame(CallFrame call_frame);
+                inline void pop_call_frame(const CallFrame& call_frame);
 
-                int push_function_arguments(bytecode_type instruction, std::size_t old_fp);
+                /// Cache a function in the inline cache of a call instruction
+                /// and rewrite the instruction to call it directly without
+                /// checking what kind of function it is. Decoded code is
+                /// modified in place
+                inline void quicken_call(
+                    const DecodedInstruction& instruction,
+                    const CompiledObject* func
+                );
 
-                void pop_call_frame(const CallFrame& call_frame);
+                inline void quicken_call(
+                    const DecodedInstruction& instruction,
+                    const BuiltinFunction* builtin
+                );
+
+                /// Rewrite the opcode of a quickened instruction
+                inline void rewrite_opcode(const DecodedInstruction& instruction, Bytecode opcode);
 
                 /// Push a new call frame
                 void do_function_call(
-                    bytecode_type instruction,
-                    const FunctionValue& callable
+                    const DecodedInstruction& instruction,
+                    const CompiledObject* func
+                );
+
+                /// Push a new call frame running already looked up code
+                void do_function_call(
+                    const DecodedInstruction& instruction,
+                    const CompiledObject* func,
+                    const DecodedInstruction* code
                 );
 
                 void do_builtin_function_call(
-                    bytecode_type instruction,
-                    const FunctionValue& callable
+                    const DecodedInstruction& instruction,
+                    const BuiltinFunction* builtin
+                );
+
+                /// Replace the current call frame with a call to another function
+                void do_tail_call(
+                    const DecodedInstruction& instruction,
+                    const CompiledObject* func
+                );
+
+                /// Call a builtin function and return its values from the
+                /// current call frame
+                void do_builtin_tail_call(
+                    const DecodedInstruction& instruction,
+                    const BuiltinFunction* builtin
                 );
 
+                /// Count a call of a function, tier it up if it became hot and
+                /// get its native code, if any
+                inline const x64::NativeCode* count_call(const CompiledObject* func);
+
+                /// Count a backward jump in the function of a call frame and
+                /// tier it up if it became hot. Returns true if the frame has
+                /// native code to continue in
+                inline bool count_backward_jump(CallFrame* frame);
+
+                /// Record the current call stack in the sampling profiler
+                void take_sample();
+
+                /// Re-optimise a hot function
+                void tier_up(const CompiledObject* func, TierUpReason reason);
+
                 /// Pop the current call frame
-                void do_function_return(bytecode_type instruction);
+                void do_function_return(const DecodedInstruction& instruction);
+
+                /// Move values in the current register window down to its start
+                inline void move_to_window_start(Reg first_reg, int count);
 
                 /// Pop a value from a call frame's stack
-                inline Value pop();
+                inline RegisterValue pop();
 
                 /// Get the position of the top of the stack
                 inline int top();
@@ -0,0 +1,212 @@
+#include "targets/x64/assembler.hpp"
+
+namespace kore {
+    namespace x64 {
+        inline std::uint8_t encode(Gpr reg) {
+            return static_cast<std::uint8_t>(reg);
+        }
+
+        inline std::uint8_t encode(Xmm reg) {
+            return static_cast<std::uint8_t>(reg);
+        }
+
+        inline std::uint8_t float_prefix(FloatWidth width) {
+            return width == FloatWidth::Single ? 0xf3 : 0xf2;
+        }
+
+        Assembler::Assembler() {}
+
+        std::size_t Assembler::size() const noexcept {
+            return _code.size();
+        }
+
+        const std::vector<std::uint8_t>& Assembler::code() const noexcept {
+            return _code;
+        }
+
+        void Assembler::load(Width width, Gpr dst, std::int32_t disp) {
+            emit_rex(width);
+            emit8(0x8b);
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        void Assembler::load_byte(Gpr dst, std::int32_t disp) {
+            emit8(0x0f);
+            emit8(0xb6);
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        void Assembler::store(Width width, std::int32_t disp, Gpr src) {
+            emit_rex(width);
+            emit8(0x89);
+            emit_memory_operand(encode(src), disp);
+        }
+
+        void Assembler::store_byte(std::int32_t disp, Gpr src) {
+            emit8(0x88);
+            emit_memory_operand(encode(src), disp);
+        }
+
+        void Assembler::store_byte(std::int32_t disp, std::uint8_t imm) {
+            emit8(0xc6);
+            emit_memory_operand(0, disp);
+            emit8(imm);
+        }
+
+        void Assembler::move_immediate(Gpr dst, std::uint64_t imm) {
+            // Writing a 32-bit register zero-extends into the full register
+            // so the shorter encoding suffices for small values
+            if (imm <= 0xffffffff) {
+                emit8(0xb8 + encode(dst));
+                emit32(static_cast<std::uint32_t>(imm));
+            } else {
+                emit_rex(Width::Qword);
+                emit8(0xb8 + encode(dst));
+                emit64(imm);
+            }
+        }
+
+        void Assembler::alu(AluOp op, Width width, Gpr dst, std::int32_t disp) {
+            emit_rex(width);
+            emit8(static_cast<std::uint8_t>(op));
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        void Assembler::add_immediate(Width width, Gpr dst, std::int32_t imm) {
+            emit_rex(width);
+            emit8(0x81);
+            emit8(0xc0 | encode(dst));
+            emit32(static_cast<std::uint32_t>(imm));
+        }
+
+        void Assembler::imul(Width width, Gpr dst, std::int32_t disp) {
+            emit_rex(width);
+            emit8(0x0f);
+            emit8(0xaf);
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        void Assembler::sign_extend_rax(Width width) {
+            emit_rex(width);
+            emit8(0x99);
+        }
+
+        void Assembler::idiv(Width width, std::int32_t disp) {
+            emit_rex(width);
+            emit8(0xf7);
+            emit_memory_operand(7, disp);
+        }
+
+        void Assembler::set(Condition condition, Gpr dst) {
+            emit8(0x0f);
+            emit8(0x90 | static_cast<std::uint8_t>(condition));
+            emit8(0xc0 | encode(dst));
+        }
+
+        void Assembler::and_byte(Gpr dst, Gpr src) {
+            emit8(0x20);
+            emit8(0xc0 | (encode(src) << 3) | encode(dst));
+        }
+
+        void Assembler::or_byte(Gpr dst, Gpr src) {
+            emit8(0x08);
+            emit8(0xc0 | (encode(src) << 3) | encode(dst));
+        }
+
+        void Assembler::test(Width width, Gpr dst, Gpr src) {
+            emit_rex(width);
+            emit8(0x85);
+            emit8(0xc0 | (encode(src) << 3) | encode(dst));
+        }
+
+        void Assembler::load_float(FloatWidth width, Xmm dst, std::int32_t disp) {
+            emit8(float_prefix(width));
+            emit8(0x0f);
+            emit8(0x10);
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        void Assembler::store_float(FloatWidth width, std::int32_t disp, Xmm src) {
+            emit8(float_prefix(width));
+            emit8(0x0f);
+            emit8(0x11);
+            emit_memory_operand(encode(src), disp);
+        }
+
+        void Assembler::float_op(SseOp op, FloatWidth width, Xmm dst, std::int32_t disp) {
+            emit8(float_prefix(width));
+            emit8(0x0f);
+            emit8(static_cast<std::uint8_t>(op));
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        void Assembler::float_compare(FloatWidth width, Xmm dst, std::int32_t disp) {
+            if (width == FloatWidth::Double) {
+                emit8(0x66);
+            }
+
+            emit8(0x0f);
+            emit8(0x2e);
+            emit_memory_operand(encode(dst), disp);
+        }
+
+        std::size_t Assembler::jump() {
+            emit8(0xe9);
+            emit32(0);
+
+            return size() - 4;
+        }
+
+        std::size_t Assembler::jump(Condition condition) {
+            emit8(0x0f);
+            emit8(0x80 | static_cast<std::uint8_t>(condition));
+            emit32(0);
+
+            return size() - 4;
+        }
+
+        void Assembler::patch_jump(std::size_t position, std::size_t target) {
+            // The displacement is relative to the end of the jump instruction
+            // which is also the end of the displacement
+            auto disp = static_cast<std::uint32_t>(
+                static_cast<std::int64_t>(target) - static_cast<std::int64_t>(position + 4)
+            );
+
+            for (int i = 0; i < 4; ++i) {
+                _code[position + i] = static_cast<std::uint8_t>(disp >> (8 * i));
+            }
+        }
+
+        void Assembler::ret() {
+            emit8(0xc3);
+        }
+
+        void Assembler::emit8(std::uint8_t byte) {
+            _code.push_back(byte);
+        }
+
+        void Assembler::emit32(std::uint32_t value) {
+            for (int i = 0; i < 4; ++i) {
+                emit8(static_cast<std::uint8_t>(value >> (8 * i)));
+            }
+        }
+
+        void Assembler::emit64(std::uint64_t value) {
+            emit32(static_cast<std::uint32_t>(value));
+            emit32(static_cast<std::uint32_t>(value >> 32));
+        }
+
+        void Assembler::emit_rex(Width width) {
+            if (width == Width::Qword) {
+                emit8(0x48);
+            }
+        }
+
+        void Assembler::emit_memory_operand(std::uint8_t reg, std::int32_t disp) {
+            // mod = 10 (32-bit displacement), rm = 111 (rdi) which needs no
+            // SIB byte
+            emit8(0x80 | (reg << 3) | encode(Gpr::Rdi));
+            emit32(static_cast<std::uint32_t>(disp));
+        }
+    }
+}
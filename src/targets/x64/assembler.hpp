@@ -0,0 +1,164 @@
+#ifndef KORE_X64_ASSEMBLER_HPP
+#define KORE_X64_ASSEMBLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kore {
+    namespace x64 {
+        /// General-purpose registers. Only the first eight are encodable
+        /// since the assembler never emits REX.R or REX.B prefixes
+        enum class Gpr : std::uint8_t {
+            Rax = 0,
+            Rcx,
+            Rdx,
+            Rbx,
+            Rsp,
+            Rbp,
+            Rsi,
+            Rdi,
+        };
+
+        enum class Xmm : std::uint8_t {
+            Xmm0 = 0,
+            Xmm1,
+        };
+
+        /// Condition codes as encoded in the low nibble of jcc and setcc
+        enum class Condition : std::uint8_t {
+            Below = 0x2,
+            AboveOrEqual = 0x3,
+            Equal = 0x4,
+            NotEqual = 0x5,
+            BelowOrEqual = 0x6,
+            Above = 0x7,
+            Parity = 0xa,
+            NoParity = 0xb,
+            Less = 0xc,
+            GreaterOrEqual = 0xd,
+            LessOrEqual = 0xe,
+            Greater = 0xf,
+        };
+
+        /// Operand size of integer instructions
+        enum class Width {
+            Dword,
+            Qword,
+        };
+
+        /// Operand size of scalar SSE instructions
+        enum class FloatWidth {
+            Single,
+            Double,
+        };
+
+        enum class AluOp : std::uint8_t {
+            Add = 0x03,
+            Sub = 0x2b,
+            Cmp = 0x3b,
+        };
+
+        enum class SseOp : std::uint8_t {
+            Add = 0x58,
+            Mult = 0x59,
+            Sub = 0x5c,
+            Div = 0x5e,
+        };
+
+        /// A minimal x86-64 assembler emitting just the instructions needed
+        /// by the jit's templates. Every memory operand is addressed
+        /// relative to rdi which holds the current register window so it
+        /// is always encoded as [rdi + disp32]
+        class Assembler final {
+            public:
+                Assembler();
+
+                std::size_t size() const noexcept;
+                const std::vector<std::uint8_t>& code() const noexcept;
+
+                /// mov dst, [rdi + disp]
+                void load(Width width, Gpr dst, std::int32_t disp);
+
+                /// movzx dst, byte [rdi + disp]
+                void load_byte(Gpr dst, std::int32_t disp);
+
+                /// mov [rdi + disp], src
+                void store(Width width, std::int32_t disp, Gpr src);
+
+                /// mov byte [rdi + disp], src
+                void store_byte(std::int32_t disp, Gpr src);
+
+                /// mov byte [rdi + disp], imm
+                void store_byte(std::int32_t disp, std::uint8_t imm);
+
+                /// Load a 32-bit immediate (zero-extended) or a 64-bit
+                /// immediate into a register
+                void move_immediate(Gpr dst, std::uint64_t imm);
+
+                /// add/sub/cmp dst, [rdi + disp]
+                void alu(AluOp op, Width width, Gpr dst, std::int32_t disp);
+
+                /// add dst, imm
+                void add_immediate(Width width, Gpr dst, std::int32_t imm);
+
+                /// imul dst, [rdi + disp]
+                void imul(Width width, Gpr dst, std::int32_t disp);
+
+                /// Sign-extend eax/rax into edx/rdx (cdq/cqo)
+                void sign_extend_rax(Width width);
+
+                /// idiv [rdi + disp]
+                void idiv(Width width, std::int32_t disp);
+
+                /// setcc dst (low byte)
+                void set(Condition condition, Gpr dst);
+
+                /// and/or dst, src on the low bytes
+                void and_byte(Gpr dst, Gpr src);
+                void or_byte(Gpr dst, Gpr src);
+
+                /// test dst, src
+                void test(Width width, Gpr dst, Gpr src);
+
+                /// movss/movsd dst, [rdi + disp]
+                void load_float(FloatWidth width, Xmm dst, std::int32_t disp);
+
+                /// movss/movsd [rdi + disp], src
+                void store_float(FloatWidth width, std::int32_t disp, Xmm src);
+
+                /// addss/subss/mulss/divss (or the sd variants) dst, [rdi + disp]
+                void float_op(SseOp op, FloatWidth width, Xmm dst, std::int32_t disp);
+
+                /// ucomiss/ucomisd dst, [rdi + disp]
+                void float_compare(FloatWidth width, Xmm dst, std::int32_t disp);
+
+                /// Emit a jump with a 32-bit displacement and return the
+                /// position of the displacement for patching it later
+                std::size_t jump();
+                std::size_t jump(Condition condition);
+
+                /// Point the jump whose displacement is at a position to an
+                /// offset in the code
+                void patch_jump(std::size_t position, std::size_t target);
+
+                void ret();
+
+            private:
+                std::vector<std::uint8_t> _code;
+
+            private:
+                void emit8(std::uint8_t byte);
+                void emit32(std::uint32_t value);
+                void emit64(std::uint64_t value);
+
+                /// Emit a REX.W prefix for 64-bit operands
+                void emit_rex(Width width);
+
+                /// Emit the ModRM byte and displacement of [rdi + disp]
+                void emit_memory_operand(std::uint8_t reg, std::int32_t disp);
+        };
+    }
+}
+
+#endif // KORE_X64_ASSEMBLER_HPP
@@ -0,0 +1,48 @@
+#include "targets/x64/executable_memory.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace kore {
+    namespace x64 {
+        ExecutableMemory::ExecutableMemory(const std::vector<std::uint8_t>& code)
+            : _size(code.size()) {
+            auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+            _mapping_size = (code.size() + page_size - 1) / page_size * page_size;
+
+            _mapping = mmap(
+                nullptr,
+                _mapping_size,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS,
+                -1,
+                0
+            );
+
+            if (_mapping == MAP_FAILED) {
+                throw std::runtime_error("Failed to map memory for native code");
+            }
+
+            std::memcpy(_mapping, code.data(), code.size());
+
+            if (mprotect(_mapping, _mapping_size, PROT_READ | PROT_EXEC) != 0) {
+                munmap(_mapping, _mapping_size);
+                throw std::runtime_error("Failed to make native code executable");
+            }
+        }
+
+        ExecutableMemory::~ExecutableMemory() {
+            munmap(_mapping, _mapping_size);
+        }
+
+        const std::uint8_t* ExecutableMemory::start() const noexcept {
+            return static_cast<const std::uint8_t*>(_mapping);
+        }
+
+        std::size_t ExecutableMemory::size() const noexcept {
+            return _size;
+        }
+    }
+}
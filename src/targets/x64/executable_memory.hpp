@@ -0,0 +1,33 @@
+#ifndef KORE_X64_EXECUTABLE_MEMORY_HPP
+#define KORE_X64_EXECUTABLE_MEMORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kore {
+    namespace x64 {
+        /// A page-aligned mapping holding machine code. The code is copied
+        /// into a writable mapping which is then made executable and read-only
+        /// so memory is never writable and executable at the same time
+        class ExecutableMemory final {
+            public:
+                /// Throws a std::runtime_error if the memory cannot be mapped
+                /// or protected
+                ExecutableMemory(const std::vector<std::uint8_t>& code);
+                ExecutableMemory(const ExecutableMemory&) = delete;
+                ExecutableMemory& operator=(const ExecutableMemory&) = delete;
+                ~ExecutableMemory();
+
+                const std::uint8_t* start() const noexcept;
+                std::size_t size() const noexcept;
+
+            private:
+                void* _mapping;
+                std::size_t _mapping_size;
+                std::size_t _size;
+        };
+    }
+}
+
+#endif // KORE_X64_EXECUTABLE_MEMORY_HPP
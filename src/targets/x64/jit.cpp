@@ -0,0 +1,449 @@
+#include "targets/x64/jit.hpp"
+#include "targets/bytecode/compiled_object.hpp"
+#include "targets/bytecode/vm/builtins/builtins.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+#include "targets/x64/assembler.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+namespace kore {
+    namespace x64 {
+        using vm::DecodedInstruction;
+        using vm::RegisterValue;
+
+        // Instruction index that native code returns to the interpreter
+        constexpr Gpr return_register = Gpr::Rax;
+
+        // Offsets of the value within a register and of its tag
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+        constexpr std::int32_t value_offset = 0;
+#else
+        constexpr std::int32_t value_offset = offsetof(vm::Value, value);
+        constexpr std::int32_t tag_offset = offsetof(vm::Value, tag);
+#endif
+
+        static_assert(
+            sizeof(RegisterValue) % 8 == 0,
+            "Registers must be moved as whole quadwords"
+        );
+
+        inline std::int32_t register_disp(Reg reg) {
+            return reg * static_cast<std::int32_t>(sizeof(RegisterValue));
+        }
+
+        inline std::int32_t value_disp(Reg reg) {
+            return register_disp(reg) + value_offset;
+        }
+
+        inline void emit_tag(Assembler& as, Reg reg, vm::ValueTag tag) {
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+            (void)as, (void)reg, (void)tag;
+#else
+            as.store_byte(register_disp(reg) + tag_offset, static_cast<std::uint8_t>(tag));
+#endif
+        }
+
+        inline Width width_of(vm::ValueTag tag) {
+            return tag == vm::ValueTag::I64 ? Width::Qword : Width::Dword;
+        }
+
+        inline FloatWidth float_width_of(vm::ValueTag tag) {
+            return tag == vm::ValueTag::F32 ? FloatWidth::Single : FloatWidth::Double;
+        }
+
+        /// Return to the interpreter at an instruction
+        void emit_exit(Assembler& as, std::size_t pc) {
+            as.move_immediate(return_register, pc);
+            as.ret();
+        }
+
+        void emit_move(Assembler& as, Reg dst, Reg src) {
+            for (std::int32_t offset = 0; offset < static_cast<std::int32_t>(sizeof(RegisterValue)); offset += 8) {
+                as.load(Width::Qword, Gpr::Rax, register_disp(src) + offset);
+                as.store(Width::Qword, register_disp(dst) + offset, Gpr::Rax);
+            }
+        }
+
+        /// Store a value known at compile time in a register including its
+        /// tag, if any
+        void emit_constant(Assembler& as, Reg dst, const RegisterValue& value) {
+            std::uint64_t qwords[sizeof(RegisterValue) / 8];
+            std::memcpy(qwords, &value, sizeof(RegisterValue));
+
+            for (std::size_t idx = 0; idx < sizeof(qwords) / sizeof(qwords[0]); ++idx) {
+                as.move_immediate(Gpr::Rax, qwords[idx]);
+                as.store(Width::Qword, register_disp(dst) + idx * 8, Gpr::Rax);
+            }
+        }
+
+        void emit_integer_op(Assembler& as, Bytecode opcode, vm::ValueTag tag, const DecodedInstruction& instruction) {
+            auto width = width_of(tag);
+            as.load(width, Gpr::Rax, value_disp(instruction.reg2));
+
+            switch (opcode) {
+                case AddI32: case AddI64:
+                    as.alu(AluOp::Add, width, Gpr::Rax, value_disp(instruction.reg3));
+                    break;
+
+                case SubI32: case SubI64:
+                    as.alu(AluOp::Sub, width, Gpr::Rax, value_disp(instruction.reg3));
+                    break;
+
+                case MultI32: case MultI64:
+                    as.imul(width, Gpr::Rax, value_disp(instruction.reg3));
+                    break;
+
+                default:
+                    as.sign_extend_rax(width);
+                    as.idiv(width, value_disp(instruction.reg3));
+                    break;
+            }
+
+            as.store(width, value_disp(instruction.reg1), Gpr::Rax);
+            emit_tag(as, instruction.reg1, tag);
+        }
+
+        void emit_float_op(Assembler& as, SseOp op, vm::ValueTag tag, const DecodedInstruction& instruction) {
+            auto width = float_width_of(tag);
+
+            as.load_float(width, Xmm::Xmm0, value_disp(instruction.reg2));
+            as.float_op(op, width, Xmm::Xmm0, value_disp(instruction.reg3));
+            as.store_float(width, value_disp(instruction.reg1), Xmm::Xmm0);
+            emit_tag(as, instruction.reg1, tag);
+        }
+
+        /// Store the result of a comparison in ecx as a boolean. Moving an
+        /// immediate does not affect the flags so ecx is cleared after the
+        /// comparison
+        void emit_store_condition(Assembler& as, Reg dst, Condition condition) {
+            as.move_immediate(Gpr::Rcx, 0);
+            as.set(condition, Gpr::Rcx);
+            as.store(Width::Qword, value_disp(dst), Gpr::Rcx);
+            emit_tag(as, dst, vm::ValueTag::Bool);
+        }
+
+        void emit_integer_compare(Assembler& as, Condition condition, vm::ValueTag tag, const DecodedInstruction& instruction) {
+            auto width = width_of(tag);
+
+            as.load(width, Gpr::Rax, value_disp(instruction.reg2));
+            as.alu(AluOp::Cmp, width, Gpr::Rax, value_disp(instruction.reg3));
+            emit_store_condition(as, instruction.reg1, condition);
+        }
+
+        /// Unordered comparisons (NaN) set the zero, parity and carry flags
+        /// so only the "above" conditions are false for them. Less than is
+        /// compiled as greater than with swapped operands and equality also
+        /// checks the parity flag
+        void emit_float_compare(Assembler& as, Bytecode opcode, vm::ValueTag tag, const DecodedInstruction& instruction) {
+            auto width = float_width_of(tag);
+            Reg left = instruction.reg2, right = instruction.reg3;
+
+            switch (opcode) {
+                case LtF32: case LtF64: case LeF32: case LeF64:
+                    std::swap(left, right);
+                    break;
+
+                default:
+                    break;
+            }
+
+            as.load_float(width, Xmm::Xmm0, value_disp(left));
+            as.float_compare(width, Xmm::Xmm0, value_disp(right));
+
+            switch (opcode) {
+                case LtF32: case LtF64: case GtF32: case GtF64:
+                    emit_store_condition(as, instruction.reg1, Condition::Above);
+                    break;
+
+                case LeF32: case LeF64: case GeF32: case GeF64:
+                    emit_store_condition(as, instruction.reg1, Condition::AboveOrEqual);
+                    break;
+
+                case EqF32: case EqF64:
+                    as.move_immediate(Gpr::Rcx, 0);
+                    as.set(Condition::Equal, Gpr::Rcx);
+                    as.set(Condition::NoParity, Gpr::Rdx);
+                    as.and_byte(Gpr::Rcx, Gpr::Rdx);
+                    as.store(Width::Qword, value_disp(instruction.reg1), Gpr::Rcx);
+                    emit_tag(as, instruction.reg1, vm::ValueTag::Bool);
+                    break;
+
+                default:
+                    as.move_immediate(Gpr::Rcx, 0);
+                    as.set(Condition::NotEqual, Gpr::Rcx);
+                    as.set(Condition::Parity, Gpr::Rdx);
+                    as.or_byte(Gpr::Rcx, Gpr::Rdx);
+                    as.store(Width::Qword, value_disp(instruction.reg1), Gpr::Rcx);
+                    emit_tag(as, instruction.reg1, vm::ValueTag::Bool);
+                    break;
+            }
+        }
+
+        inline vm::ValueTag operand_tag(Bytecode opcode, Bytecode i32_opcode) {
+            // Typed instructions come in groups of i32, i64, f32 and f64
+            return static_cast<vm::ValueTag>(
+                static_cast<int>(vm::ValueTag::I32) + (opcode - i32_opcode)
+            );
+        }
+
+        // Jumps are patched once the offsets of all instructions are known
+        struct JumpPatch {
+            std::size_t position;
+            std::size_t target;
+        };
+
+        Jit::Jit(const std::vector<CompiledObject*>& functions)
+            : _functions(functions) {}
+
+        Jit::~Jit() {}
+
+        const NativeCode* Jit::compile(const CompiledObject& func) {
+            Assembler as;
+            auto instructions = func.decoded_instructions();
+            auto size = static_cast<std::size_t>(func.decoded_size());
+
+            // Offset of each instruction's template plus one past the end
+            std::vector<std::size_t> offsets(size + 1);
+            std::vector<std::size_t> entry_offsets(size, NativeCode::no_entry);
+            std::vector<JumpPatch> patches;
+
+            for (std::size_t pc = 0; pc < size; ++pc) {
+                auto& instruction = instructions[pc];
+                auto opcode = instruction.opcode;
+                bool compiled = true;
+                offsets[pc] = as.size();
+
+                switch (opcode) {
+                    case Noop:
+                        break;
+
+                    case Move:
+                        emit_move(as, instruction.reg1, instruction.reg2);
+                        break;
+
+                    case LoadBool:
+                        emit_constant(as, instruction.reg1, RegisterValue::from_bool(instruction.value));
+                        break;
+
+                    case Cload:
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                        emit_constant(as, instruction.reg1, instruction.raw_constant);
+#else
+                        emit_constant(as, instruction.reg1, *instruction.constant);
+#endif
+                        break;
+
+                    case LoadBuiltin:
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                        emit_constant(as, instruction.reg1, vm::RawValue::from_builtin_index(instruction.value));
+#else
+                        emit_constant(
+                            as,
+                            instruction.reg1,
+                            vm::Value::from_builtin_function(vm::get_builtin_function_by_index(instruction.value))
+                        );
+#endif
+                        break;
+
+                    case LoadFunction:
+#ifdef KORE_VM_UNTAGGED_REGISTERS
+                        emit_constant(as, instruction.reg1, vm::RawValue::from_function_index(instruction.value));
+#else
+                        // Leave loading functions that have not been
+                        // materialized yet to the interpreter which does so
+                        if (!_functions[instruction.value]->is_materialized()) {
+                            emit_exit(as, pc);
+                            compiled = false;
+                            break;
+                        }
+
+                        emit_constant(as, instruction.reg1, vm::Value::from_function(_functions[instruction.value]));
+#endif
+                        break;
+
+                    case AddI32: case AddI64:
+                        emit_integer_op(as, opcode, operand_tag(opcode, AddI32), instruction);
+                        break;
+
+                    case SubI32: case SubI64:
+                        emit_integer_op(as, opcode, operand_tag(opcode, SubI32), instruction);
+                        break;
+
+                    case MultI32: case MultI64:
+                        emit_integer_op(as, opcode, operand_tag(opcode, MultI32), instruction);
+                        break;
+
+                    case DivI32: case DivI64:
+                        emit_integer_op(as, opcode, operand_tag(opcode, DivI32), instruction);
+                        break;
+
+                    case AddF32: case AddF64:
+                        emit_float_op(as, SseOp::Add, operand_tag(opcode, AddI32), instruction);
+                        break;
+
+                    case SubF32: case SubF64:
+                        emit_float_op(as, SseOp::Sub, operand_tag(opcode, SubI32), instruction);
+                        break;
+
+                    case MultF32: case MultF64:
+                        emit_float_op(as, SseOp::Mult, operand_tag(opcode, MultI32), instruction);
+                        break;
+
+                    case DivF32: case DivF64:
+                        emit_float_op(as, SseOp::Div, operand_tag(opcode, DivI32), instruction);
+                        break;
+
+                    case LtI32: case LtI64:
+                        emit_integer_compare(as, Condition::Less, operand_tag(opcode, LtI32), instruction);
+                        break;
+
+                    case GtI32: case GtI64:
+                        emit_integer_compare(as, Condition::Greater, operand_tag(opcode, GtI32), instruction);
+                        break;
+
+                    case LeI32: case LeI64:
+                        emit_integer_compare(as, Condition::LessOrEqual, operand_tag(opcode, LeI32), instruction);
+                        break;
+
+                    case GeI32: case GeI64:
+                        emit_integer_compare(as, Condition::GreaterOrEqual, operand_tag(opcode, GeI32), instruction);
+                        break;
+
+                    case EqI32: case EqI64:
+                        emit_integer_compare(as, Condition::Equal, operand_tag(opcode, EqI32), instruction);
+                        break;
+
+                    case NeqI32: case NeqI64:
+                        emit_integer_compare(as, Condition::NotEqual, operand_tag(opcode, NeqI32), instruction);
+                        break;
+
+                    case LtF32: case LtF64:
+                        emit_float_compare(as, opcode, operand_tag(opcode, LtI32), instruction);
+                        break;
+
+                    case GtF32: case GtF64:
+                        emit_float_compare(as, opcode, operand_tag(opcode, GtI32), instruction);
+                        break;
+
+                    case LeF32: case LeF64:
+                        emit_float_compare(as, opcode, operand_tag(opcode, LeI32), instruction);
+                        break;
+
+                    case GeF32: case GeF64:
+                        emit_float_compare(as, opcode, operand_tag(opcode, GeI32), instruction);
+                        break;
+
+                    case EqF32: case EqF64:
+                        emit_float_compare(as, opcode, operand_tag(opcode, EqI32), instruction);
+                        break;
+
+                    case NeqF32: case NeqF64:
+                        emit_float_compare(as, opcode, operand_tag(opcode, NeqI32), instruction);
+                        break;
+
+                    case AddI32K: case SubI32K: {
+                        // Negate with wrap-around so subtracting the smallest
+                        // i32 behaves like the interpreter
+                        auto value = static_cast<std::uint32_t>(instruction.value);
+                        auto imm = opcode == AddI32K ? value : 0u - value;
+
+                        as.load(Width::Dword, Gpr::Rax, value_disp(instruction.reg2));
+                        as.add_immediate(Width::Dword, Gpr::Rax, static_cast<std::int32_t>(imm));
+                        as.store(Width::Dword, value_disp(instruction.reg1), Gpr::Rax);
+                        emit_tag(as, instruction.reg1, vm::ValueTag::I32);
+                        break;
+                    }
+
+                    case Jump:
+                        patches.push_back({ as.jump(), instruction.target });
+                        break;
+
+                    case JumpIf:
+                    case JumpIfNot:
+                        as.load_byte(Gpr::Rax, value_disp(instruction.reg1));
+                        as.test(Width::Dword, Gpr::Rax, Gpr::Rax);
+                        patches.push_back({
+                            as.jump(opcode == JumpIf ? Condition::NotEqual : Condition::Equal),
+                            instruction.target,
+                        });
+                        break;
+
+                    case JumpIfLtI32:
+                    case JumpIfGtI32:
+                    case JumpIfLeI32:
+                    case JumpIfGeI32:
+                    case JumpIfEqI32:
+                    case JumpIfNeqI32: {
+                        static constexpr Condition conditions[] = {
+                            Condition::Less,
+                            Condition::Greater,
+                            Condition::LessOrEqual,
+                            Condition::GreaterOrEqual,
+                            Condition::Equal,
+                            Condition::NotEqual,
+                        };
+
+                        as.load(Width::Dword, Gpr::Rax, value_disp(instruction.reg1));
+                        as.alu(AluOp::Cmp, Width::Dword, Gpr::Rax, value_disp(instruction.reg2));
+                        patches.push_back({
+                            as.jump(conditions[opcode - JumpIfLtI32]),
+                            instruction.target,
+                        });
+                        break;
+                    }
+
+                    default:
+                        // Calls, returns, globals, arrays etc. are left to
+                        // the interpreter
+                        emit_exit(as, pc);
+                        compiled = false;
+                        break;
+                }
+
+                if (compiled) {
+                    entry_offsets[pc] = offsets[pc];
+                }
+            }
+
+            // Leave native code if execution runs off the end of the function
+            offsets[size] = as.size();
+            emit_exit(as, size);
+
+            for (auto& patch : patches) {
+                as.patch_jump(patch.position, offsets[patch.target]);
+            }
+
+            bool has_entries = false;
+
+            for (auto offset : entry_offsets) {
+                has_entries = has_entries || offset != NativeCode::no_entry;
+            }
+
+            if (!has_entries) {
+                return nullptr;
+            }
+
+            _native_code.push_back(std::make_unique<NativeCode>(
+                std::make_unique<ExecutableMemory>(as.code()),
+                entry_offsets
+            ));
+
+            return _native_code.back().get();
+        }
+
+        std::size_t Jit::compiled_count() const noexcept {
+            return _native_code.size();
+        }
+
+        std::size_t Jit::code_size() const noexcept {
+            std::size_t size = 0;
+
+            for (auto& native_code : _native_code) {
+                size += native_code->size();
+            }
+
+            return size;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef KORE_X64_JIT_HPP
+#define KORE_X64_JIT_HPP
+
+#include "targets/x64/native_code.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace kore {
+    class CompiledObject;
+
+    namespace x64 {
+        /// A template jit that compiles hot functions to x86-64 machine code
+        /// by emitting a fixed machine code template for each instruction.
+        /// Registers stay in the vm's register file so native code and the
+        /// interpreter can hand over execution at any instruction. Calls,
+        /// returns and any instruction without a template exit to the
+        /// interpreter which continues from that instruction
+        class Jit final {
+            public:
+                /// Function indices in instructions are resolved through the
+                /// vm's table of loaded functions
+                Jit(const std::vector<CompiledObject*>& functions);
+                Jit(const Jit&) = delete;
+                Jit& operator=(const Jit&) = delete;
+                ~Jit();
+
+                /// Compile the instructions of a function. The native code is
+                /// owned by the jit. Returns nullptr if none of its
+                /// instructions can be compiled
+                const NativeCode* compile(const CompiledObject& func);
+
+                /// The number of functions compiled to native code so far
+                std::size_t compiled_count() const noexcept;
+
+                /// The total size of all native code in bytes
+                std::size_t code_size() const noexcept;
+
+            private:
+                const std::vector<CompiledObject*>& _functions;
+                std::vector<std::unique_ptr<NativeCode>> _native_code;
+        };
+    }
+}
+
+#endif // KORE_X64_JIT_HPP
@@ -0,0 +1,25 @@
+#include "targets/x64/native_code.hpp"
+
+#include <utility>
+
+namespace kore {
+    namespace x64 {
+        NativeCode::NativeCode(
+            std::unique_ptr<ExecutableMemory> memory,
+            const std::vector<std::size_t>& entry_offsets
+        ) : _memory(std::move(memory)),
+            _entry_points(entry_offsets.size(), nullptr) {
+            for (std::size_t pc = 0; pc < entry_offsets.size(); ++pc) {
+                if (entry_offsets[pc] != no_entry) {
+                    _entry_points[pc] = reinterpret_cast<NativeEntryPoint>(
+                        const_cast<std::uint8_t*>(_memory->start() + entry_offsets[pc])
+                    );
+                }
+            }
+        }
+
+        std::size_t NativeCode::size() const noexcept {
+            return _memory->size();
+        }
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef KORE_X64_NATIVE_CODE_HPP
+#define KORE_X64_NATIVE_CODE_HPP
+
+#include "targets/bytecode/vm/register_value.hpp"
+#include "targets/x64/executable_memory.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace kore {
+    namespace x64 {
+        /// Native code is entered with a pointer to the current register
+        /// window and returns the index of the instruction at which the
+        /// interpreter should continue
+        using NativeEntryPoint = std::size_t (*)(vm::RegisterValue* registers);
+
+        /// The machine code compiled from a function's instructions. Every
+        /// instruction that has a template is an entry point so execution
+        /// can switch from the interpreter to native code at any of them
+        class NativeCode final {
+            public:
+                /// Entry offset of an instruction without native code
+                static constexpr std::size_t no_entry = static_cast<std::size_t>(-1);
+
+            public:
+                NativeCode(
+                    std::unique_ptr<ExecutableMemory> memory,
+                    const std::vector<std::size_t>& entry_offsets
+                );
+
+                /// Run native code from an instruction until it reaches an
+                /// instruction it cannot execute and return the index of that
+                /// instruction. If there is no native code for the instruction
+                /// itself, it is returned immediately
+                inline std::size_t run(vm::RegisterValue* registers, std::size_t pc) const {
+                    auto entry_point = _entry_points[pc];
+
+                    return entry_point ? entry_point(registers) : pc;
+                }
+
+                /// The size of the machine code in bytes
+                std::size_t size() const noexcept;
+
+            private:
+                std::unique_ptr<ExecutableMemory> _memory;
+
+                // Entry point of each instruction or nullptr if the
+                // instruction always exits to the interpreter
+                std::vector<NativeEntryPoint> _entry_points;
+        };
+    }
+}
+
+#endif // KORE_X64_NATIVE_CODE_HPP
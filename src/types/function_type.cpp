@@ -6,7 +6,8 @@
 #include "types/unknown_type.hpp"
 
 namespace kore {
-    FunctionType::FunctionType() : Type(TypeCategory::Function), _name(create_name()) {
+    FunctionType::FunctionType() : Type(TypeCategory::Function) {
+        create_name();
     }
 
     FunctionType::~FunctionType() {
@@ -231,7 +231,7 @@ namespace kore {
                 return;
             }
 
-            func_type = builtin_function->type;
+            func_type = builtin_function->type();
         }
 
         trace_type_checker("call", func_type);
@@ -0,0 +1,79 @@
+#include "utils/leb128.hpp"
+
+namespace kore {
+    void write_uleb128(std::uint64_t value, std::vector<std::uint8_t>& data) {
+        do {
+            std::uint8_t byte = value & 0x7f;
+            value >>= 7;
+
+            if (value != 0) {
+                byte |= 0x80;
+            }
+
+            data.push_back(byte);
+        } while (value != 0);
+    }
+
+    void write_sleb128(std::int64_t value, std::vector<std::uint8_t>& data) {
+        bool more = true;
+
+        while (more) {
+            std::uint8_t byte = value & 0x7f;
+            value >>= 7;
+
+            // Stop once the remaining bits are all copies of the sign bit
+            if ((value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40))) {
+                more = false;
+            } else {
+                byte |= 0x80;
+            }
+
+            data.push_back(byte);
+        }
+    }
+
+    bool read_uleb128(
+        const std::vector<std::uint8_t>& data,
+        std::size_t& pos,
+        std::uint64_t& value
+    ) {
+        value = 0;
+
+        for (int shift = 0; pos < data.size() && shift < 64; shift += 7) {
+            auto byte = data[pos++];
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    bool read_sleb128(
+        const std::vector<std::uint8_t>& data,
+        std::size_t& pos,
+        std::int64_t& value
+    ) {
+        std::uint64_t result = 0;
+
+        for (int shift = 0; pos < data.size() && shift < 64;) {
+            auto byte = data[pos++];
+            result |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            shift += 7;
+
+            if (!(byte & 0x80)) {
+                // Sign-extend from the last byte read
+                if (shift < 64 && (byte & 0x40)) {
+                    result |= ~static_cast<std::uint64_t>(0) << shift;
+                }
+
+                value = static_cast<std::int64_t>(result);
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef KORE_LEB128_HPP
+#define KORE_LEB128_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace kore {
+    /// Append a value as a variable-length LEB128 number, i.e. seven bits
+    /// per byte with the high bit set on all but the last byte
+    void write_uleb128(std::uint64_t value, std::vector<std::uint8_t>& data);
+    void write_sleb128(std::int64_t value, std::vector<std::uint8_t>& data);
+
+    /// Read a LEB128 number at pos and advance pos past it. Returns false
+    /// if the data ends before the number does
+    bool read_uleb128(
+        const std::vector<std::uint8_t>& data,
+        std::size_t& pos,
+        std::uint64_t& value
+    );
+
+    bool read_sleb128(
+        const std::vector<std::uint8_t>& data,
+        std::size_t& pos,
+        std::int64_t& value
+    );
+}
+
+#endif // KORE_LEB128_HPP
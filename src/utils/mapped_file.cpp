@@ -0,0 +1,64 @@
+#include "utils/mapped_file.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kore {
+    MappedFile::MappedFile(const fs::path& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+
+        if (fd == -1) {
+            throw std::runtime_error(
+                "failed to open file: " + std::string(std::strerror(errno))
+            );
+        }
+
+        struct stat file_stat;
+
+        if (fstat(fd, &file_stat) != 0) {
+            close(fd);
+            throw std::runtime_error(
+                "failed to stat file: " + std::string(std::strerror(errno))
+            );
+        }
+
+        _size = static_cast<std::size_t>(file_stat.st_size);
+
+        // Mapping zero bytes fails so leave empty files unmapped
+        if (_size > 0) {
+            _mapping = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (_mapping == MAP_FAILED) {
+                _mapping = nullptr;
+                close(fd);
+
+                throw std::runtime_error(
+                    "failed to map file: " + std::string(std::strerror(errno))
+                );
+            }
+        }
+
+        // The mapping stays valid after the file is closed
+        close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if (_mapping) {
+            munmap(_mapping, _size);
+        }
+    }
+
+    const std::uint8_t* MappedFile::data() const noexcept {
+        return static_cast<const std::uint8_t*>(_mapping);
+    }
+
+    std::size_t MappedFile::size() const noexcept {
+        return _size;
+    }
+}
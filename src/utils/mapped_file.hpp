@@ -0,0 +1,31 @@
+#ifndef KORE_MAPPED_FILE_HPP
+#define KORE_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace kore {
+    /// A file mapped read-only into memory for as long as the object lives
+    class MappedFile final {
+        public:
+            /// Map the whole file at path. Throws a std::runtime_error if the
+            /// file could not be opened or mapped
+            MappedFile(const fs::path& path);
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const std::uint8_t* data() const noexcept;
+            std::size_t size() const noexcept;
+
+        private:
+            void* _mapping = nullptr;
+            std::size_t _size = 0;
+    };
+}
+
+#endif // KORE_MAPPED_FILE_HPP
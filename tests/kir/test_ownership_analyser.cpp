@@ -0,0 +1,186 @@
+#include "catch.hpp"
+
+#include "targets/bytecode/codegen/kir/module.hpp"
+#include "targets/bytecode/codegen/kir/ownership_analyser.hpp"
+#include "types/array_type.hpp"
+
+namespace kore {
+    namespace kir {
+        /// A function whose first block branches to two blocks that join in
+        /// a last block
+        struct DiamondFunction {
+            Function& function;
+            BlockId first_block;
+            BlockId then_block;
+            BlockId else_block;
+            BlockId join_block;
+        };
+
+        DiamondFunction add_diamond_function(Module& module) {
+            auto& function = module[module.add_function(nullptr)];
+            auto& graph = function.graph();
+
+            graph.add_block(BasicBlock::StartBlockId);
+            graph.add_block(BasicBlock::EndBlockId);
+
+            DiamondFunction diamond{
+                function,
+                graph.add_block(),
+                graph.add_block(),
+                graph.add_block(),
+                graph.add_block(),
+            };
+
+            graph.add_edge(BasicBlock::StartBlockId, diamond.first_block);
+            graph.add_edge(diamond.first_block, diamond.then_block);
+            graph.add_edge(diamond.first_block, diamond.else_block);
+            graph.add_edge(diamond.then_block, diamond.join_block);
+            graph.add_edge(diamond.else_block, diamond.join_block);
+
+            return diamond;
+        }
+
+        std::vector<Bytecode> block_opcodes(Function& function, BlockId id) {
+            std::vector<Bytecode> result;
+
+            for (auto& instruction : function.graph()[id].instructions) {
+                result.push_back(instruction.opcode);
+            }
+
+            return result;
+        }
+
+        /// Get the block that is run first when the function is entered
+        BlockId entry_block(Function& function) {
+            return *function.graph().successor_begin(BasicBlock::StartBlockId);
+        }
+
+        const Type* f64_array_type() {
+            return Type::make_array_type(Type::get_type_from_category(TypeCategory::Float64));
+        }
+
+        TEST_CASE("Destroy arrays after their last use", "[kir][ownership]") {
+            Module module(0, "test.kore");
+            auto diamond = add_diamond_function(module);
+            auto& function = diamond.function;
+            auto& graph = function.graph();
+
+            graph.set_current_block(diamond.first_block);
+            auto array_reg = function.emit_allocate_array(4, f64_array_type());
+            auto index_reg = function.emit_load(Bytecode::Cload, 0);
+            auto cond_reg = function.emit_load(Bytecode::LoadBool, 1);
+            function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, diamond.else_block);
+
+            graph.set_current_block(diamond.then_block);
+            function.emit_array_get(f64_array_type(), array_reg, index_reg, function.allocate_register());
+            function.emit_unconditional_jump(diamond.join_block);
+
+            // The lowering pass destroys the array when returning
+            graph.set_current_block(diamond.join_block);
+            function.emit_load(Bytecode::Cload, 1);
+            function.emit_destroy(array_reg);
+            function.emit_return();
+
+            OwnershipAnalyser analyser;
+            analyser.analyse(module);
+
+            // Destroyed after the read in one branch and on entry to the
+            // other, and no drop flag is needed
+            REQUIRE(analyser.placed_count() == 2);
+            REQUIRE(analyser.drop_flag_count() == 0);
+            REQUIRE(block_opcodes(function, diamond.then_block) == std::vector<Bytecode>{
+                Bytecode::ArrayGetF64,
+                Bytecode::Destroy,
+                Bytecode::Jump,
+            });
+            REQUIRE(block_opcodes(function, diamond.else_block) == std::vector<Bytecode>{
+                Bytecode::Destroy,
+            });
+            REQUIRE(block_opcodes(function, diamond.join_block) == std::vector<Bytecode>{
+                Bytecode::Cload,
+                Bytecode::Ret,
+            });
+        }
+
+        TEST_CASE("Destroy unused arrays where they are allocated", "[kir][ownership]") {
+            Module module(0, "test.kore");
+            auto diamond = add_diamond_function(module);
+            auto& function = diamond.function;
+
+            function.graph().set_current_block(diamond.first_block);
+            auto array_reg = function.emit_allocate_array(4, f64_array_type());
+            function.emit_load(Bytecode::Cload, 0);
+            function.emit_destroy(array_reg);
+            function.emit_return();
+
+            OwnershipAnalyser analyser;
+            analyser.analyse(module);
+
+            REQUIRE(block_opcodes(function, diamond.first_block) == std::vector<Bytecode>{
+                Bytecode::ArrayAllocF64,
+                Bytecode::Destroy,
+                Bytecode::Cload,
+                Bytecode::Ret,
+            });
+        }
+
+        TEST_CASE("Arrays borrowed by builtin functions live until the call returns", "[kir][ownership]") {
+            Module module(0, "test.kore");
+            auto diamond = add_diamond_function(module);
+            auto& function = diamond.function;
+
+            function.graph().set_current_block(diamond.first_block);
+            auto array_reg = function.emit_allocate_array(4, f64_array_type());
+            auto func_reg = function.emit_load_function(2, Bytecode::LoadBuiltin);
+            auto arg_reg = function.allocate_register();
+            function.emit_move(arg_reg, array_reg);
+            function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+            function.emit_destroy(array_reg);
+            function.emit_return({ arg_reg });
+
+            OwnershipAnalyser analyser;
+            analyser.analyse(module);
+
+            REQUIRE(block_opcodes(function, diamond.first_block) == std::vector<Bytecode>{
+                Bytecode::ArrayAllocF64,
+                Bytecode::LoadBuiltin,
+                Bytecode::Move,
+                Bytecode::Call,
+                Bytecode::Destroy,
+                Bytecode::Ret,
+            });
+        }
+
+        TEST_CASE("Registers assigned on some paths to a join get a drop flag", "[kir][ownership]") {
+            Module module(0, "test.kore");
+            auto diamond = add_diamond_function(module);
+            auto& function = diamond.function;
+            auto& graph = function.graph();
+
+            graph.set_current_block(diamond.first_block);
+            auto always_reg = function.emit_allocate_array(4, f64_array_type());
+            auto cond_reg = function.emit_load(Bytecode::LoadBool, 1);
+            function.emit_refinc(always_reg);
+            function.emit_conditional_jump(Bytecode::JumpIfNot, cond_reg, diamond.else_block);
+
+            graph.set_current_block(diamond.then_block);
+            auto sometimes_reg = function.emit_allocate_array(4, f64_array_type());
+            function.emit_refinc(sometimes_reg);
+
+            graph.set_current_block(diamond.join_block);
+            function.emit_refdec(sometimes_reg);
+            function.emit_refdec(always_reg);
+            function.emit_return();
+
+            OwnershipAnalyser analyser;
+            analyser.analyse(module);
+
+            REQUIRE(analyser.drop_flag_count() == 1);
+
+            auto& entry = graph[entry_block(function)].instructions;
+            REQUIRE(entry.size() == 1);
+            REQUIRE(entry[0].opcode == Bytecode::LoadBool);
+            REQUIRE(std::get<RegisterAndValue>(entry[0].type).reg == sometimes_reg);
+        }
+    }
+}
@@ -0,0 +1,152 @@
+#include "catch.hpp"
+
+#include "targets/bytecode/codegen/kir/module.hpp"
+#include "targets/bytecode/codegen/kir/ref_count_optimiser.hpp"
+#include "types/array_type.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Add a function whose single block follows the start block
+        Function& add_test_function(Module& module) {
+            auto& function = module[module.add_function(nullptr)];
+            auto& graph = function.graph();
+
+            graph.add_block(BasicBlock::StartBlockId);
+            graph.add_block(BasicBlock::EndBlockId);
+
+            auto block_id = graph.add_block();
+            graph.add_edge(BasicBlock::StartBlockId, block_id);
+            graph.set_current_block(block_id);
+
+            return function;
+        }
+
+        std::vector<Bytecode> opcodes(Function& function) {
+            std::vector<Bytecode> result;
+
+            for (auto& instruction : function.graph().current_block().instructions) {
+                result.push_back(instruction.opcode);
+            }
+
+            return result;
+        }
+
+        const Type* i32_array_type() {
+            return Type::make_array_type(Type::get_type_from_category(TypeCategory::Integer32));
+        }
+
+        TEST_CASE("Cancel adjacent reference count pairs", "[kir][refcount]") {
+            Module module(0, "test.kore");
+            auto& function = add_test_function(module);
+            auto array_reg = function.emit_allocate_array(4, i32_array_type());
+
+            function.emit_refinc(array_reg);
+            function.emit_load(Bytecode::Cload, 0);
+            function.emit_refdec(array_reg);
+            function.emit_return();
+
+            RefCountOptimiser optimiser;
+            optimiser.optimise(module);
+
+            REQUIRE(optimiser.cancelled_count() == 1);
+            REQUIRE(opcodes(function) == std::vector<Bytecode>{
+                Bytecode::ArrayAllocI32,
+                Bytecode::Cload,
+                Bytecode::Ret,
+            });
+        }
+
+        TEST_CASE("Do not cancel pairs around uses of the register", "[kir][refcount]") {
+            Module module(0, "test.kore");
+            auto& function = add_test_function(module);
+            auto array_reg = function.emit_allocate_array(4, i32_array_type());
+            auto copy_reg = function.allocate_register();
+
+            function.emit_refinc(array_reg);
+            function.emit_move(copy_reg, array_reg);
+            function.emit_refdec(array_reg);
+            function.emit_return({ copy_reg });
+
+            RefCountOptimiser optimiser;
+            optimiser.optimise(module);
+
+            REQUIRE(optimiser.cancelled_count() == 0);
+            REQUIRE(optimiser.destroyed_count() == 0);
+        }
+
+        TEST_CASE("Destroy uniquely owned arrays", "[kir][refcount]") {
+            Module module(0, "test.kore");
+            auto& function = add_test_function(module);
+            auto array_reg = function.emit_allocate_array(4, i32_array_type());
+            auto index_reg = function.emit_load(Bytecode::Cload, 0);
+
+            function.emit_array_set(i32_array_type(), array_reg, index_reg, index_reg);
+            function.emit_refdec(array_reg);
+            function.emit_return();
+
+            RefCountOptimiser optimiser;
+            optimiser.optimise(module);
+
+            REQUIRE(optimiser.destroyed_count() == 1);
+            REQUIRE(opcodes(function)[3] == Bytecode::Destroy);
+        }
+
+        TEST_CASE("Arrays borrowed by builtin functions are uniquely owned", "[kir][refcount]") {
+            Module module(0, "test.kore");
+            auto& function = add_test_function(module);
+            auto array_reg = function.emit_allocate_array(4, i32_array_type());
+            auto func_reg = function.emit_load_function(0, Bytecode::LoadBuiltin);
+            auto arg_reg = function.allocate_register();
+
+            function.emit_move(arg_reg, array_reg);
+            function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+            function.emit_refdec(array_reg);
+            function.emit_return();
+
+            RefCountOptimiser optimiser;
+            optimiser.optimise(module);
+
+            REQUIRE(optimiser.destroyed_count() == 1);
+        }
+
+        TEST_CASE("Arrays passed to functions are not uniquely owned", "[kir][refcount]") {
+            Module module(0, "test.kore");
+            auto& function = add_test_function(module);
+            auto array_reg = function.emit_allocate_array(4, i32_array_type());
+            auto func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+            auto arg_reg = function.allocate_register();
+
+            function.emit_move(arg_reg, array_reg);
+            function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+            function.emit_refdec(array_reg);
+            function.emit_return();
+
+            RefCountOptimiser optimiser;
+            optimiser.optimise(module);
+
+            REQUIRE(optimiser.destroyed_count() == 0);
+        }
+
+        TEST_CASE("Arrays stored in other arrays are not uniquely owned", "[kir][refcount]") {
+            Module module(0, "test.kore");
+            auto& function = add_test_function(module);
+            auto nested_type = Type::make_array_type(i32_array_type());
+            auto outer_reg = function.emit_allocate_array(1, nested_type);
+            auto inner_reg = function.emit_allocate_array(4, i32_array_type());
+            auto index_reg = function.emit_load(Bytecode::Cload, 0);
+
+            function.emit_refinc(inner_reg);
+            function.emit_array_set(nested_type, outer_reg, index_reg, inner_reg);
+            function.emit_refdec(inner_reg);
+            function.emit_refdec(outer_reg);
+            function.emit_return();
+
+            RefCountOptimiser optimiser;
+            optimiser.optimise(module);
+
+            // Only the outer array is uniquely owned
+            REQUIRE(optimiser.cancelled_count() == 0);
+            REQUIRE(optimiser.destroyed_count() == 1);
+        }
+    }
+}
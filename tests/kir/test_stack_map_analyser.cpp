@@ -0,0 +1,113 @@
+#include "catch.hpp"
+
+#include "targets/bytecode/codegen/kir/module.hpp"
+#include "targets/bytecode/codegen/kir/stack_map_analyser.hpp"
+#include "types/array_type.hpp"
+
+namespace kore {
+    namespace kir {
+        /// Add a function whose single block follows the start block
+        Function& add_single_block_function(Module& module) {
+            auto& function = module[module.add_function(nullptr)];
+            auto& graph = function.graph();
+
+            graph.add_block(BasicBlock::StartBlockId);
+            graph.add_block(BasicBlock::EndBlockId);
+
+            auto block_id = graph.add_block();
+            graph.add_edge(BasicBlock::StartBlockId, block_id);
+            graph.set_current_block(block_id);
+
+            return function;
+        }
+
+        const Type* i64_array_type() {
+            return Type::make_array_type(Type::get_type_from_category(TypeCategory::Integer64));
+        }
+
+        TEST_CASE("Arrays live across an allocation are roots", "[kir][stack_map]") {
+            Module module(0, "test.kore");
+            auto& function = add_single_block_function(module);
+            auto block_id = function.graph().current_block().id;
+            auto array_reg1 = function.emit_allocate_array(4, i64_array_type());
+            auto array_reg2 = function.emit_allocate_array(4, i64_array_type());
+
+            function.emit_refdec(array_reg1);
+            function.emit_refdec(array_reg2);
+            function.emit_return();
+
+            StackMapAnalyser analyser;
+            analyser.analyse(function);
+
+            auto& block = function.graph()[block_id];
+
+            REQUIRE(is_safepoint(block, 0));
+            REQUIRE(is_safepoint(block, 1));
+            REQUIRE_FALSE(is_safepoint(block, 2));
+
+            // The register an allocation assigns is not a root
+            REQUIRE(analyser.roots(block_id, 0).empty());
+            REQUIRE(analyser.roots(block_id, 1) == std::vector<Reg>{ array_reg1 });
+        }
+
+        TEST_CASE("Released arrays and other values are not roots", "[kir][stack_map]") {
+            Module module(0, "test.kore");
+            auto& function = add_single_block_function(module);
+            auto block_id = function.graph().current_block().id;
+            auto array_reg1 = function.emit_allocate_array(4, i64_array_type());
+            auto value_reg = function.emit_load(Bytecode::Cload, 0);
+
+            function.emit_refdec(array_reg1);
+
+            auto array_reg2 = function.emit_allocate_array(4, i64_array_type());
+
+            function.emit_refdec(array_reg2);
+            function.emit_return({ value_reg });
+
+            StackMapAnalyser analyser;
+            analyser.analyse(function);
+
+            REQUIRE(is_safepoint(function.graph()[block_id], 3));
+            REQUIRE(analyser.roots(block_id, 3).empty());
+        }
+
+        TEST_CASE("Arrays live across calls are roots", "[kir][stack_map]") {
+            Module module(0, "test.kore");
+            auto& function = add_single_block_function(module);
+            auto block_id = function.graph().current_block().id;
+            auto array_reg = function.emit_allocate_array(4, i64_array_type());
+            auto func_reg = function.emit_load_function(1, Bytecode::LoadFunction);
+            auto arg_reg = function.emit_load(Bytecode::Cload, 0);
+
+            function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+            function.emit_refdec(array_reg);
+            function.emit_return({ arg_reg });
+
+            StackMapAnalyser analyser;
+            analyser.analyse(function);
+
+            REQUIRE(is_safepoint(function.graph()[block_id], 3));
+            REQUIRE(analyser.roots(block_id, 3) == std::vector<Reg>{ array_reg });
+        }
+
+        TEST_CASE("Builtin calls are not safepoints", "[kir][stack_map]") {
+            Module module(0, "test.kore");
+            auto& function = add_single_block_function(module);
+            auto block_id = function.graph().current_block().id;
+            auto array_reg = function.emit_allocate_array(4, i64_array_type());
+            auto func_reg = function.emit_load_function(0, Bytecode::LoadBuiltin);
+            auto arg_reg = function.allocate_register();
+
+            function.emit_move(arg_reg, array_reg);
+            function.emit_call(func_reg, arg_reg, { arg_reg }, { arg_reg });
+            function.emit_refdec(array_reg);
+            function.emit_return();
+
+            StackMapAnalyser analyser;
+            analyser.analyse(function);
+
+            REQUIRE_FALSE(is_safepoint(function.graph()[block_id], 3));
+            REQUIRE(analyser.roots(block_id, 3).empty());
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#include "catch.hpp"
+
+#include "targets/bytecode/vm/builtins/array_kernels.hpp"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace kore {
+    namespace vm {
+        /// Get the vector kernels supported by the cpu running the tests
+        std::vector<const ArrayKernels*> vector_kernels() {
+            std::vector<const ArrayKernels*> kernels;
+
+            for (auto kernel : { sse2_array_kernels(), avx2_array_kernels() }) {
+                if (kernel) {
+                    kernels.push_back(kernel);
+                }
+            }
+
+            return kernels;
+        }
+
+        /// Make an array of small whole numbers which are summed without
+        /// rounding errors in any order
+        std::vector<f64> make_values(std::size_t size, std::mt19937& rng) {
+            std::uniform_int_distribution<int> distribution(-8, 8);
+            std::vector<f64> values(size);
+
+            for (auto& value : values) {
+                value = distribution(rng);
+            }
+
+            return values;
+        }
+
+        // Sizes around multiples of the vector widths to cover the scalar
+        // tail of the vector kernels
+        const std::size_t sizes[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 1000, 1003 };
+
+        TEST_CASE("Vector and scalar array kernels agree", "[vm][array_kernels]") {
+            auto& scalar = scalar_array_kernels();
+            std::mt19937 rng(1234);
+
+            for (auto kernels : vector_kernels()) {
+                INFO("kernels: " << kernels->name);
+
+                for (auto size : sizes) {
+                    INFO("size: " << size);
+
+                    auto values1 = make_values(size, rng);
+                    auto values2 = make_values(size, rng);
+
+                    REQUIRE(kernels->sum(values1.data(), size) == scalar.sum(values1.data(), size));
+                    REQUIRE(kernels->min(values1.data(), size) == scalar.min(values1.data(), size));
+                    REQUIRE(kernels->max(values1.data(), size) == scalar.max(values1.data(), size));
+                    REQUIRE(
+                        kernels->dot(values1.data(), values2.data(), size)
+                        == scalar.dot(values1.data(), values2.data(), size)
+                    );
+                    REQUIRE(
+                        kernels->count_eq(values1.data(), size, 3.0)
+                        == scalar.count_eq(values1.data(), size, 3.0)
+                    );
+
+                    auto expected = values1;
+                    auto actual = values1;
+                    scalar.scale(expected.data(), size, -1.5);
+                    kernels->scale(actual.data(), size, -1.5);
+                    REQUIRE(actual == expected);
+
+                    scalar.add(expected.data(), values2.data(), size);
+                    kernels->add(actual.data(), values2.data(), size);
+                    REQUIRE(actual == expected);
+
+                    scalar.fill(expected.data(), size, 7.25);
+                    kernels->fill(actual.data(), size, 7.25);
+                    REQUIRE(actual == expected);
+                }
+            }
+        }
+
+        TEST_CASE("Vector array kernels sum fractions like the scalar kernels", "[vm][array_kernels]") {
+            auto& scalar = scalar_array_kernels();
+            std::mt19937 rng(5678);
+            std::uniform_real_distribution<f64> distribution(-1.0, 1.0);
+            std::vector<f64> values1(1003);
+            std::vector<f64> values2(1003);
+
+            for (std::size_t idx = 0; idx < values1.size(); ++idx) {
+                values1[idx] = distribution(rng);
+                values2[idx] = distribution(rng);
+            }
+
+            for (auto kernels : vector_kernels()) {
+                INFO("kernels: " << kernels->name);
+
+                // Only the order of the additions differs
+                REQUIRE(
+                    kernels->sum(values1.data(), values1.size())
+                    == Approx(scalar.sum(values1.data(), values1.size()))
+                );
+                REQUIRE(
+                    kernels->dot(values1.data(), values2.data(), values1.size())
+                    == Approx(scalar.dot(values1.data(), values2.data(), values1.size()))
+                );
+            }
+        }
+
+        TEST_CASE("Array kernels ignore NaN in min and max", "[vm][array_kernels]") {
+            const std::vector<f64> values = { NAN, 3.0, -2.0, NAN, 5.0, NAN, 1.0 };
+            std::vector<const ArrayKernels*> all_kernels = vector_kernels();
+            all_kernels.push_back(&scalar_array_kernels());
+
+            for (auto kernels : all_kernels) {
+                INFO("kernels: " << kernels->name);
+
+                REQUIRE(kernels->min(values.data(), values.size()) == -2.0);
+                REQUIRE(kernels->max(values.data(), values.size()) == 5.0);
+                REQUIRE(kernels->count_eq(values.data(), values.size(), NAN) == 0u);
+                REQUIRE(std::isinf(kernels->min(values.data(), 0)));
+                REQUIRE(std::isinf(kernels->max(values.data(), 0)));
+            }
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include "catch.hpp"
+
+#include "targets/bytecode/vm/heap.hpp"
+#include "targets/bytecode/vm/value_type.hpp"
+#include "targets/bytecode/vm/values/array_value.hpp"
+
+namespace kore {
+    namespace vm {
+        /// Allocate an array of register values and add it to a heap
+        ArrayValue* add_array(Heap& heap, std::size_t size) {
+            auto array = ArrayValue::allocate(size);
+            REQUIRE(heap.add(array));
+
+            return array;
+        }
+
+        TEST_CASE("Collect unreachable arrays including cycles", "[vm][heap]") {
+            Heap heap;
+            auto array1 = add_array(heap, 1);
+            auto array2 = add_array(heap, 1);
+
+            (*array1)[0] = RegisterValue::from_array(array2);
+            (*array2)[0] = RegisterValue::from_array(array1);
+
+            auto bytes = heap.bytes();
+            heap.collect();
+
+            REQUIRE(heap.object_count() == 0);
+            REQUIRE(heap.bytes() == 0);
+            REQUIRE(heap.stats().collections == 1);
+            REQUIRE(heap.stats().objects_freed == 2);
+            REQUIRE(heap.stats().bytes_freed == bytes);
+        }
+
+        TEST_CASE("Keep arrays reachable from the roots", "[vm][heap]") {
+            Heap heap;
+            auto root = add_array(heap, 1);
+            auto nested = add_array(heap, 4);
+            add_array(heap, 8);
+
+            (*root)[0] = RegisterValue::from_array(nested);
+            heap.set_root_marker([root](Heap& collecting) { collecting.mark(root); });
+            heap.collect();
+
+            REQUIRE(heap.object_count() == 2);
+            REQUIRE(heap.bytes() == root->heap_size() + nested->heap_size());
+
+            // Marks are cleared so the same arrays survive the next
+            // collection
+            heap.collect();
+
+            REQUIRE(heap.object_count() == 2);
+        }
+
+        TEST_CASE("Ignore candidates that are not in the heap", "[vm][heap]") {
+            Heap heap;
+            ArrayValue outside(1);
+            int not_an_array = 0;
+            add_array(heap, 1);
+
+            heap.set_root_marker([&](Heap& collecting) {
+                collecting.mark(&outside);
+                collecting.mark_candidate(&outside);
+                collecting.mark_candidate(reinterpret_cast<HeapObject*>(&not_an_array));
+                collecting.mark_candidate(nullptr);
+            });
+            heap.collect();
+
+            REQUIRE(heap.object_count() == 0);
+        }
+
+        TEST_CASE("Arrays freed by reference counting leave the heap", "[vm][heap]") {
+            Heap heap;
+            auto array = add_array(heap, 16);
+
+            REQUIRE(heap.object_count() == 1);
+
+            ArrayValue::release(array);
+
+            REQUIRE(heap.object_count() == 0);
+            REQUIRE(heap.bytes() == 0);
+        }
+
+        TEST_CASE("Do not grow the heap past its limit", "[vm][heap]") {
+            auto root = ArrayValue::allocate(1);
+            Heap heap(root->heap_size() + 64);
+
+            REQUIRE(heap.add(root));
+            heap.set_root_marker([root](Heap& collecting) { collecting.mark(root); });
+
+            auto array = ArrayValue::allocate(16);
+
+            REQUIRE_FALSE(heap.add(array));
+            REQUIRE(heap.object_count() == 1);
+            REQUIRE(heap.stats().collections == 1);
+
+            delete array;
+        }
+
+        TEST_CASE("Collect on every allocation in stress mode", "[vm][heap]") {
+            Heap heap;
+            heap.set_stress(true);
+
+            for (int i = 0; i < 3; ++i) {
+                add_array(heap, 1);
+            }
+
+            REQUIRE(heap.stats().collections == 3);
+            REQUIRE(heap.object_count() == 1);
+        }
+    }
+}